@@ -0,0 +1,492 @@
+#include "drill_pack.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+
+#include "key_matcher.h"
+#include "session_log.h"
+
+namespace {
+
+constexpr char kMagic[8] = {'L', 'H', 'T', 'D', 'R', 'I', 'L', 'L'};
+// 2: Shift+digit combos store the shifted symbol key
+constexpr quint32 kVersion = 2;
+constexpr quint32 kEndianTag = 0x01020304;
+constexpr double kMaxWeight = 100.0;
+
+// Followed by item_count PackItemRecords, then strings_size bytes of
+// NUL-terminated strings
+struct PackHeader {
+    char magic[8];
+    quint32 version;
+    quint32 record_size;
+    quint32 endian_tag;
+    quint32 item_count;
+    quint32 strings_size;
+    quint32 name_offset;        // UTF-8 pack name in the string table
+    quint32 content_hash;       // FNV-1a over records and strings
+    quint32 reserved;
+};
+static_assert(sizeof(PackHeader) == 40, "PackHeader layout changed");
+
+struct PackItemRecord {
+    quint8 type;                // TrainingType
+    quint8 min_difficulty;      // Difficulty, never kCustom
+    quint16 reserved;
+    quint32 label_offset;       // Latin-1 label in the string table
+    quint32 sequence_offset;    // lowercase keys, "" for combo/special
+    qint32 key;                 // combo/special: Qt::Key
+    qint32 modifiers;           // combo: Qt::KeyboardModifiers
+    float weight;
+};
+static_assert(sizeof(PackItemRecord) == 24, "PackItemRecord layout changed");
+
+QString SourcePath(const QString &directory, const QString &id) {
+    return directory + QLatin1Char('/') + id + QStringLiteral(".lhtdrill");
+}
+
+QString PackPath(const QString &directory, const QString &id) {
+    return directory + QLatin1Char('/') + id + QStringLiteral(".lhtpack");
+}
+
+quint32 Fnv1a(const char *data, qint64 size, quint32 hash = 2166136261u) {
+    for (qint64 i = 0; i < size; ++i) {
+        hash ^= static_cast<uchar>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool IsTypable(QChar ch) {
+    return ch.unicode() > 0x20 && ch.unicode() < 0x7f;
+}
+
+// One character, or F1-F12, Space, Tab, Esc. Esc is recognised only so the
+// item can be refused: it always ends the session
+int ParseKeyName(const QString &name) {
+    if (name.size() == 1) {
+        const QChar ch = name.at(0).toLower();
+        return IsTypable(ch) ? KeyMatcher::KeyForChar(static_cast<char>(ch.unicode())) : 0;
+    }
+    const QString lower = name.toLower();
+    if (lower == QLatin1String("space")) return Qt::Key_Space;
+    if (lower == QLatin1String("tab")) return Qt::Key_Tab;
+    if (lower == QLatin1String("esc")) return Qt::Key_Escape;
+    if (lower.startsWith(QLatin1Char('f'))) {
+        bool ok = false;
+        const int number = lower.mid(1).toInt(&ok);
+        if (ok && number >= 1 && number <= 12) {
+            return Qt::Key_F1 + number - 1;
+        }
+    }
+    return 0;
+}
+
+// Qt reports Shift+digit as the symbol on the key (US layout), which is what
+// the built-in Shift+1-5 items match on
+int ShiftedDigitKey(int key) {
+    static const int kShifted[] = {Qt::Key_ParenRight, Qt::Key_Exclam, Qt::Key_At,
+                                   Qt::Key_NumberSign, Qt::Key_Dollar, Qt::Key_Percent,
+                                   Qt::Key_AsciiCircum, Qt::Key_Ampersand, Qt::Key_Asterisk,
+                                   Qt::Key_ParenLeft};
+    return (key >= Qt::Key_0 && key <= Qt::Key_9) ? kShifted[key - Qt::Key_0] : key;
+}
+
+bool ParseDifficulty(const QString &value, Difficulty *difficulty) {
+    const QString lower = value.toLower();
+    if (lower == QLatin1String("beginner")) {
+        *difficulty = Difficulty::kBeginner;
+    } else if (lower == QLatin1String("intermediate")) {
+        *difficulty = Difficulty::kIntermediate;
+    } else if (lower == QLatin1String("advanced")) {
+        *difficulty = Difficulty::kAdvanced;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Append-only table of NUL-terminated strings, addressed by offset
+class StringTable {
+public:
+    quint32 Add(const QByteArray &text) {
+        const quint32 offset = static_cast<quint32>(data_.size());
+        data_.append(text);
+        data_.append('\0');
+        return offset;
+    }
+    const QByteArray &Data() const { return data_; }
+
+private:
+    QByteArray data_;
+};
+
+// Parses one item line into record; the caller reports error with the line
+bool ParseItem(const QStringList &tokens, StringTable &strings, PackItemRecord *record,
+               QString *error) {
+    const QString &type = tokens.at(0);
+    if (tokens.size() < 2) {
+        *error = QStringLiteral("缺少按键");
+        return false;
+    }
+    const QString &keys = tokens.at(1);
+
+    std::memset(record, 0, sizeof(*record));
+    QString label;
+    QByteArray sequence;
+
+    if (type == QLatin1String("single") || type == QLatin1String("sequence")) {
+        const bool single = (type == QLatin1String("single"));
+        if (single ? keys.size() != 1 : (keys.size() < 2 || keys.size() > KeyMatcher::kMaxSteps)) {
+            *error = single ? QStringLiteral("single 只能是一个按键")
+                            : QStringLiteral("sequence 需要 2 到 %1 个按键").arg(KeyMatcher::kMaxSteps);
+            return false;
+        }
+        for (QChar ch : keys) {
+            if (!IsTypable(ch)) {
+                *error = QStringLiteral("无法输入的字符 '%1'").arg(ch);
+                return false;
+            }
+        }
+        record->type = static_cast<quint8>(single ? TrainingType::kSingleKey : TrainingType::kSequence);
+        sequence = keys.toLower().toLatin1();
+        label = keys.toUpper();
+    } else if (type == QLatin1String("combo")) {
+        // Modifiers first, key last: Ctrl+Shift+2
+        const QStringList parts = keys.split(QLatin1Char('+'));
+        int modifiers = 0;
+        for (int i = 0; i + 1 < parts.size(); ++i) {
+            const QString modifier = parts.at(i).toLower();
+            if (modifier == QLatin1String("ctrl")) {
+                modifiers |= Qt::ControlModifier;
+            } else if (modifier == QLatin1String("shift")) {
+                modifiers |= Qt::ShiftModifier;
+            } else if (modifier == QLatin1String("alt")) {
+                modifiers |= Qt::AltModifier;
+            } else {
+                *error = QStringLiteral("未知的修饰键 '%1'").arg(parts.at(i));
+                return false;
+            }
+        }
+        record->key = ParseKeyName(parts.last());
+        if (modifiers == 0 || record->key == 0) {
+            *error = QStringLiteral("combo 格式应为 Ctrl+1 / Shift+Q / Alt+F4");
+            return false;
+        }
+        if (record->key == Qt::Key_Escape) {
+            *error = QStringLiteral("Esc 用于结束训练, 不能作为题目");
+            return false;
+        }
+        if (modifiers & Qt::ShiftModifier) {
+            record->key = ShiftedDigitKey(record->key);
+        }
+        record->type = static_cast<quint8>(TrainingType::kCombo);
+        record->modifiers = modifiers;
+        label = keys;
+    } else if (type == QLatin1String("special")) {
+        record->key = ParseKeyName(keys);
+        if (record->key == Qt::Key_Escape) {
+            *error = QStringLiteral("Esc 用于结束训练, 不能作为题目");
+            return false;
+        }
+        if (record->key == 0 || keys.size() == 1) {
+            *error = QStringLiteral("special 只支持 F1-F12 / Space / Tab");
+            return false;
+        }
+        record->type = static_cast<quint8>(TrainingType::kSpecialKey);
+        label = keys;
+    } else {
+        *error = QStringLiteral("未知的条目类型 '%1'").arg(type);
+        return false;
+    }
+
+    Difficulty difficulty = Difficulty::kBeginner;
+    double weight = 1.0;
+    for (int i = 2; i < tokens.size(); ++i) {
+        const QString &option = tokens.at(i);
+        const int eq = option.indexOf(QLatin1Char('='));
+        const QString name = option.left(eq);
+        const QString value = option.mid(eq + 1);
+        bool ok = eq > 0;
+        if (ok && name == QLatin1String("label")) {
+            label = value;
+        } else if (ok && name == QLatin1String("weight")) {
+            weight = value.toDouble(&ok);
+            ok = ok && weight > 0.0 && weight <= kMaxWeight;
+        } else if (ok && name == QLatin1String("difficulty")) {
+            ok = ParseDifficulty(value, &difficulty);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            *error = QStringLiteral("无效的选项 '%1'").arg(option);
+            return false;
+        }
+    }
+
+    if (label.isEmpty()) {
+        *error = QStringLiteral("label 不能为空");
+        return false;
+    }
+    for (QChar ch : label) {
+        if (!IsTypable(ch)) {
+            *error = QStringLiteral("label 只能包含 ASCII 字符");
+            return false;
+        }
+    }
+
+    record->min_difficulty = static_cast<quint8>(difficulty);
+    record->weight = static_cast<float>(weight);
+    record->label_offset = strings.Add(label.toLatin1());
+    record->sequence_offset = strings.Add(sequence);
+    return true;
+}
+
+bool ReadHeader(QFile &file, PackHeader *header) {
+    return file.read(reinterpret_cast<char *>(header), sizeof(*header)) == sizeof(*header) &&
+           std::memcmp(header->magic, kMagic, sizeof(header->magic)) == 0 &&
+           header->version == kVersion &&
+           header->record_size == sizeof(PackItemRecord) &&
+           header->endian_tag == kEndianTag &&
+           header->item_count <= static_cast<quint32>(DrillPack::kMaxItems) &&
+           header->strings_size > 0 &&
+           header->name_offset < header->strings_size &&
+           file.size() == static_cast<qint64>(sizeof(PackHeader)) +
+                              static_cast<qint64>(header->item_count) * sizeof(PackItemRecord) +
+                              header->strings_size;
+}
+
+}  // namespace
+
+DrillPack::~DrillPack() {
+    Close();
+}
+
+QString DrillPack::DefaultDirectory() {
+    return SessionLog::DefaultDirectory() + QStringLiteral("/packs");
+}
+
+QVector<DrillPack::Info> DrillPack::List(const QString &directory) {
+    QDir dir(directory);
+    const QStringList files = dir.entryList({QStringLiteral("*.lhtdrill"), QStringLiteral("*.lhtpack")},
+                                            QDir::Files);
+    QStringList ids;
+    for (const QString &file : files) {
+        ids.append(QFileInfo(file).completeBaseName());
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    QVector<Info> packs;
+    packs.reserve(ids.size());
+    for (const QString &id : ids) {
+        Info info;
+        info.id = id;
+        info.name = id;
+
+        packs.append(info);
+        Info &entry = packs.last();
+        if (!EnsureCompiled(directory, id, &entry.error)) {
+            continue;
+        }
+
+        QFile file(PackPath(directory, id));
+        PackHeader header;
+        if (!file.open(QIODevice::ReadOnly) || !ReadHeader(file, &header)) {
+            entry.error = QStringLiteral("文件损坏或版本不符");
+            continue;
+        }
+        entry.item_count = static_cast<int>(header.item_count);
+        const qint64 strings_start = static_cast<qint64>(sizeof(PackHeader)) +
+                                     static_cast<qint64>(header.item_count) * sizeof(PackItemRecord);
+        file.seek(strings_start + header.name_offset);
+        QByteArray name = file.read(header.strings_size - header.name_offset);
+        name.truncate(name.indexOf('\0'));
+        if (!name.isEmpty()) {
+            entry.name = QString::fromUtf8(name);
+        }
+    }
+    return packs;
+}
+
+bool DrillPack::Compile(const QString &source_path, const QString &pack_path, QString *error) {
+    QFile source(source_path);
+    if (!source.open(QIODevice::ReadOnly)) {
+        *error = QStringLiteral("无法读取 %1").arg(source_path);
+        return false;
+    }
+
+    StringTable strings;
+    QVector<PackItemRecord> records;
+    QString name = QFileInfo(source_path).completeBaseName();
+
+    const QStringList lines = QString::fromUtf8(source.readAll()).split(QLatin1Char('\n'));
+    for (int i = 0; i < lines.size(); ++i) {
+        const QString line = lines.at(i).simplified();
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) {
+            continue;
+        }
+        const QStringList tokens = line.split(QLatin1Char(' '));
+        if (tokens.at(0) == QLatin1String("name")) {
+            name = line.mid(tokens.at(0).size()).trimmed();
+            continue;
+        }
+
+        PackItemRecord record;
+        QString item_error;
+        if (!ParseItem(tokens, strings, &record, &item_error)) {
+            *error = QStringLiteral("第 %1 行: %2").arg(i + 1).arg(item_error);
+            return false;
+        }
+        records.append(record);
+        if (records.size() > kMaxItems) {
+            *error = QStringLiteral("条目过多, 最多 %1 个").arg(kMaxItems);
+            return false;
+        }
+    }
+    if (records.isEmpty()) {
+        *error = QStringLiteral("没有训练条目");
+        return false;
+    }
+
+    PackHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(header.magic));
+    header.version = kVersion;
+    header.record_size = sizeof(PackItemRecord);
+    header.endian_tag = kEndianTag;
+    header.item_count = static_cast<quint32>(records.size());
+    header.name_offset = strings.Add(name.toUtf8());
+    header.strings_size = static_cast<quint32>(strings.Data().size());
+
+    const qint64 records_bytes = static_cast<qint64>(records.size()) * sizeof(PackItemRecord);
+    const char *records_data = reinterpret_cast<const char *>(records.constData());
+    header.content_hash = Fnv1a(strings.Data().constData(), strings.Data().size(),
+                                Fnv1a(records_data, records_bytes));
+
+    QSaveFile file(pack_path);
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header) ||
+        file.write(records_data, records_bytes) != records_bytes ||
+        file.write(strings.Data()) != strings.Data().size()) {
+        file.cancelWriting();
+        *error = QStringLiteral("无法写入 %1").arg(pack_path);
+        return false;
+    }
+    if (!file.commit()) {
+        *error = QStringLiteral("无法写入 %1").arg(pack_path);
+        return false;
+    }
+    return true;
+}
+
+bool DrillPack::Open(const QString &directory, const QString &id, QString *error) {
+    Close();
+
+    QString message;
+    if (!EnsureCompiled(directory, id, &message)) {
+        if (error) *error = message;
+        return false;
+    }
+
+    file_.setFileName(PackPath(directory, id));
+    PackHeader header;
+    if (!file_.open(QIODevice::ReadOnly) || !ReadHeader(file_, &header)) {
+        if (error) *error = QStringLiteral("文件损坏或版本不符");
+        Close();
+        return false;
+    }
+    map_ = file_.map(0, file_.size());
+    if (!map_) {
+        if (error) *error = QStringLiteral("无法映射文件");
+        Close();
+        return false;
+    }
+
+    const uchar *record_data = map_ + sizeof(PackHeader);
+    const char *strings = reinterpret_cast<const char *>(
+        record_data + static_cast<qint64>(header.item_count) * sizeof(PackItemRecord));
+    // Every offset below is checked against the table, and the table ends
+    // in a NUL, so no string can run past the mapping
+    if (strings[header.strings_size - 1] != '\0') {
+        if (error) *error = QStringLiteral("文件损坏或版本不符");
+        Close();
+        return false;
+    }
+
+    items_.reserve(static_cast<int>(header.item_count));
+    weights_.reserve(static_cast<int>(header.item_count));
+    for (quint32 i = 0; i < header.item_count; ++i) {
+        PackItemRecord record;
+        std::memcpy(&record, record_data + i * sizeof(PackItemRecord), sizeof(record));
+
+        const TrainingItem item = {static_cast<TrainingType>(record.type),
+                                   strings + qMin(record.label_offset, header.strings_size - 1),
+                                   strings + qMin(record.sequence_offset, header.strings_size - 1),
+                                   record.key,
+                                   record.modifiers,
+                                   static_cast<Difficulty>(record.min_difficulty)};
+        const bool text = item.type == TrainingType::kSingleKey ||
+                          item.type == TrainingType::kSequence;
+        const bool valid = record.type <= static_cast<quint8>(TrainingType::kSpecialKey) &&
+                           record.min_difficulty <= static_cast<quint8>(Difficulty::kAdvanced) &&
+                           record.label_offset < header.strings_size &&
+                           record.sequence_offset < header.strings_size &&
+                           item.label[0] != '\0' &&
+                           (text ? (item.SequenceLength() >= 1 &&
+                                    item.SequenceLength() <= KeyMatcher::kMaxSteps)
+                                 : item.key != 0) &&
+                           record.weight > 0.0f && record.weight <= kMaxWeight;
+        if (!valid) {
+            if (error) *error = QStringLiteral("条目 %1 无效").arg(i + 1);
+            Close();
+            return false;
+        }
+        items_.append(item);
+        weights_.append(record.weight);
+    }
+
+    id_ = id;
+    name_ = QString::fromUtf8(strings + header.name_offset);
+    if (name_.isEmpty()) {
+        name_ = id;
+    }
+    hash_ = header.content_hash;
+    return true;
+}
+
+void DrillPack::Close() {
+    items_.clear();
+    weights_.clear();
+    if (map_) {
+        file_.unmap(map_);
+        map_ = nullptr;
+    }
+    if (file_.isOpen()) {
+        file_.close();
+    }
+    id_.clear();
+    name_.clear();
+    hash_ = 0;
+}
+
+bool DrillPack::EnsureCompiled(const QString &directory, const QString &id, QString *error) {
+    const QFileInfo source(SourcePath(directory, id));
+    if (!source.exists()) {
+        // Shared as a compiled pack only
+        return true;
+    }
+    const QFileInfo pack(PackPath(directory, id));
+    if (pack.exists() && pack.lastModified() >= source.lastModified()) {
+        // A pack from an older compiler is rebuilt from its source
+        QFile file(pack.filePath());
+        PackHeader header;
+        if (file.open(QIODevice::ReadOnly) && ReadHeader(file, &header)) {
+            return true;
+        }
+    }
+    return Compile(source.filePath(), pack.filePath(), error);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include "training_catalog.h"
+
+// User-defined training items, shared as files in DefaultDirectory().
+//
+// A pack is written as a text source, <id>.lhtdrill, one item per line:
+//
+//     # Zerg inject cycle
+//     name 虫族注卵循环
+//     single   q                         weight=2
+//     combo    Ctrl+Shift+2              difficulty=intermediate
+//     special  F1
+//     sequence 4v4v  label=Inject        weight=3 difficulty=advanced
+//
+// and compiled into <id>.lhtpack: a fixed header, one fixed-size record per
+// item and a string table. Opening a pack maps that file and points the
+// items' strings straight into the mapping, so nothing is parsed or copied
+// at startup. Sources are compiled when their binary is missing or older.
+class DrillPack {
+public:
+    // Items a pack may hold; also bounds the item ids in key traces
+    static constexpr int kMaxItems = 4096;
+
+    // Header fields of an installed pack, for listing without opening it
+    struct Info {
+        QString id;             // file base name
+        QString name;
+        int item_count = 0;
+        QString error;          // compile or format error, empty if usable
+    };
+
+    DrillPack() = default;
+    ~DrillPack();
+    DrillPack(const DrillPack &) = delete;
+    DrillPack &operator=(const DrillPack &) = delete;
+
+    static QString DefaultDirectory();
+    // Every pack in directory, reading only headers
+    static QVector<Info> List(const QString &directory);
+    static bool Compile(const QString &source_path, const QString &pack_path, QString *error);
+
+    bool Open(const QString &directory, const QString &id, QString *error = nullptr);
+    void Close();
+    bool IsOpen() const { return map_ != nullptr; }
+
+    const QString &Id() const { return id_; }
+    const QString &Name() const { return name_; }
+    // Content hash, recorded in key traces to pin the pack they need
+    quint32 Hash() const { return hash_; }
+
+    int ItemCount() const { return items_.size(); }
+    const TrainingItem &Item(int index) const { return items_.at(index); }
+    // Relative draw weight, 1.0 by default
+    double Weight(int index) const { return weights_.at(index); }
+
+private:
+    // Compiles <id>.lhtdrill if <id>.lhtpack is missing or older
+    static bool EnsureCompiled(const QString &directory, const QString &id, QString *error);
+
+    QFile file_;
+    uchar *map_ = nullptr;
+    QString id_;
+    QString name_;
+    quint32 hash_ = 0;
+    QVector<TrainingItem> items_;   // strings point into map_
+    QVector<double> weights_;
+};
@@ -0,0 +1,195 @@
+#include "field_label.h"
+
+#include <QEvent>
+#include <QFontMetricsF>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QtMath>
+
+namespace {
+
+const char kNumberChars[] = "0123456789.-:";
+
+QStaticText MakeStaticText(const QString &text, const QFont &font) {
+    QStaticText result(text);
+    result.setTextFormat(Qt::PlainText);
+    result.setPerformanceHint(QStaticText::AggressiveCaching);
+    result.prepare(QTransform(), font);
+    return result;
+}
+
+}  // namespace
+
+FieldLabel::FieldLabel(QWidget *parent)
+    : QWidget(parent) {
+    setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Fixed);
+    line_height_ = QFontMetricsF(font()).height();
+    WarmGlyphs();
+}
+
+void FieldLabel::AddText(const QString &text) {
+    Segment segment;
+    segment.text = MakeStaticText(text, font());
+    segment.width = segment.text.size().width();
+    segments_.append(segment);
+}
+
+int FieldLabel::AddField() {
+    const int field = fields_.Count();
+    fields_.Resize(field + 1);
+    // Resize() clears the fields; start them out as placeholders
+    for (int i = 0; i <= field; ++i) {
+        fields_.SetPlaceholder(i);
+    }
+    Segment segment;
+    segment.field = field;
+    segments_.append(segment);
+    return field;
+}
+
+void FieldLabel::SetInt(int field, qint64 value, int min_digits) {
+    FieldsChanged(fields_.SetInt(field, value, min_digits));
+}
+
+void FieldLabel::SetFixed(int field, double value, int decimals) {
+    FieldsChanged(fields_.SetFixed(field, value, decimals));
+}
+
+void FieldLabel::SetClock(int field, qint64 seconds) {
+    FieldsChanged(fields_.SetClock(field, seconds));
+}
+
+void FieldLabel::SetPlaceholder(int field) {
+    FieldsChanged(fields_.SetPlaceholder(field));
+}
+
+void FieldLabel::ShowMessage(const QString &message) {
+    if (showing_message_ && message_.text() == message) {
+        return;
+    }
+    showing_message_ = true;
+    message_ = MakeStaticText(message, font());
+    hinted_width_ = 0;
+    updateGeometry();
+    update();
+}
+
+void FieldLabel::SetAlignment(Qt::Alignment alignment) {
+    alignment_ = alignment;
+    update();
+}
+
+QSize FieldLabel::sizeHint() const {
+    return QSize(qMax(hinted_width_, qCeil(ContentWidth())), qCeil(line_height_));
+}
+
+QSize FieldLabel::minimumSizeHint() const {
+    return QSize(0, sizeHint().height());
+}
+
+void FieldLabel::paintEvent(QPaintEvent *event) {
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.setPen(palette().color(foregroundRole()));
+
+    const qreal width = ContentWidth();
+    qreal x = 0.0;
+    if (alignment_ & Qt::AlignHCenter) {
+        x = (this->width() - width) / 2.0;
+    } else if (alignment_ & Qt::AlignRight) {
+        x = this->width() - width;
+    }
+    const qreal y = (height() - line_height_) / 2.0;
+
+    if (showing_message_) {
+        painter.drawStaticText(QPointF(x, y), message_);
+        return;
+    }
+    for (const Segment &segment : segments_) {
+        if (segment.field < 0) {
+            painter.drawStaticText(QPointF(x, y), segment.text);
+            x += segment.width;
+            continue;
+        }
+        const char *data = fields_.Data(segment.field);
+        const int length = fields_.Length(segment.field);
+        for (int i = 0; i < length; ++i) {
+            const char c = data[i];
+            painter.drawStaticText(QPointF(x, y), Glyph(c));
+            x += advances_[static_cast<uchar>(c) & 0x7f];
+        }
+    }
+}
+
+void FieldLabel::changeEvent(QEvent *event) {
+    QWidget::changeEvent(event);
+    if (event->type() == QEvent::FontChange) {
+        Relayout();
+    }
+}
+
+void FieldLabel::FieldsChanged(bool changed) {
+    if (!changed && !showing_message_) {
+        return;
+    }
+    showing_message_ = false;
+    const int width = qCeil(ContentWidth());
+    if (width > hinted_width_) {
+        hinted_width_ = width;
+        updateGeometry();
+    }
+    update();
+}
+
+const QStaticText &FieldLabel::Glyph(char c) {
+    const int index = static_cast<uchar>(c) & 0x7f;
+    if (!glyph_ready_[index]) {
+        glyphs_[index] = MakeStaticText(QString(QLatin1Char(static_cast<char>(index))), font());
+        advances_[index] = QFontMetricsF(font()).horizontalAdvance(QLatin1Char(static_cast<char>(index)));
+        glyph_ready_[index] = true;
+    }
+    return glyphs_[index];
+}
+
+qreal FieldLabel::ContentWidth() const {
+    if (showing_message_) {
+        return message_.text().isEmpty() ? 0.0 : message_.size().width();
+    }
+    qreal width = 0.0;
+    for (const Segment &segment : segments_) {
+        if (segment.field < 0) {
+            width += segment.width;
+            continue;
+        }
+        const char *data = fields_.Data(segment.field);
+        const int length = fields_.Length(segment.field);
+        for (int i = 0; i < length; ++i) {
+            const int index = static_cast<uchar>(data[i]) & 0x7f;
+            // Characters outside kNumberChars are measured when first painted
+            width += glyph_ready_[index] ? advances_[index] : line_height_ / 2.0;
+        }
+    }
+    return width;
+}
+
+void FieldLabel::Relayout() {
+    for (Segment &segment : segments_) {
+        if (segment.field < 0) {
+            segment.text.prepare(QTransform(), font());
+            segment.width = segment.text.size().width();
+        }
+    }
+    message_.prepare(QTransform(), font());
+    line_height_ = QFontMetricsF(font()).height();
+    glyph_ready_.fill(false);
+    WarmGlyphs();
+    hinted_width_ = 0;
+    updateGeometry();
+    update();
+}
+
+void FieldLabel::WarmGlyphs() {
+    for (const char *c = kNumberChars; *c; ++c) {
+        Glyph(*c);
+    }
+}
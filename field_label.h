@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QStaticText>
+#include <QString>
+#include <QVector>
+#include <QWidget>
+
+#include <array>
+
+#include "text_fields.h"
+
+class QEvent;
+class QPaintEvent;
+
+// One line of fixed text with numeric fields in between, e.g.
+// "完成: 12/15   正确率: 80.0%". The fixed parts are laid out once into
+// QStaticText; numbers are drawn character by character from a per-font
+// cache of QStaticText glyphs. Changing a value and repainting therefore
+// allocates nothing, unlike formatting a QString for a QLabel. A plain
+// message can stand in for the fields, e.g. before a session starts.
+class FieldLabel : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit FieldLabel(QWidget *parent = nullptr);
+
+    // Layout, built once: fixed text and fields in display order
+    void AddText(const QString &text);
+    // Returns the field index for the setters
+    int AddField();
+
+    // Switch back from a message to the fields; repaint only on change
+    void SetInt(int field, qint64 value, int min_digits = 1);
+    void SetFixed(int field, double value, int decimals);
+    void SetClock(int field, qint64 seconds);
+    void SetPlaceholder(int field);
+
+    // Shown instead of the fields until the next setter call; empty hides
+    // the text
+    void ShowMessage(const QString &message);
+
+    void SetAlignment(Qt::Alignment alignment);
+
+    QSize sizeHint() const override;
+    QSize minimumSizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void changeEvent(QEvent *event) override;
+
+private:
+    struct Segment {
+        int field = -1;             // into fields_, or -1 for fixed text
+        QStaticText text;
+        qreal width = 0.0;
+    };
+
+    // Called after a field changed
+    void FieldsChanged(bool changed);
+    const QStaticText &Glyph(char c);
+    qreal ContentWidth() const;
+    void Relayout();                // after a font change
+    // Lays out the characters numbers use, so painting never has to
+    void WarmGlyphs();
+
+    QVector<Segment> segments_;
+    TextFields fields_;
+    bool showing_message_ = true;
+    QStaticText message_;
+    Qt::Alignment alignment_ = Qt::AlignLeft | Qt::AlignVCenter;
+    int hinted_width_ = 0;          // grows only, so the layout stays put
+    qreal line_height_ = 0.0;
+
+    // Printable ASCII, laid out on first use
+    std::array<QStaticText, 128> glyphs_;
+    std::array<qreal, 128> advances_{};
+    std::array<bool, 128> glyph_ready_{};
+};
@@ -0,0 +1,217 @@
+#include "headless_runner.h"
+
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QVector>
+
+#include <cstdio>
+#include <cstring>
+
+#include "drill_pack.h"
+#include "key_trace.h"
+#include "reaction_timing.h"
+#include "session_log.h"
+#include "training_engine.h"
+
+namespace HeadlessRunner {
+
+namespace {
+
+void PrintUsage(const QString &program) {
+    std::fprintf(stderr,
+                 "usage: %s --headless --replay FILE [--replay FILE]... [--iterations N]\n"
+                 "       [--drill-pack ID] [--persist DIR]\n",
+                 qPrintable(program));
+}
+
+QJsonObject ReactionJson(const ReactionSummary &reaction) {
+    QJsonObject json;
+    json[QStringLiteral("count")] = reaction.count;
+    json[QStringLiteral("min_ns")] = static_cast<double>(reaction.min_ns);
+    json[QStringLiteral("median_ns")] = static_cast<double>(reaction.median_ns);
+    json[QStringLiteral("p95_ns")] = static_cast<double>(reaction.p95_ns);
+    json[QStringLiteral("p99_ns")] = static_cast<double>(reaction.p99_ns);
+    return json;
+}
+
+// The session record TrainerWindow would have saved for the replayed session
+SessionLogRecord ToLogRecord(const KeyTrace &trace, const ReplayResult &result) {
+    SessionLogRecord record;
+    record.timestamp_ms = trace.started_ms;
+    record.duration_us = result.elapsed_ns / 1000;
+    record.total_rounds = result.rounds_total;
+    record.correct_rounds = result.rounds_correct;
+    record.difficulty = trace.difficulty;
+    record.mode = trace.mode;
+    record.reaction_count = result.reaction.count;
+    record.reaction_min_ns = result.reaction.min_ns;
+    record.reaction_median_ns = result.reaction.median_ns;
+    record.reaction_p95_ns = result.reaction.p95_ns;
+    record.reaction_p99_ns = result.reaction.p99_ns;
+    return record;
+}
+
+}  // namespace
+
+bool Requested(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int Run(const QStringList &arguments) {
+    QStringList trace_paths;
+    int iterations = 1;
+    QString pack_id;
+    QString persist_directory;
+    for (int i = 1; i < arguments.size(); ++i) {
+        const QString &arg = arguments.at(i);
+        const bool has_value = i + 1 < arguments.size();
+        if (arg == QLatin1String("--headless")) {
+            continue;
+        } else if (arg == QLatin1String("--replay") && has_value) {
+            trace_paths.append(arguments.at(++i));
+        } else if (arg == QLatin1String("--iterations") && has_value) {
+            iterations = qMax(1, arguments.at(++i).toInt());
+        } else if (arg == QLatin1String("--drill-pack") && has_value) {
+            pack_id = arguments.at(++i);
+        } else if (arg == QLatin1String("--persist") && has_value) {
+            persist_directory = arguments.at(++i);
+        } else {
+            PrintUsage(arguments.value(0));
+            return 2;
+        }
+    }
+    if (trace_paths.isEmpty()) {
+        PrintUsage(arguments.value(0));
+        return 2;
+    }
+
+    QVector<KeyTrace> traces;
+    for (const QString &path : trace_paths) {
+        KeyTrace trace;
+        if (!trace.Load(path)) {
+            std::fprintf(stderr, "cannot read trace %s\n", qPrintable(path));
+            return 1;
+        }
+        traces.append(trace);
+    }
+
+    TrainingEngine engine;
+    DrillPack pack;
+    if (!pack_id.isEmpty()) {
+        QString error;
+        if (!pack.Open(DrillPack::DefaultDirectory(), pack_id, &error)) {
+            std::fprintf(stderr, "cannot open drill pack %s: %s\n",
+                         qPrintable(pack_id), qPrintable(error));
+            return 1;
+        }
+        engine.SetDrillPack(&pack);
+    }
+
+    SessionLog log(persist_directory);
+    if (!persist_directory.isEmpty() && !log.Open()) {
+        std::fprintf(stderr, "cannot open session log in %s\n", qPrintable(persist_directory));
+        return 1;
+    }
+
+    // Results of the first pass; later passes must reproduce them exactly
+    QVector<ReplayResult> first_results;
+    first_results.reserve(traces.size());
+    qint64 keys = 0;
+    qint64 replay_ns = 0;
+    qint64 persist_ns = 0;
+    int persisted = 0;
+    qint64 persisted_keystrokes = 0;
+    int item_mismatches = 0;
+    int divergences = 0;
+    int skipped = 0;
+
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        for (int t = 0; t < traces.size(); ++t) {
+            const qint64 start_ns = ReactionClock::NowNs();
+            const ReplayResult result = engine.Replay(traces.at(t));
+            replay_ns += ReactionClock::NowNs() - start_ns;
+            keys += result.keys;
+            item_mismatches += result.item_mismatches;
+
+            if (iteration == 0) {
+                first_results.append(result);
+                skipped += (result.pack_mismatch || result.state_mismatch) ? 1 : 0;
+            } else {
+                const ReplayResult &first = first_results.at(t);
+                if (result.rounds_total != first.rounds_total ||
+                    result.rounds_correct != first.rounds_correct ||
+                    result.elapsed_ns != first.elapsed_ns ||
+                    result.reaction.median_ns != first.reaction.median_ns) {
+                    ++divergences;
+                }
+            }
+
+            if (log.IsOpen() && !result.pack_mismatch && !result.state_mismatch) {
+                const qint64 persist_start_ns = ReactionClock::NowNs();
+                log.AppendSession(ToLogRecord(traces.at(t), result), engine.Keystrokes());
+                persist_ns += ReactionClock::NowNs() - persist_start_ns;
+                ++persisted;
+                persisted_keystrokes += engine.Keystrokes().size();
+            }
+        }
+    }
+
+    QJsonArray trace_results;
+    for (int t = 0; t < traces.size(); ++t) {
+        const ReplayResult &result = first_results.at(t);
+        QJsonObject json;
+        json[QStringLiteral("path")] = QFileInfo(trace_paths.at(t)).fileName();
+        json[QStringLiteral("pack_mismatch")] = result.pack_mismatch;
+        json[QStringLiteral("state_mismatch")] = result.state_mismatch;
+        json[QStringLiteral("events")] = result.events;
+        json[QStringLiteral("keys")] = result.keys;
+        json[QStringLiteral("item_mismatches")] = result.item_mismatches;
+        json[QStringLiteral("rounds_total")] = result.rounds_total;
+        json[QStringLiteral("rounds_correct")] = result.rounds_correct;
+        json[QStringLiteral("elapsed_ns")] = static_cast<double>(result.elapsed_ns);
+        json[QStringLiteral("reaction")] = ReactionJson(result.reaction);
+        trace_results.append(json);
+    }
+
+    QJsonObject replay;
+    replay[QStringLiteral("keys")] = static_cast<double>(keys);
+    replay[QStringLiteral("elapsed_ns")] = static_cast<double>(replay_ns);
+    replay[QStringLiteral("ns_per_key")] =
+        (keys > 0) ? static_cast<double>(replay_ns) / static_cast<double>(keys) : 0.0;
+    replay[QStringLiteral("keys_per_second")] =
+        (replay_ns > 0) ? 1e9 * static_cast<double>(keys) / static_cast<double>(replay_ns) : 0.0;
+    replay[QStringLiteral("item_mismatches")] = item_mismatches;
+    // Passes after the first that scored any trace differently
+    replay[QStringLiteral("divergences")] = divergences;
+    // Traces recorded with another drill pack than the one given, or whose
+    // scheduler state could not be restored
+    replay[QStringLiteral("skipped_traces")] = skipped;
+
+    QJsonObject root;
+    root[QStringLiteral("iterations")] = iterations;
+    root[QStringLiteral("drill_pack")] = pack_id;
+    root[QStringLiteral("traces")] = trace_results;
+    root[QStringLiteral("replay")] = replay;
+    if (log.IsOpen()) {
+        QJsonObject persist;
+        persist[QStringLiteral("sessions")] = persisted;
+        persist[QStringLiteral("keystrokes")] = static_cast<double>(persisted_keystrokes);
+        persist[QStringLiteral("elapsed_ns")] = static_cast<double>(persist_ns);
+        persist[QStringLiteral("ns_per_session")] =
+            (persisted > 0) ? static_cast<double>(persist_ns) / persisted : 0.0;
+        root[QStringLiteral("persist")] = persist;
+    }
+
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+    std::fwrite(json.constData(), 1, static_cast<size_t>(json.size()), stdout);
+    return (divergences > 0) ? 3 : 0;
+}
+
+}  // namespace HeadlessRunner
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QStringList>
+
+// Command-line mode without a window, for automated load tests. Replays key
+// traces through TrainingEngine, optionally writes every replayed session to
+// a session log, and prints the metrics as one JSON object on stdout.
+//
+//   LeftHandTrainer --headless --replay FILE [--replay FILE]... [--iterations N]
+//                   [--drill-pack ID] [--persist DIR]
+namespace HeadlessRunner {
+
+// Whether the command line asks for headless mode; checked before any
+// QApplication exists so no window system is needed
+bool Requested(int argc, char *argv[]);
+
+// Runs with a QCoreApplication; returns the process exit code
+int Run(const QStringList &arguments);
+
+}  // namespace HeadlessRunner
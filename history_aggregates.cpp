@@ -0,0 +1,162 @@
+#include "history_aggregates.h"
+
+#include <QFile>
+#include <QSaveFile>
+
+#include "session_log.h"
+#include "training_catalog.h"
+
+double HistoryAggregates::KeyTotals::Accuracy() const {
+    const qint64 attempts = Attempts();
+    return (attempts > 0) ? (100.0 * static_cast<double>(correct) / static_cast<double>(attempts))
+                          : 0.0;
+}
+
+qint64 HistoryAggregates::KeyTotals::MeanReactionNs() const {
+    return (reaction_count > 0) ? reaction_total_ns / reaction_count : 0;
+}
+
+int HistoryAggregates::KeySlot(int key) {
+    // Slot 0 stays unused so a zeroed record field means "unknown"
+    if (key >= 0x20 && key < 0x7f) {
+        return key - 0x20 + 1;
+    }
+    if (key >= Qt::Key_Escape && key < Qt::Key_Escape + (kKeySlots - 96)) {
+        return key - Qt::Key_Escape + 96;
+    }
+    return 0;
+}
+
+void HistoryAggregates::Reset() {
+    data_ = Data();
+}
+
+void HistoryAggregates::Add(const SessionLogRecord &record,
+                            const KeystrokeLogRecord *keystrokes, int keystroke_count) {
+    const double seconds = static_cast<double>(record.duration_us) / 1e6;
+    const double speed = (seconds > 0) ? (60.0 * record.total_rounds / seconds) : 0.0;
+    const double accuracy = (record.total_rounds > 0)
+                                ? (100.0 * record.correct_rounds / record.total_rounds)
+                                : 0.0;
+
+    data_.session_count++;
+    data_.best_speed = qMax(data_.best_speed, speed);
+    data_.best_accuracy = qMax(data_.best_accuracy, accuracy);
+    data_.total_rounds += record.total_rounds;
+    data_.total_correct += record.correct_rounds;
+    data_.total_duration_us += record.duration_us;
+
+    if (record.difficulty < kDifficultyCount) {
+        DifficultyTotals &totals = data_.per_difficulty[record.difficulty];
+        totals.sessions++;
+        totals.rounds += record.total_rounds;
+        totals.correct += record.correct_rounds;
+        totals.duration_us += record.duration_us;
+    }
+
+    data_.recent_speed[data_.recent_next] = speed;
+    data_.recent_accuracy[data_.recent_next] = accuracy;
+    data_.recent_next = (data_.recent_next + 1) % kRollingWindow;
+    data_.recent_count = qMin(data_.recent_count + 1, kRollingWindow);
+
+    for (int i = 0; i < keystroke_count; ++i) {
+        const KeystrokeLogRecord &keystroke = keystrokes[i];
+        const bool too_slow = keystroke.result == static_cast<quint8>(KeystrokeResult::kTooSlow);
+        // A timed step always follows the previous key of its sequence
+        if (keystroke.step_gap_100us > 0 && i > 0) {
+            data_.transitions.Add(keystrokes[i - 1].key, keystroke.key,
+                                  static_cast<qint64>(keystroke.step_gap_100us) * 100000, too_slow);
+        }
+
+        if (too_slow || keystroke.result == static_cast<quint8>(KeystrokeResult::kMiss)) {
+            // Charged to the key that should have been pressed
+            if (keystroke.expected_slot > 0 && keystroke.expected_slot < kKeySlots) {
+                data_.per_key[keystroke.expected_slot].missed++;
+            }
+            continue;
+        }
+
+        const int slot = KeySlot(keystroke.key);
+        if (slot == 0) {
+            continue;
+        }
+        KeyTotals &totals = data_.per_key[slot];
+        totals.correct++;
+
+        // A sequence's reaction belongs to its first key, not the one that
+        // completed it, so only single-step prompts give a key reaction time
+        if (keystroke.result == static_cast<quint8>(KeystrokeResult::kComplete) &&
+            keystroke.reaction_ns > 0 &&
+            keystroke.item_id >= 0 && keystroke.item_id < TrainingCatalog::kItemCount &&
+            TrainingCatalog::At(keystroke.item_id).type != TrainingType::kSequence) {
+            totals.reaction_count++;
+            totals.reaction_total_ns += keystroke.reaction_ns;
+        }
+    }
+}
+
+bool HistoryAggregates::Load(const QString &path, qint64 expected_sessions) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    Data data;
+    if (file.read(reinterpret_cast<char *>(&data), sizeof(data)) != sizeof(data) ||
+        data.magic != kMagic ||
+        data.version != kVersion ||
+        data.session_count != expected_sessions ||
+        data.recent_count < 0 || data.recent_count > kRollingWindow ||
+        data.recent_next < 0 || data.recent_next >= kRollingWindow) {
+        return false;
+    }
+
+    data_ = data;
+    return true;
+}
+
+bool HistoryAggregates::Save(const QString &path) const {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    if (file.write(reinterpret_cast<const char *>(&data_), sizeof(data_)) != sizeof(data_)) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+const HistoryAggregates::DifficultyTotals &HistoryAggregates::Totals(int difficulty) const {
+    static const DifficultyTotals kEmpty;
+    if (difficulty < 0 || difficulty >= kDifficultyCount) {
+        return kEmpty;
+    }
+    return data_.per_difficulty[difficulty];
+}
+
+const HistoryAggregates::KeyTotals &HistoryAggregates::Key(int key) const {
+    return data_.per_key[KeySlot(key)];
+}
+
+double HistoryAggregates::RollingSpeed() const {
+    if (data_.recent_count == 0) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for (int i = 0; i < data_.recent_count; ++i) {
+        sum += data_.recent_speed[i];
+    }
+    return sum / data_.recent_count;
+}
+
+double HistoryAggregates::RollingAccuracy() const {
+    if (data_.recent_count == 0) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for (int i = 0; i < data_.recent_count; ++i) {
+        sum += data_.recent_accuracy[i];
+    }
+    return sum / data_.recent_count;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+#include "transition_matrix.h"
+
+struct KeystrokeLogRecord;
+struct SessionLogRecord;
+
+// Summary statistics over the whole session log, maintained incrementally as
+// sessions are appended so the history page never rescans the log.
+class HistoryAggregates {
+public:
+    static constexpr int kDifficultyCount = 4;
+    static constexpr int kRollingWindow = 10;
+    // Printable ASCII keys plus Qt's first 64 special keys (Tab, F1-F12, ...)
+    static constexpr int kKeySlots = 160;
+
+    struct DifficultyTotals {
+        qint64 sessions = 0;
+        qint64 rounds = 0;
+        qint64 correct = 0;
+        qint64 duration_us = 0;
+    };
+
+    // Per physical key, over every keystroke in the log
+    struct KeyTotals {
+        qint64 correct = 0;         // correct presses of the key
+        qint64 missed = 0;          // misses while the key was expected
+        qint64 reaction_count = 0;  // single-step prompts answered with the key
+        qint64 reaction_total_ns = 0;
+
+        qint64 Attempts() const { return correct + missed; }
+        double Accuracy() const;    // percent, 0 without attempts
+        qint64 MeanReactionNs() const;
+    };
+
+    // Slot of a Qt::Key in the per-key table, 0 if the key is not tracked
+    static int KeySlot(int key);
+
+    void Reset();
+    void Add(const SessionLogRecord &record,
+             const KeystrokeLogRecord *keystrokes = nullptr, int keystroke_count = 0);
+
+    // Loads the cached aggregates; fails if missing, corrupt or not matching
+    // the number of sessions in the log, in which case the caller rebuilds.
+    bool Load(const QString &path, qint64 expected_sessions);
+    bool Save(const QString &path) const;
+
+    qint64 SessionCount() const { return data_.session_count; }
+    double BestSpeed() const { return data_.best_speed; }
+    double BestAccuracy() const { return data_.best_accuracy; }
+    qint64 TotalRounds() const { return data_.total_rounds; }
+    qint64 TotalCorrect() const { return data_.total_correct; }
+    qint64 TotalDurationUs() const { return data_.total_duration_us; }
+    const DifficultyTotals &Totals(int difficulty) const;
+    const KeyTotals &Key(int key) const;
+    // Key-to-key times inside sequences, over every session
+    const TransitionMatrix &Transitions() const { return data_.transitions; }
+
+    // Averages over the last kRollingWindow sessions
+    double RollingSpeed() const;
+    double RollingAccuracy() const;
+
+private:
+    // On-disk layout, written as-is
+    struct Data {
+        quint32 magic = kMagic;
+        quint32 version = kVersion;
+        qint64 session_count = 0;
+        double best_speed = 0.0;
+        double best_accuracy = 0.0;
+        qint64 total_rounds = 0;
+        qint64 total_correct = 0;
+        qint64 total_duration_us = 0;
+        DifficultyTotals per_difficulty[kDifficultyCount];
+        double recent_speed[kRollingWindow] = {};
+        double recent_accuracy[kRollingWindow] = {};
+        qint32 recent_count = 0;
+        qint32 recent_next = 0;
+        KeyTotals per_key[kKeySlots];
+        TransitionMatrix transitions;
+    };
+
+    static constexpr quint32 kMagic = 0x4c485441;    // "LHTA"
+    static constexpr quint32 kVersion = 3;
+
+    Data data_;
+};
@@ -0,0 +1,140 @@
+#include "history_list_model.h"
+
+#include <QDateTime>
+#include <QFontMetrics>
+#include <QPainter>
+
+// ===== HistoryListModel =====
+
+HistoryListModel::HistoryListModel(const SessionLog *log, QObject *parent)
+    : QAbstractListModel(parent),
+      log_(log) {
+    Reload();
+}
+
+void HistoryListModel::Reload() {
+    beginResetModel();
+    loaded_rows_ = qMin(kFetchBatch, log_->SessionCount());
+    endResetModel();
+}
+
+int HistoryListModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : loaded_rows_;
+}
+
+QVariant HistoryListModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= loaded_rows_) {
+        return QVariant();
+    }
+
+    const int count = log_->SessionCount();
+    const int session = count - 1 - index.row();
+    if (session < 0) {
+        return QVariant();
+    }
+
+    switch (role) {
+        case kLinesRole:
+            return FormatLines(log_->Session(session));
+        case Qt::DisplayRole:
+        case Qt::ToolTipRole:
+            return FormatLines(log_->Session(session)).join(QLatin1Char('\n'));
+        default:
+            return QVariant();
+    }
+}
+
+bool HistoryListModel::canFetchMore(const QModelIndex &parent) const {
+    return !parent.isValid() && loaded_rows_ < log_->SessionCount();
+}
+
+void HistoryListModel::fetchMore(const QModelIndex &parent) {
+    if (parent.isValid()) {
+        return;
+    }
+    const int remaining = log_->SessionCount() - loaded_rows_;
+    const int batch = qMin(kFetchBatch, remaining);
+    if (batch <= 0) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), loaded_rows_, loaded_rows_ + batch - 1);
+    loaded_rows_ += batch;
+    endInsertRows();
+}
+
+QStringList HistoryListModel::FormatLines(const SessionLogRecord &record) {
+    static const QStringList diff_names = {QStringLiteral("入门"), QStringLiteral("进阶"),
+                                           QStringLiteral("高级"), QStringLiteral("自定义")};
+    static const QStringList mode_names = {QStringLiteral("无尽"), QStringLiteral("计时"),
+                                           QStringLiteral("挑战"), QStringLiteral("禅")};
+
+    const double seconds = static_cast<double>(record.duration_us) / 1e6;
+    const double speed = (seconds > 0) ? (60.0 * record.total_rounds / seconds) : 0.0;
+    const double accuracy = (record.total_rounds > 0)
+                                ? (100.0 * record.correct_rounds / record.total_rounds)
+                                : 0.0;
+
+    QStringList lines;
+    lines.reserve(4);
+    lines.append(QDateTime::fromMSecsSinceEpoch(record.timestamp_ms)
+                     .toString(QStringLiteral("yyyy-MM-dd hh:mm")));
+    lines.append(QStringLiteral("难度: %1 | 模式: %2")
+                     .arg(diff_names.value(record.difficulty))
+                     .arg(mode_names.value(record.mode)));
+    lines.append(QStringLiteral("正确: %1/%2 | 正确率: %3% | 速度: %4 轮/分钟")
+                     .arg(record.correct_rounds)
+                     .arg(record.total_rounds)
+                     .arg(QString::number(accuracy, 'f', 1))
+                     .arg(QString::number(speed, 'f', 1)));
+    if (record.reaction_count > 0) {
+        lines.append(QStringLiteral("反应时间: 中位 %1 ms | P95 %2 ms")
+                         .arg(QString::number(record.reaction_median_ns / 1e6, 'f', 0))
+                         .arg(QString::number(record.reaction_p95_ns / 1e6, 'f', 0)));
+    } else {
+        lines.append(QStringLiteral("反应时间: --"));
+    }
+    return lines;
+}
+
+// ===== HistoryItemDelegate =====
+
+void HistoryItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
+                                const QModelIndex &index) const {
+    const QStringList lines = index.data(HistoryListModel::kLinesRole).toStringList();
+
+    painter->save();
+
+    if (option.state & QStyle::State_Selected) {
+        painter->fillRect(option.rect, option.palette.highlight());
+        painter->setPen(option.palette.color(QPalette::HighlightedText));
+    } else {
+        painter->setPen(option.palette.color(QPalette::Text));
+    }
+
+    const QRect area = option.rect.adjusted(kPaddingX, kPaddingY, -kPaddingX, -kPaddingY);
+    const int line_height = QFontMetrics(option.font).height();
+
+    QFont title_font = option.font;
+    title_font.setBold(true);
+
+    for (int i = 0; i < lines.size() && i < kLineCount; ++i) {
+        painter->setFont(i == 0 ? title_font : option.font);
+        const QRect line_rect(area.x(), area.y() + i * line_height, area.width(), line_height);
+        painter->drawText(line_rect, Qt::AlignLeft | Qt::AlignVCenter,
+                          painter->fontMetrics().elidedText(lines.at(i), Qt::ElideRight,
+                                                            line_rect.width()));
+    }
+
+    // Separator between sessions
+    painter->setPen(option.palette.color(QPalette::Mid));
+    painter->drawLine(option.rect.bottomLeft(), option.rect.bottomRight());
+
+    painter->restore();
+}
+
+QSize HistoryItemDelegate::sizeHint(const QStyleOptionViewItem &option,
+                                    const QModelIndex &index) const {
+    Q_UNUSED(index);
+    const int line_height = QFontMetrics(option.font).height();
+    return QSize(option.rect.width(), kLineCount * line_height + 2 * kPaddingY + 1);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QStyledItemDelegate>
+
+#include "session_log.h"
+
+// Newest-first list of sessions read straight from the memory-mapped log.
+// No rows are cached: rows are fetched lazily in batches as the view scrolls
+// and each visible row is decoded from the mapping on demand, so memory use
+// does not grow with the history.
+class HistoryListModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    enum Role {
+        kLinesRole = Qt::UserRole + 1      // QStringList, one entry per line
+    };
+
+    explicit HistoryListModel(const SessionLog *log, QObject *parent = nullptr);
+
+    // Call after the log changed (session saved or history cleared)
+    void Reload();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    static QStringList FormatLines(const SessionLogRecord &record);
+
+private:
+    const SessionLog *log_;
+    int loaded_rows_ = 0;
+
+    static constexpr int kFetchBatch = 200;
+};
+
+// Paints one session as a fixed-height block of four text lines
+class HistoryItemDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+
+public:
+    using QStyledItemDelegate::QStyledItemDelegate;
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option,
+               const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option,
+                   const QModelIndex &index) const override;
+
+private:
+    static constexpr int kLineCount = 4;
+    static constexpr int kPaddingX = 8;
+    static constexpr int kPaddingY = 6;
+};
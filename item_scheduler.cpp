@@ -0,0 +1,300 @@
+#include "item_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+ItemScheduler::ItemScheduler()
+    : rng_(QRandomGenerator::global()->generate()) {
+}
+
+void ItemScheduler::SetPool(const QVector<int> &item_ids, const QVector<double> &base_weights) {
+    pool_ = item_ids;
+    base_weights_ = (base_weights.size() == item_ids.size()) ? base_weights : QVector<double>();
+    cooldown_position_ = -1;
+
+    int max_id = -1;
+    for (int id : pool_) {
+        max_id = qMax(max_id, id);
+    }
+    if (stats_.size() <= max_id) {
+        stats_.resize(max_id + 1);
+    }
+
+    weights_.resize(pool_.size());
+    for (int i = 0; i < pool_.size(); ++i) {
+        weights_[i] = PositionWeight(i);
+    }
+    RebuildTree();
+}
+
+void ItemScheduler::ForgetItems(int first_id) {
+    if (first_id >= stats_.size()) {
+        return;
+    }
+    for (int id = qMax(0, first_id); id < stats_.size(); ++id) {
+        stats_[id] = ItemStats();
+    }
+    for (int i = 0; i < pool_.size(); ++i) {
+        if (pool_.at(i) < first_id) {
+            continue;
+        }
+        if (i == cooldown_position_) {
+            cooldown_weight_ = PositionWeight(i);
+        } else {
+            weights_[i] = PositionWeight(i);
+        }
+    }
+    RebuildTree();
+}
+
+void ItemScheduler::Seed(quint32 seed) {
+    rng_.seed(seed);
+}
+
+int ItemScheduler::Next() {
+    const int n = pool_.size();
+    if (n == 0) {
+        return -1;
+    }
+    if (n == 1) {
+        return 0;
+    }
+
+    // Release the previous pick back into the pool
+    if (cooldown_position_ >= 0) {
+        SetWeight(cooldown_position_, cooldown_weight_);
+        cooldown_position_ = -1;
+    }
+
+    int position;
+    if (total_weight_ <= 0.0) {
+        position = rng_.bounded(n);
+    } else {
+        position = FindByPrefix(rng_.generateDouble() * total_weight_);
+    }
+
+    // Hold the pick back until the next draw
+    cooldown_position_ = position;
+    cooldown_weight_ = weights_.at(position);
+    SetWeight(position, 0.0);
+
+    return position;
+}
+
+void ItemScheduler::RecordResult(int position, bool missed, qint64 reaction_ns) {
+    if (position < 0 || position >= pool_.size()) {
+        return;
+    }
+
+    ItemStats &stats = stats_[pool_.at(position)];
+    const double error = missed ? 1.0 : 0.0;
+    const bool has_reaction = reaction_ns > 0;
+
+    if (stats.attempts == 0) {
+        stats.error_rate = error;
+        stats.reaction_ns = has_reaction ? static_cast<double>(reaction_ns) : 0.0;
+    } else {
+        stats.error_rate += kAlpha * (error - stats.error_rate);
+        if (has_reaction) {
+            stats.reaction_ns = (stats.reaction_ns > 0.0)
+                                    ? stats.reaction_ns + kAlpha * (reaction_ns - stats.reaction_ns)
+                                    : static_cast<double>(reaction_ns);
+        }
+    }
+    stats.attempts++;
+
+    // Other items keep the weight computed against the older global average
+    // until their own next result; recomputing all of them would be O(n).
+    if (has_reaction) {
+        global_reaction_ns_ = (global_reaction_ns_ > 0.0)
+                                  ? global_reaction_ns_ + 0.05 * (reaction_ns - global_reaction_ns_)
+                                  : static_cast<double>(reaction_ns);
+    }
+
+    const double weight = PositionWeight(position);
+    if (position == cooldown_position_) {
+        cooldown_weight_ = weight;
+    } else {
+        SetWeight(position, weight);
+    }
+}
+
+double ItemScheduler::Weight(int position) const {
+    if (position < 0 || position >= pool_.size()) {
+        return 0.0;
+    }
+    return (position == cooldown_position_) ? cooldown_weight_ : weights_.at(position);
+}
+
+namespace {
+
+struct StateHeader {
+    quint32 item_count;
+    quint32 reserved;
+    double global_reaction_ns;
+};
+
+struct StateItem {
+    qint32 attempts;
+    qint32 reserved;
+    double error_rate;
+    double reaction_ns;
+};
+
+}  // namespace
+
+QByteArray ItemScheduler::SaveState() const {
+    StateHeader header = {};
+    header.item_count = static_cast<quint32>(stats_.size());
+    header.global_reaction_ns = global_reaction_ns_;
+
+    QByteArray state(static_cast<int>(sizeof(header) + stats_.size() * sizeof(StateItem)),
+                     Qt::Uninitialized);
+    char *out = state.data();
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    for (const ItemStats &stats : stats_) {
+        StateItem item = {};
+        item.attempts = stats.attempts;
+        item.error_rate = stats.error_rate;
+        item.reaction_ns = stats.reaction_ns;
+        std::memcpy(out, &item, sizeof(item));
+        out += sizeof(item);
+    }
+    return state;
+}
+
+bool ItemScheduler::IsValidState(const QByteArray &state, int max_items) {
+    StateHeader header;
+    if (state.size() < static_cast<int>(sizeof(header))) {
+        return false;
+    }
+    std::memcpy(&header, state.constData(), sizeof(header));
+    if (header.item_count > static_cast<quint32>(qMax(0, max_items)) ||
+        static_cast<qint64>(state.size()) !=
+            static_cast<qint64>(sizeof(header)) +
+                static_cast<qint64>(header.item_count) * static_cast<qint64>(sizeof(StateItem))) {
+        return false;
+    }
+    // The statistics feed straight into the weights; a NaN or a negative
+    // count would poison the Fenwick tree
+    if (!std::isfinite(header.global_reaction_ns) || header.global_reaction_ns < 0.0) {
+        return false;
+    }
+    const char *in = state.constData() + sizeof(header);
+    for (quint32 i = 0; i < header.item_count; ++i) {
+        StateItem item;
+        std::memcpy(&item, in, sizeof(item));
+        in += sizeof(item);
+        if (item.attempts < 0 || !std::isfinite(item.error_rate) || item.error_rate < 0.0 ||
+            item.error_rate > 1.0 || !std::isfinite(item.reaction_ns) || item.reaction_ns < 0.0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ItemScheduler::RestoreState(const QByteArray &state, int max_items) {
+    if (!IsValidState(state, max_items)) {
+        return false;
+    }
+    StateHeader header;
+    std::memcpy(&header, state.constData(), sizeof(header));
+
+    stats_.resize(static_cast<int>(header.item_count));
+    const char *in = state.constData() + sizeof(header);
+    for (ItemStats &stats : stats_) {
+        StateItem item;
+        std::memcpy(&item, in, sizeof(item));
+        in += sizeof(item);
+        stats.attempts = item.attempts;
+        stats.error_rate = item.error_rate;
+        stats.reaction_ns = item.reaction_ns;
+    }
+    global_reaction_ns_ = header.global_reaction_ns;
+
+    // Recompute every weight from the restored statistics
+    SetPool(QVector<int>(pool_), QVector<double>(base_weights_));
+    return true;
+}
+
+double ItemScheduler::ComputeWeight(const ItemStats &stats) const {
+    if (stats.attempts == 0) {
+        return kNewItemWeight;
+    }
+
+    double slowness = 0.0;
+    if (global_reaction_ns_ > 0.0 && stats.reaction_ns > 0.0) {
+        slowness = qBound(0.0, stats.reaction_ns / global_reaction_ns_ - 1.0, kMaxSlowness);
+    }
+    return 1.0 + kErrorWeight * stats.error_rate + kSlownessWeight * slowness;
+}
+
+double ItemScheduler::PositionWeight(int position) const {
+    const double weight = adaptive_ ? ComputeWeight(stats_.at(pool_.at(position))) : 1.0;
+    return base_weights_.isEmpty() ? weight : weight * base_weights_.at(position);
+}
+
+void ItemScheduler::SetWeight(int position, double weight) {
+    // Unchanged weights must not count towards a rebuild either: with
+    // adaptive draws off, the tree then only depends on the draws made
+    if (weight == weights_.at(position)) {
+        return;
+    }
+    const double delta = weight - weights_.at(position);
+    weights_[position] = weight;
+    total_weight_ += delta;
+
+    const int n = pool_.size();
+    for (int i = position + 1; i <= n; i += i & -i) {
+        tree_[i] += delta;
+    }
+
+    if (++updates_since_rebuild_ >= kRebuildInterval) {
+        RebuildTree();
+    }
+}
+
+void ItemScheduler::RebuildTree() {
+    const int n = pool_.size();
+    tree_.fill(0.0, n + 1);
+    total_weight_ = 0.0;
+
+    for (int i = 1; i <= n; ++i) {
+        tree_[i] += weights_.at(i - 1);
+        total_weight_ += weights_.at(i - 1);
+        const int parent = i + (i & -i);
+        if (parent <= n) {
+            tree_[parent] += tree_[i];
+        }
+    }
+    updates_since_rebuild_ = 0;
+}
+
+int ItemScheduler::FindByPrefix(double target) const {
+    const int n = pool_.size();
+
+    // Skip whole Fenwick ranges whose sum does not exceed the target; the
+    // item right after them is the one whose cumulative weight crosses it.
+    int position = 0;
+    int step = 1;
+    while (step * 2 <= n) {
+        step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+        const int next = position + step;
+        if (next <= n && tree_.at(next) <= target) {
+            position = next;
+            target -= tree_.at(next);
+        }
+    }
+
+    position = qMin(position, n - 1);
+
+    // Rounding can land on a zero-weight item at the very end of a range
+    while (position > 0 && weights_.at(position) <= 0.0) {
+        --position;
+    }
+    return position;
+}
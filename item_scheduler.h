@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QByteArray>
+#include <QRandomGenerator>
+#include <QVector>
+#include <QtGlobal>
+
+// Adaptive item selection. Items the player misses or answers slowly are
+// drawn more often, spaced-repetition style. Weights live in a Fenwick tree
+// so both drawing an item and updating one after a result are O(log n).
+class ItemScheduler {
+public:
+    ItemScheduler();
+
+    // Pool entries are stable item ids (indices into the full catalog).
+    // Learned statistics are kept per id and survive pool changes.
+    // base_weights, if given, scale each entry's adaptive weight.
+    void SetPool(const QVector<int> &item_ids, const QVector<double> &base_weights = {});
+    // Drops learned statistics of ids >= first_id, e.g. when the items
+    // behind those ids were replaced
+    void ForgetItems(int first_id);
+    int PoolSize() const { return pool_.size(); }
+
+    void Seed(quint32 seed);
+    // Off: results are still learned but draws use the base weights only,
+    // so the seed alone fixes the order (races). Applies from the next
+    // SetPool().
+    void SetAdaptive(bool adaptive) { adaptive_ = adaptive; }
+
+    // Returns a pool position, or -1 if the pool is empty
+    int Next();
+
+    // Result of one presentation of the item at pool position
+    void RecordResult(int position, bool missed, qint64 reaction_ns);
+
+    double Weight(int position) const;
+
+    // Learned statistics as an opaque blob, so a replay can start from the
+    // state a recorded session started from. Restoring keeps the pool and
+    // fails, changing nothing, unless IsValidState(state, max_items).
+    QByteArray SaveState() const;
+    bool RestoreState(const QByteArray &state, int max_items);
+    // Whether state is a well-formed blob of at most max_items item ids
+    static bool IsValidState(const QByteArray &state, int max_items);
+
+private:
+    struct ItemStats {
+        int attempts = 0;
+        double error_rate = 0.0;     // EWMA of "missed at least once"
+        double reaction_ns = 0.0;    // EWMA of reaction time
+    };
+
+    double ComputeWeight(const ItemStats &stats) const;
+    double PositionWeight(int position) const;
+    void SetWeight(int position, double weight);
+    void RebuildTree();
+    int FindByPrefix(double target) const;
+
+    QVector<int> pool_;             // pool position -> item id
+    QVector<double> base_weights_;  // pool position -> weight scale, empty for 1.0
+    QVector<double> weights_;       // pool position -> current weight
+    QVector<double> tree_;          // Fenwick tree over weights_, 1-based
+    QVector<ItemStats> stats_;      // item id -> learned statistics
+    double total_weight_ = 0.0;
+    double global_reaction_ns_ = 0.0;
+    int updates_since_rebuild_ = 0;
+    bool adaptive_ = true;
+
+    // Position held back so the same prompt is not shown twice in a row
+    int cooldown_position_ = -1;
+    double cooldown_weight_ = 0.0;
+
+    QRandomGenerator rng_;
+
+    static constexpr double kAlpha = 0.3;            // EWMA smoothing
+    static constexpr double kNewItemWeight = 3.0;
+    static constexpr double kErrorWeight = 6.0;
+    static constexpr double kSlownessWeight = 2.0;
+    static constexpr double kMaxSlowness = 2.0;
+    // Floating point drift from incremental updates is reset periodically
+    static constexpr int kRebuildInterval = 4096;
+};
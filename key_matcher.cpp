@@ -0,0 +1,84 @@
+#include "key_matcher.h"
+
+namespace {
+
+constexpr quint32 kComboModifiers =
+    quint32(Qt::ControlModifier) | quint32(Qt::ShiftModifier) |
+    quint32(Qt::AltModifier) | quint32(Qt::MetaModifier);
+// Ctrl and Meta turn a letter into a shortcut rather than text
+constexpr quint32 kTextModifiers = quint32(Qt::ControlModifier) | quint32(Qt::MetaModifier);
+
+}  // namespace
+
+void KeyMatcher::Load(const TrainingItem &item) {
+    position_ = 0;
+    missed_position_ = 0;
+    length_ = 0;
+    text_ = false;
+
+    switch (item.type) {
+        case TrainingType::kSingleKey:
+        case TrainingType::kSequence: {
+            text_ = true;
+            for (const char *ch = item.sequence; *ch && length_ < kMaxSteps; ++ch) {
+                KeyStep &step = steps_[length_++];
+                step.key = KeyForChar(*ch);
+                step.modifiers = 0;
+                step.care_mask = kTextModifiers;
+            }
+            Q_ASSERT(item.sequence[length_] == '\0');
+            break;
+        }
+        case TrainingType::kCombo: {
+            KeyStep &step = steps_[length_++];
+            step.key = item.key;
+            step.modifiers = static_cast<quint32>(item.modifiers) & kComboModifiers;
+            step.care_mask = kComboModifiers;
+            break;
+        }
+        case TrainingType::kSpecialKey: {
+            KeyStep &step = steps_[length_++];
+            step.key = item.key;
+            step.modifiers = 0;
+            step.care_mask = 0;
+            break;
+        }
+    }
+}
+
+KeyMatcher::Outcome KeyMatcher::Feed(int key, Qt::KeyboardModifiers modifiers) {
+    if (length_ == 0) {
+        return Outcome::kIgnored;
+    }
+    // Function, navigation and other non-printing keys are not typing mistakes
+    if (text_ && key >= Qt::Key_Escape) {
+        return Outcome::kIgnored;
+    }
+
+    if (!steps_[position_].Matches(key, static_cast<quint32>(modifiers))) {
+        missed_position_ = position_;
+        position_ = 0;
+        return Outcome::kMiss;
+    }
+
+    ++position_;
+    if (position_ < length_) {
+        return Outcome::kStep;
+    }
+    position_ = 0;
+    return Outcome::kComplete;
+}
+
+void KeyMatcher::RejectLastStep() {
+    // A completed item has already wrapped back to position 0
+    missed_position_ = (position_ > 0 ? position_ : length_) - 1;
+    position_ = 0;
+}
+
+int KeyMatcher::KeyForChar(char ch) {
+    // Qt::Key values of Latin-1 keys are the uppercase character codes
+    if (ch >= 'a' && ch <= 'z') {
+        return Qt::Key_A + (ch - 'a');
+    }
+    return static_cast<uchar>(ch);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Qt>
+#include <QtGlobal>
+
+#include "training_catalog.h"
+
+// One expected key press: the key code plus the modifiers that must be held.
+// Only modifiers in care_mask are compared, so text steps accept Shift
+// (which only changes case) while combos require the exact modifier set.
+struct KeyStep {
+    int key = 0;                // Qt::Key_*
+    quint32 modifiers = 0;      // required, within care_mask
+    quint32 care_mask = 0;
+
+    bool Matches(int pressed_key, quint32 pressed_modifiers) const {
+        return pressed_key == key && (pressed_modifiers & care_mask) == modifiers;
+    }
+};
+
+// Expected-input state machine for the current TrainingItem. Every item type
+// compiles to a short list of steps, so a key event is matched with integer
+// compares only and never touches event text or allocates.
+class KeyMatcher {
+public:
+    enum class Outcome {
+        kIgnored,       // key does not count for this item
+        kMiss,
+        kStep,          // correct, more steps to go
+        kComplete
+    };
+
+    static constexpr int kMaxSteps = 8;
+
+    void Load(const TrainingItem &item);
+    // Restart the current item from its first step
+    void Reset() { position_ = 0; }
+
+    Outcome Feed(int key, Qt::KeyboardModifiers modifiers);
+    // Turns the step just accepted into a miss on that step (e.g. it came
+    // too late) and restarts the item
+    void RejectLastStep();
+
+    int Position() const { return position_; }
+    int Length() const { return length_; }
+    const KeyStep &Expected() const { return steps_[position_]; }
+    // Step that the last kMiss failed on
+    const KeyStep &LastMissed() const { return steps_[missed_position_]; }
+    // Whether the item is typed text (single keys, sequences)
+    bool IsText() const { return text_; }
+
+    // Qt key code for a printable catalog character, e.g. 'q' -> Qt::Key_Q
+    static int KeyForChar(char ch);
+
+private:
+    KeyStep steps_[kMaxSteps];
+    int length_ = 0;
+    int position_ = 0;
+    int missed_position_ = 0;
+    bool text_ = false;
+};
@@ -0,0 +1,139 @@
+#include "key_trace.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#include <cstring>
+
+#include "session_log.h"
+#include "training_engine.h"
+
+namespace {
+
+constexpr char kMagic[8] = {'L', 'H', 'T', 'T', 'R', 'A', 'C', 'E'};
+constexpr quint32 kVersion = 4;
+constexpr quint32 kEndianTag = 0x01020304;
+
+// Followed by scheduler_state_size bytes, then event_count TraceEvents
+struct TraceHeader {
+    char magic[8];
+    quint32 version;
+    quint32 event_size;
+    quint32 endian_tag;
+    quint32 seed;
+    qint64 started_ms;
+    qint64 latency_offset_ns;
+    qint32 target_rounds;
+    qint32 time_limit_seconds;
+    quint8 difficulty;
+    quint8 mode;
+    quint8 custom_types;
+    quint8 flags;
+    quint32 scheduler_state_size;
+    quint32 event_count;
+    quint32 drill_pack_hash;
+    qint32 sequence_gap_budget_ms;
+    quint32 reserved1;
+};
+static_assert(sizeof(TraceHeader) == 72, "TraceHeader layout changed");
+
+}  // namespace
+
+bool KeyTrace::Save(const QString &path) const {
+    TraceHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(header.magic));
+    header.version = kVersion;
+    header.event_size = sizeof(TraceEvent);
+    header.endian_tag = kEndianTag;
+    header.seed = seed;
+    header.started_ms = started_ms;
+    header.latency_offset_ns = latency_offset_ns;
+    header.target_rounds = target_rounds;
+    header.time_limit_seconds = time_limit_seconds;
+    header.difficulty = difficulty;
+    header.mode = mode;
+    header.custom_types = custom_types;
+    header.flags = flags;
+    header.scheduler_state_size = static_cast<quint32>(scheduler_state.size());
+    header.event_count = static_cast<quint32>(events.size());
+    header.drill_pack_hash = drill_pack_hash;
+    header.sequence_gap_budget_ms = sequence_gap_budget_ms;
+
+    const qint64 events_bytes = static_cast<qint64>(events.size()) * sizeof(TraceEvent);
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header) ||
+        file.write(scheduler_state) != scheduler_state.size() ||
+        file.write(reinterpret_cast<const char *>(events.constData()), events_bytes) != events_bytes) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+bool KeyTrace::Load(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    TraceHeader header;
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header) ||
+        std::memcmp(header.magic, kMagic, sizeof(header.magic)) != 0 ||
+        header.version != kVersion ||
+        header.event_size != sizeof(TraceEvent) ||
+        header.endian_tag != kEndianTag) {
+        return false;
+    }
+    // Both end up as enum values; anything else is a damaged file
+    if (header.difficulty > static_cast<quint8>(Difficulty::kCustom) ||
+        header.mode > static_cast<quint8>(TrainingMode::kZen)) {
+        return false;
+    }
+
+    const qint64 events_bytes = static_cast<qint64>(header.event_count) * sizeof(TraceEvent);
+    if (file.size() != static_cast<qint64>(sizeof(header)) + header.scheduler_state_size + events_bytes) {
+        return false;
+    }
+
+    QByteArray state = file.read(header.scheduler_state_size);
+    QVector<TraceEvent> trace_events(static_cast<int>(header.event_count));
+    if (state.size() != static_cast<int>(header.scheduler_state_size) ||
+        file.read(reinterpret_cast<char *>(trace_events.data()), events_bytes) != events_bytes) {
+        return false;
+    }
+    // Replay restores the scheduler from it
+    if (!ItemScheduler::IsValidState(state, TrainingEngine::kMaxItemIds)) {
+        return false;
+    }
+
+    seed = header.seed;
+    started_ms = header.started_ms;
+    latency_offset_ns = header.latency_offset_ns;
+    target_rounds = header.target_rounds;
+    time_limit_seconds = header.time_limit_seconds;
+    difficulty = header.difficulty;
+    mode = header.mode;
+    custom_types = header.custom_types;
+    flags = header.flags;
+    drill_pack_hash = header.drill_pack_hash;
+    sequence_gap_budget_ms = header.sequence_gap_budget_ms;
+    scheduler_state = state;
+    events = trace_events;
+    return true;
+}
+
+QString KeyTrace::DefaultDirectory() {
+    return SessionLog::DefaultDirectory() + QStringLiteral("/traces");
+}
+
+void KeyTrace::Prune(const QString &directory, int keep) {
+    QDir dir(directory);
+    // Names start with the session time, so name order is age order
+    const QStringList traces = dir.entryList({QStringLiteral("*.lhtrace")}, QDir::Files,
+                                             QDir::Name | QDir::Reversed);
+    for (int i = keep; i < traces.size(); ++i) {
+        dir.remove(traces.at(i));
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+// What a trace event replays into the engine
+enum class TraceEventType : quint8 {
+    kNextItem = 0,      // item_id is the item that was drawn
+    kShowPrompt = 1,
+    kKey = 2,           // key, modifiers; item_id is the prompt it answered
+    kPause = 3,
+    kResume = 4,
+    // 5 was a per-second countdown tick; timed sessions now end at a deadline
+    kStop = 6
+};
+
+// On-disk trace event; fixed size so a trace is one header plus an array
+struct TraceEvent {
+    qint64 offset_ns = 0;           // since session start
+    qint32 key = 0;                 // Qt::Key
+    quint32 modifiers = 0;          // Qt::KeyboardModifiers
+    qint32 item_id = -1;            // index into the training item catalog
+    quint8 type = 0;                // TraceEventType
+    quint8 reserved[3] = {0, 0, 0};
+};
+static_assert(sizeof(TraceEvent) == 24, "TraceEvent layout changed");
+
+// Everything needed to run one training session again: the engine's
+// starting state and every call made into it, in order.
+struct KeyTrace {
+    quint32 seed = 0;               // item scheduler seed
+    qint64 started_ms = 0;          // session start, UTC ms since epoch
+    quint8 difficulty = 0;
+    quint8 mode = 0;
+    quint8 custom_types = 0;        // kCustom* bits
+    quint8 flags = 0;               // k* flag bits below
+    qint32 target_rounds = 0;
+    qint32 time_limit_seconds = 0;
+    qint64 latency_offset_ns = 0;
+    quint32 drill_pack_hash = 0;    // DrillPack::Hash(), 0 for the built-in catalog
+    qint32 sequence_gap_budget_ms = 0;
+    QByteArray scheduler_state;     // ItemScheduler::SaveState()
+    QVector<TraceEvent> events;
+
+    enum CustomTypeBits : quint8 {
+        kCustomSingleKeys = 1,
+        kCustomSpecialKeys = 2,
+        kCustomCombos = 4,
+        kCustomSequences = 8
+    };
+    enum FlagBits : quint8 {
+        kFixedOrder = 1             // TrainingConfig::adaptive was off
+    };
+
+    bool Save(const QString &path) const;
+    bool Load(const QString &path);
+
+    // Traces of recent sessions, next to the session log
+    static QString DefaultDirectory();
+    // Deletes all but the newest keep traces in directory
+    static void Prune(const QString &directory, int keep);
+};
@@ -0,0 +1,102 @@
+// Checks that KeyTrace::Load rejects traces whose header would index past
+// the engine's tables. Leaves the damaged traces in DIR so CTest can feed
+// them to the headless runner as well.
+//
+//   KeyTraceTest DIR
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QString>
+
+#include <cstdio>
+#include <cstring>
+
+#include "item_scheduler.h"
+#include "key_trace.h"
+#include "training_engine.h"
+
+namespace {
+
+int g_failures = 0;
+
+void Check(bool ok, const char *what) {
+    std::printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) {
+        ++g_failures;
+    }
+}
+
+KeyTrace ValidTrace() {
+    KeyTrace trace;
+    trace.seed = 1234;
+    trace.difficulty = static_cast<quint8>(Difficulty::kAdvanced);
+    trace.mode = static_cast<quint8>(TrainingMode::kEndless);
+    trace.scheduler_state = ItemScheduler().SaveState();
+    TraceEvent stop;
+    stop.type = static_cast<quint8>(TraceEventType::kStop);
+    trace.events.append(stop);
+    return trace;
+}
+
+// Saves trace to path and reports whether it loads back
+bool RoundTrip(const KeyTrace &trace, const QString &path) {
+    if (!trace.Save(path)) {
+        std::fprintf(stderr, "cannot write %s\n", qPrintable(path));
+        return false;
+    }
+    KeyTrace loaded;
+    return loaded.Load(path);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s DIR\n", argv[0]);
+        return 2;
+    }
+    const QDir dir(QString::fromLocal8Bit(argv[1]));
+    if (!QDir().mkpath(dir.path())) {
+        std::fprintf(stderr, "cannot create %s\n", argv[1]);
+        return 2;
+    }
+
+    Check(RoundTrip(ValidTrace(), dir.filePath(QStringLiteral("valid.lhtrace"))),
+          "valid trace loads");
+
+    KeyTrace custom = ValidTrace();
+    custom.difficulty = static_cast<quint8>(Difficulty::kCustom);
+    custom.mode = static_cast<quint8>(TrainingMode::kZen);
+    Check(RoundTrip(custom, dir.filePath(QStringLiteral("last_values.lhtrace"))),
+          "last difficulty and mode load");
+
+    KeyTrace bad_difficulty = ValidTrace();
+    bad_difficulty.difficulty = static_cast<quint8>(Difficulty::kCustom) + 1;
+    Check(!RoundTrip(bad_difficulty, dir.filePath(QStringLiteral("bad_difficulty.lhtrace"))),
+          "out-of-range difficulty is rejected");
+
+    KeyTrace bad_mode = ValidTrace();
+    bad_mode.mode = 0xff;
+    Check(!RoundTrip(bad_mode, dir.filePath(QStringLiteral("bad_mode.lhtrace"))),
+          "out-of-range mode is rejected");
+
+    // An item count whose byte size wraps around 32 bits
+    KeyTrace huge_state = ValidTrace();
+    const quint32 item_count = 0x10000000;
+    std::memcpy(huge_state.scheduler_state.data(), &item_count, sizeof(item_count));
+    Check(!RoundTrip(huge_state, dir.filePath(QStringLiteral("bad_scheduler_state.lhtrace"))),
+          "oversized scheduler state is rejected");
+
+    KeyTrace short_state = ValidTrace();
+    short_state.scheduler_state.chop(1);
+    Check(!RoundTrip(short_state, dir.filePath(QStringLiteral("short_scheduler_state.lhtrace"))),
+          "truncated scheduler state is rejected");
+
+    Check(TrainingCatalog::ForDifficulty(static_cast<Difficulty>(7)).IsEmpty(),
+          "ForDifficulty is empty out of range");
+    Check(TrainingCatalog::ForType(static_cast<TrainingType>(7)).IsEmpty(),
+          "ForType is empty out of range");
+
+    return g_failures == 0 ? 0 : 1;
+}
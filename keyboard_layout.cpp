@@ -0,0 +1,81 @@
+#include "keyboard_layout.h"
+
+namespace KeyboardLayout {
+
+const QVector<QVector<KeyCap>> &Rows() {
+    static const QVector<QVector<KeyCap>> rows = {
+        // Function keys row
+        {{"F1", 40, 30}, {"F2", 40, 30}, {"F3", 40, 30}, {"F4", 40, 30},
+         {"F5", 40, 30}, {"F6", 40, 30}, {"F7", 40, 30}, {"F8", 40, 30}},
+        // Keyboard rows for left hand
+        {{"`", 40, 40}, {"1", 40, 40}, {"2", 40, 40}, {"3", 40, 40},
+         {"4", 40, 40}, {"5", 40, 40}, {"6", 40, 40}},
+        {{"Tab", 60, 40}, {"Q", 40, 40}, {"W", 40, 40}, {"E", 40, 40},
+         {"R", 40, 40}, {"T", 40, 40}},
+        {{"Caps", 60, 40}, {"A", 40, 40}, {"S", 40, 40}, {"D", 40, 40},
+         {"F", 40, 40}, {"G", 40, 40}},
+        {{"Shift", 60, 40}, {"Z", 40, 40}, {"X", 40, 40}, {"C", 40, 40},
+         {"V", 40, 40}, {"B", 40, 40}},
+        {{"Ctrl", 60, 40}, {"Alt", 60, 40}, {"Space", 200, 40}},
+    };
+    return rows;
+}
+
+bool IsKeyName(const QString &name) {
+    for (const QVector<KeyCap> &row : Rows()) {
+        for (const KeyCap &cap : row) {
+            if (name == QLatin1String(cap.name)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int KeyCode(const QString &name) {
+    if (name.size() == 1) {
+        // Letters, digits and '`' share their Qt::Key code with ASCII
+        return name.at(0).toUpper().unicode();
+    }
+    if (name == QLatin1String("Tab")) return Qt::Key_Tab;
+    if (name == QLatin1String("Space")) return Qt::Key_Space;
+    if (name.startsWith(QLatin1Char('F'))) {
+        bool ok = false;
+        const int number = name.mid(1).toInt(&ok);
+        if (ok && number >= 1 && number <= 12) {
+            return Qt::Key_F1 + number - 1;
+        }
+    }
+    return 0;
+}
+
+KeyHighlightList ResolveHighlights(const QString &highlight_keys,
+                                   Qt::KeyboardModifiers mods) {
+    KeyHighlightList result;
+
+    // Modifier keys
+    if (mods & Qt::ControlModifier) {
+        result.append({QStringLiteral("Ctrl"), KeyState::kModifier});
+    }
+    if (mods & Qt::ShiftModifier) {
+        result.append({QStringLiteral("Shift"), KeyState::kModifier});
+    }
+    if (mods & Qt::AltModifier) {
+        result.append({QStringLiteral("Alt"), KeyState::kModifier});
+    }
+
+    // Target keys
+    if (highlight_keys.isEmpty()) {
+        return result;
+    }
+    if (IsKeyName(highlight_keys)) {
+        result.append({highlight_keys, KeyState::kHighlighted});
+        return result;
+    }
+    for (QChar ch : highlight_keys) {
+        result.append({QString(ch.toUpper()), KeyState::kHighlighted});
+    }
+    return result;
+}
+
+}  // namespace KeyboardLayout
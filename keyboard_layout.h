@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QString>
+#include <QVarLengthArray>
+#include <QVector>
+#include <Qt>
+
+// Visual state of one key on the virtual keyboard
+enum class KeyState {
+    kNormal,
+    kHighlighted,   // target key of the current prompt
+    kModifier       // modifier that must be held for the current prompt
+};
+
+// One key cap of the left-hand keyboard, sized in logical pixels
+struct KeyCap {
+    const char *name;   // label and lookup name, e.g. "Q", "Space"
+    int width;
+    int height;
+};
+
+// A key that should be drawn in a non-normal state
+struct KeyHighlight {
+    QString name;
+    KeyState state;
+};
+
+using KeyHighlightList = QVarLengthArray<KeyHighlight, 8>;
+
+// Historical performance of one key, shown by the heatmap overlay
+struct KeyHeat {
+    QString name;
+    qint64 attempts = 0;
+    double accuracy = 0.0;          // percent
+    qint64 mean_reaction_ns = 0;    // 0 without samples
+};
+
+using KeyHeatList = QVector<KeyHeat>;
+
+// Left-hand keyboard layout shared by every keyboard renderer.
+namespace KeyboardLayout {
+
+constexpr int kKeySpacing = 4;
+constexpr int kRowSpacing = 4;
+
+// Rows top to bottom: function keys first, then the main left-hand rows
+const QVector<QVector<KeyCap>> &Rows();
+
+bool IsKeyName(const QString &name);
+
+// Qt::Key typed by a key cap, 0 for modifiers and unknown names
+int KeyCode(const QString &name);
+
+// Resolve a prompt into the keys to light. highlight_keys is either a whole
+// key name ("Space", "F4") or a string whose characters are keys ("Q", "1").
+KeyHighlightList ResolveHighlights(const QString &highlight_keys,
+                                   Qt::KeyboardModifiers mods);
+
+}  // namespace KeyboardLayout
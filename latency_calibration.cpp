@@ -0,0 +1,52 @@
+#include "latency_calibration.h"
+
+void LatencyCalibration::Reset() {
+    stage_ = Stage::kIdle;
+    key_to_paint_.Clear();
+    key_to_frame_.Clear();
+    show_to_frame_.Clear();
+}
+
+void LatencyCalibration::BeginSample(qint64 key_ns) {
+    key_ns_ = key_ns;
+    stage_ = Stage::kKeyPressed;
+}
+
+void LatencyCalibration::MarkShown(qint64 shown_ns) {
+    if (stage_ != Stage::kKeyPressed) return;
+    shown_ns_ = shown_ns;
+    stage_ = Stage::kShown;
+}
+
+void LatencyCalibration::MarkPainted(qint64 painted_ns) {
+    if (stage_ != Stage::kShown) return;
+    painted_ns_ = painted_ns;
+    stage_ = Stage::kPainted;
+}
+
+void LatencyCalibration::MarkFrameDone(qint64 frame_ns) {
+    if (stage_ != Stage::kPainted) return;
+    key_to_paint_.Add(-1, painted_ns_ - key_ns_);
+    key_to_frame_.Add(-1, frame_ns - key_ns_);
+    show_to_frame_.Add(-1, frame_ns - shown_ns_);
+    stage_ = Stage::kIdle;
+}
+
+CalibrationResult LatencyCalibration::Result(double refresh_hz) const {
+    CalibrationResult result;
+    result.key_to_paint = key_to_paint_.Summary();
+    result.key_to_frame = key_to_frame_.Summary();
+    result.show_to_frame = show_to_frame_.Summary();
+    result.refresh_hz = refresh_hz;
+
+    // A finished frame waits on average half a refresh for the next vblank,
+    // then takes about half a refresh to scan out to the middle of the screen.
+    if (refresh_hz > 0.0) {
+        result.display_latency_ns = static_cast<qint64>(1e9 / refresh_hz);
+    }
+
+    // Reaction times are counted from ShowCurrentItem, so only the part of
+    // the pipeline after the prompt was shown delays what the player sees.
+    result.offset_ns = result.show_to_frame.median_ns + result.display_latency_ns;
+    return result;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include "reaction_timing.h"
+
+struct CalibrationResult {
+    ReactionSummary key_to_paint;   // key arrival -> prompt label painted
+    ReactionSummary key_to_frame;   // key arrival -> frame handed to the window system
+    ReactionSummary show_to_frame;  // prompt shown -> frame handed to the window system
+    double refresh_hz = 0.0;
+    qint64 display_latency_ns = 0;  // estimated vblank wait + scanout
+    qint64 offset_ns = 0;           // subtracted from every reaction time
+};
+
+// Measures the app's own input-to-photon overhead. Each sample follows one
+// keystroke through NextItem/ShowCurrentItem to the prompt repaint and the
+// end of the frame that contains it.
+class LatencyCalibration {
+public:
+    void Reset();
+
+    void BeginSample(qint64 key_ns);
+    void MarkShown(qint64 shown_ns);
+    void MarkPainted(qint64 painted_ns);
+    // Completes the pending sample
+    void MarkFrameDone(qint64 frame_ns);
+
+    bool HasPendingSample() const { return stage_ != Stage::kIdle; }
+    bool IsAwaitingPaint() const { return stage_ == Stage::kShown; }
+    int SampleCount() const { return key_to_frame_.Count(); }
+
+    CalibrationResult Result(double refresh_hz) const;
+
+private:
+    enum class Stage {
+        kIdle,
+        kKeyPressed,
+        kShown,
+        kPainted
+    };
+
+    Stage stage_ = Stage::kIdle;
+    qint64 key_ns_ = 0;
+    qint64 shown_ns_ = 0;
+    qint64 painted_ns_ = 0;
+
+    ReactionStats key_to_paint_;
+    ReactionStats key_to_frame_;
+    ReactionStats show_to_frame_;
+};
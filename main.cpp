@@ -1,12 +1,32 @@
 #include <QApplication>
+#include <QCoreApplication>
 
+#include <cstring>
+
+#include "headless_runner.h"
+#include "startup_trace.h"
 #include "trainer_window.h"
 
 int main(int argc, char *argv[]) {
+    // No window and no window system: replay traces and print JSON metrics
+    if (HeadlessRunner::Requested(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        return HeadlessRunner::Run(QCoreApplication::arguments());
+    }
+
+    // Checked before QApplication so its construction is timed too
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--startup-trace") == 0) {
+            StartupTrace::Enable();
+        }
+    }
+
     QApplication app(argc, argv);
+    StartupTrace::Mark("application");
 
     TrainerWindow window;
     window.show();
+    StartupTrace::Mark("show");
 
     return QApplication::exec();
 }
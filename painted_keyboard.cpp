@@ -0,0 +1,254 @@
+#include "painted_keyboard.h"
+
+#include <QFont>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QPair>
+#include <QPen>
+#include <QResizeEvent>
+#include <QtMath>
+
+#include <algorithm>
+
+PaintedKeyboard::PaintedKeyboard(QWidget *parent)
+    : QWidget(parent) {
+    setFocusPolicy(Qt::NoFocus);
+
+    QSizePolicy policy(QSizePolicy::Preferred, QSizePolicy::Preferred);
+    policy.setHeightForWidth(true);
+    setSizePolicy(policy);
+
+    BuildLayout();
+}
+
+void PaintedKeyboard::SetColors(const KeyboardColors &colors) {
+    colors_ = colors;
+    update();
+}
+
+void PaintedKeyboard::SetHighlights(const KeyHighlightList &highlights) {
+    QVarLengthArray<QPair<int, KeyState>, 8> wanted;
+    for (const KeyHighlight &highlight : highlights) {
+        int index = FindKey(highlight.name);
+        if (index >= 0) {
+            wanted.append(qMakePair(index, highlight.state));
+        }
+    }
+
+    // Reset keys that are no longer part of the prompt
+    for (int i = lit_keys_.size() - 1; i >= 0; --i) {
+        int index = lit_keys_.at(i);
+        bool still_wanted = std::any_of(wanted.cbegin(), wanted.cend(),
+                                        [index](const QPair<int, KeyState> &w) {
+                                            return w.first == index;
+                                        });
+        if (!still_wanted) {
+            SetKeyState(keys_[index], KeyState::kNormal);
+            lit_keys_.remove(i);
+        }
+    }
+
+    for (const auto &w : wanted) {
+        SetKeyState(keys_[w.first], w.second);
+        if (!lit_keys_.contains(w.first)) {
+            lit_keys_.append(w.first);
+        }
+    }
+}
+
+void PaintedKeyboard::SetHeatmap(const KeyHeatList &heat) {
+    for (Key &key : keys_) {
+        key.heat_color = QColor();
+        key.heat_text.clear();
+    }
+    for (const KeyHeat &entry : heat) {
+        const int index = FindKey(entry.name);
+        if (index < 0 || entry.attempts <= 0) {
+            continue;
+        }
+        // 80% or worse is fully red, 100% fully green
+        const qreal t = qBound(0.0, (entry.accuracy - 80.0) / 20.0, 1.0);
+        Key &key = keys_[index];
+        key.heat_color = QColor::fromHsvF(t / 3.0, 0.75, 0.85, 0.55);
+        key.heat_text = QString::number(entry.accuracy, 'f', 0) + QLatin1Char('%');
+        if (entry.mean_reaction_ns > 0) {
+            key.heat_text += QLatin1Char(' ') + QString::number(entry.mean_reaction_ns / 1000000);
+        }
+    }
+    update();
+}
+
+QSize PaintedKeyboard::sizeHint() const {
+    return QSize(qCeil(logical_size_.width()),
+                 qCeil(logical_size_.height()) + kTopMargin);
+}
+
+QSize PaintedKeyboard::minimumSizeHint() const {
+    // Allow shrinking to half size on small windows
+    return QSize(qCeil(logical_size_.width() / 2.0),
+                 qCeil(logical_size_.height() / 2.0) + kTopMargin);
+}
+
+bool PaintedKeyboard::hasHeightForWidth() const {
+    return true;
+}
+
+int PaintedKeyboard::heightForWidth(int width) const {
+    if (logical_size_.width() <= 0.0) {
+        return kTopMargin;
+    }
+    qreal scale = qMin(static_cast<qreal>(width) / logical_size_.width(), kMaxScale);
+    return qCeil(logical_size_.height() * scale) + kTopMargin;
+}
+
+void PaintedKeyboard::paintEvent(QPaintEvent *event) {
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    QFont key_font = font();
+    key_font.setPixelSize(qMax(1, qRound(12 * scale_)));
+    key_font.setBold(true);
+    QFont heat_font = font();
+    heat_font.setPixelSize(qMax(1, qRound(8 * scale_)));
+    painter.setFont(key_font);
+
+    const QRect dirty = event->rect();
+    const qreal radius = 4.0 * scale_;
+
+    for (const Key &key : keys_) {
+        if (!dirty.intersects(key.rect.toAlignedRect())) {
+            continue;
+        }
+
+        QColor background = colors_.key_background;
+        QColor text = colors_.key_text;
+        QColor border = colors_.key_border;
+        qreal border_width = 1.0;
+        if (key.state == KeyState::kHighlighted) {
+            background = colors_.highlight_background;
+            text = colors_.highlight_text;
+            border = colors_.highlight_border;
+            border_width = 2.0;
+        } else if (key.state == KeyState::kModifier) {
+            background = colors_.modifier_background;
+            text = colors_.modifier_text;
+            border = colors_.modifier_border;
+            border_width = 2.0;
+        }
+        border_width *= scale_;
+
+        const qreal inset = border_width / 2.0;
+        painter.setPen(QPen(border, border_width));
+        painter.setBrush(background);
+        const QRectF body = key.rect.adjusted(inset, inset, -inset, -inset);
+        painter.drawRoundedRect(body, radius, radius);
+
+        // The prompt's own highlight wins over the heatmap
+        const bool show_heat = key.heat_color.isValid() && key.state == KeyState::kNormal;
+        if (show_heat) {
+            painter.setPen(Qt::NoPen);
+            painter.setBrush(key.heat_color);
+            painter.drawRoundedRect(body, radius, radius);
+        }
+
+        painter.setPen(text);
+        if (show_heat) {
+            const QRectF label_rect(key.rect.x(), key.rect.y(), key.rect.width(),
+                                    key.rect.height() * 0.65);
+            const QRectF heat_rect(key.rect.x(), label_rect.bottom() - 2.0 * scale_,
+                                   key.rect.width(), key.rect.height() - label_rect.height());
+            painter.drawText(label_rect, Qt::AlignCenter, key.name);
+            painter.setFont(heat_font);
+            painter.drawText(heat_rect, Qt::AlignHCenter | Qt::AlignTop, key.heat_text);
+            painter.setFont(key_font);
+        } else {
+            painter.drawText(key.rect, Qt::AlignCenter, key.name);
+        }
+    }
+}
+
+void PaintedKeyboard::resizeEvent(QResizeEvent *event) {
+    QWidget::resizeEvent(event);
+    UpdateGeometry();
+}
+
+void PaintedKeyboard::BuildLayout() {
+    keys_.clear();
+    lit_keys_.clear();
+
+    const QVector<QVector<KeyCap>> &rows = KeyboardLayout::Rows();
+
+    // Widest row defines the layout width; other rows are centered
+    qreal max_width = 0.0;
+    for (const QVector<KeyCap> &row : rows) {
+        qreal row_width = 0.0;
+        for (const KeyCap &cap : row) {
+            row_width += cap.width;
+        }
+        row_width += KeyboardLayout::kKeySpacing * qMax(0, static_cast<int>(row.size()) - 1);
+        max_width = qMax(max_width, row_width);
+    }
+
+    qreal y = 0.0;
+    for (const QVector<KeyCap> &row : rows) {
+        qreal row_width = 0.0;
+        qreal row_height = 0.0;
+        for (const KeyCap &cap : row) {
+            row_width += cap.width;
+            row_height = qMax(row_height, static_cast<qreal>(cap.height));
+        }
+        row_width += KeyboardLayout::kKeySpacing * qMax(0, static_cast<int>(row.size()) - 1);
+
+        qreal x = (max_width - row_width) / 2.0;
+        for (const KeyCap &cap : row) {
+            Key key;
+            key.name = QString::fromLatin1(cap.name);
+            key.logical_rect = QRectF(x, y, cap.width, cap.height);
+            keys_.append(key);
+            x += cap.width + KeyboardLayout::kKeySpacing;
+        }
+        y += row_height + KeyboardLayout::kRowSpacing;
+    }
+
+    logical_size_ = QSizeF(max_width, qMax(0.0, y - KeyboardLayout::kRowSpacing));
+    UpdateGeometry();
+}
+
+void PaintedKeyboard::UpdateGeometry() {
+    if (logical_size_.isEmpty()) {
+        return;
+    }
+
+    qreal available_height = qMax(1, height() - kTopMargin);
+    scale_ = qMin(static_cast<qreal>(width()) / logical_size_.width(),
+                  available_height / logical_size_.height());
+    scale_ = qBound(0.1, scale_, kMaxScale);
+
+    const qreal offset_x = (width() - logical_size_.width() * scale_) / 2.0;
+    for (Key &key : keys_) {
+        const QRectF &lr = key.logical_rect;
+        key.rect = QRectF(offset_x + lr.x() * scale_,
+                          kTopMargin + lr.y() * scale_,
+                          lr.width() * scale_,
+                          lr.height() * scale_);
+    }
+    update();
+}
+
+void PaintedKeyboard::SetKeyState(Key &key, KeyState state) {
+    if (key.state == state) {
+        return;
+    }
+    key.state = state;
+    // Pad by the border so antialiased edges are repainted too
+    update(key.rect.toAlignedRect().adjusted(-2, -2, 2, 2));
+}
+
+int PaintedKeyboard::FindKey(const QString &name) const {
+    for (int i = 0; i < keys_.size(); ++i) {
+        if (keys_.at(i).name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
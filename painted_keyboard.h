@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QRectF>
+#include <QString>
+#include <QVector>
+#include <QWidget>
+
+#include "keyboard_layout.h"
+#include "theme.h"
+
+class QPaintEvent;
+class QResizeEvent;
+
+// Single-widget virtual keyboard. All keys are painted in one paintEvent from
+// a cached layout of key rects; highlight changes repaint only the keys whose
+// state changed.
+class PaintedKeyboard : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit PaintedKeyboard(QWidget *parent = nullptr);
+
+    void SetColors(const KeyboardColors &colors);
+    void SetHighlights(const KeyHighlightList &highlights);
+    // Tints keys by historical accuracy; an empty list turns the overlay off
+    void SetHeatmap(const KeyHeatList &heat);
+
+    QSize sizeHint() const override;
+    QSize minimumSizeHint() const override;
+    bool hasHeightForWidth() const override;
+    int heightForWidth(int width) const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    struct Key {
+        QString name;
+        QRectF logical_rect;    // position in unscaled layout coordinates
+        QRectF rect;            // position in widget coordinates
+        KeyState state = KeyState::kNormal;
+        // Heatmap overlay, precomputed in SetHeatmap
+        QColor heat_color;      // invalid: no data for this key
+        QString heat_text;
+    };
+
+    void BuildLayout();
+    void UpdateGeometry();
+    void SetKeyState(Key &key, KeyState state);
+    int FindKey(const QString &name) const;
+
+    QVector<Key> keys_;
+    // Keys currently in a non-normal state, as indices into keys_
+    QVector<int> lit_keys_;
+    QSizeF logical_size_;
+    qreal scale_ = 1.0;
+    KeyboardColors colors_;
+
+    // Upper bound for growing the keyboard with the window
+    static constexpr qreal kMaxScale = 2.0;
+    static constexpr int kTopMargin = 10;
+};
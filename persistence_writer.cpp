@@ -0,0 +1,71 @@
+#include "persistence_writer.h"
+
+#include <QMutexLocker>
+#include <QThread>
+
+class PersistenceWriter::Worker : public QThread {
+public:
+    explicit Worker(PersistenceWriter *owner)
+        : owner_(owner) {}
+
+protected:
+    void run() override { owner_->Run(); }
+
+private:
+    PersistenceWriter *owner_;
+};
+
+PersistenceWriter::PersistenceWriter()
+    : worker_(new Worker(this)) {
+    worker_->start(QThread::LowPriority);
+}
+
+PersistenceWriter::~PersistenceWriter() {
+    {
+        QMutexLocker locker(&mutex_);
+        stopping_ = true;
+        work_ready_.wakeAll();
+    }
+    // Run() drains the queue before it returns
+    worker_->wait();
+    delete worker_;
+}
+
+void PersistenceWriter::Post(Job job) {
+    QMutexLocker locker(&mutex_);
+    jobs_.push_back(std::move(job));
+    ++posted_;
+    work_ready_.wakeOne();
+}
+
+void PersistenceWriter::Flush() {
+    if (QThread::currentThread() == worker_) {
+        return;
+    }
+    QMutexLocker locker(&mutex_);
+    const quint64 target = posted_;
+    while (completed_ < target) {
+        work_done_.wait(&mutex_);
+    }
+}
+
+void PersistenceWriter::Run() {
+    QMutexLocker locker(&mutex_);
+    for (;;) {
+        while (jobs_.empty() && !stopping_) {
+            work_ready_.wait(&mutex_);
+        }
+        if (jobs_.empty()) {
+            return;
+        }
+        Job job = std::move(jobs_.front());
+        jobs_.pop_front();
+
+        locker.unlock();
+        job();
+        locker.relock();
+
+        ++completed_;
+        work_done_.wakeAll();
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QtGlobal>
+
+#include <deque>
+#include <functional>
+
+class QThread;
+
+// Runs file writes on one background thread, in the order they were posted,
+// so saving never stalls the caller. Jobs write through QSaveFile or append
+// to fixed-size record files, so a crash leaves either the old or the new
+// state on disk. The destructor runs every pending job before returning.
+class PersistenceWriter {
+public:
+    using Job = std::function<void()>;
+
+    PersistenceWriter();
+    ~PersistenceWriter();
+    PersistenceWriter(const PersistenceWriter &) = delete;
+    PersistenceWriter &operator=(const PersistenceWriter &) = delete;
+
+    // Any thread; only takes the queue lock
+    void Post(Job job);
+    // Blocks until every job posted before the call has run. Does nothing
+    // on the writer thread itself.
+    void Flush();
+
+private:
+    class Worker;
+
+    void Run();
+
+    QMutex mutex_;
+    QWaitCondition work_ready_;
+    QWaitCondition work_done_;
+    std::deque<Job> jobs_;
+    quint64 posted_ = 0;
+    quint64 completed_ = 0;
+    bool stopping_ = false;
+    Worker *worker_ = nullptr;
+};
@@ -0,0 +1,111 @@
+#include "profiler.h"
+
+#include <QSaveFile>
+
+#include <algorithm>
+
+namespace {
+
+constexpr int kChunkBytes = 1 << 16;
+
+}  // namespace
+
+Profiler &Profiler::Instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+const char *Profiler::StageName(ProfileStage stage) {
+    switch (stage) {
+        case ProfileStage::kKeyPress: return "keyPressEvent";
+        case ProfileStage::kNextItem: return "NextItem";
+        case ProfileStage::kShowItem: return "ShowCurrentItem";
+        case ProfileStage::kKeyboard: return "UpdateVirtualKeyboard";
+        case ProfileStage::kStats: return "UpdateStatsLabel";
+        case ProfileStage::kRender: return "RenderDirty";
+        case ProfileStage::kSaveHistory: return "SaveHistory";
+        case ProfileStage::kCount: break;
+    }
+    return "";
+}
+
+void Profiler::Record(ProfileStage stage, qint64 start_ns, qint64 end_ns) {
+    StageSamples &samples = stages_[static_cast<int>(stage)];
+    const qint64 duration_ns = end_ns - start_ns;
+    samples.durations_ns[samples.total_count % kWindow] = duration_ns;
+    samples.total_count++;
+
+    if (tracing_ && trace_.size() < kMaxTraceEvents) {
+        trace_.append({start_ns, duration_ns, stage});
+    }
+}
+
+ProfileSummary Profiler::Summary(ProfileStage stage) const {
+    const StageSamples &samples = stages_[static_cast<int>(stage)];
+    ProfileSummary summary;
+    summary.total_count = samples.total_count;
+    summary.count = static_cast<int>(qMin<qint64>(samples.total_count, kWindow));
+    if (summary.count == 0) {
+        return summary;
+    }
+
+    std::array<qint64, kWindow> sorted = samples.durations_ns;
+    std::sort(sorted.begin(), sorted.begin() + summary.count);
+    // Nearest rank, as in ReactionStats
+    const auto rank = [&summary](int percent) {
+        return qMax(0, (percent * summary.count + 99) / 100 - 1);
+    };
+    summary.p50_ns = sorted[rank(50)];
+    summary.p99_ns = sorted[rank(99)];
+    summary.max_ns = sorted[summary.count - 1];
+    return summary;
+}
+
+void Profiler::Clear() {
+    stages_.fill(StageSamples());
+    trace_.clear();
+}
+
+void Profiler::SetTracing(bool enabled) {
+    tracing_ = enabled;
+    if (enabled) {
+        trace_.clear();
+        trace_.reserve(kMaxTraceEvents);
+    }
+}
+
+bool Profiler::ExportTrace(const QString &path) const {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    const qint64 origin_ns = trace_.isEmpty() ? 0 : trace_.first().start_ns;
+    QByteArray json;
+    json.reserve(kChunkBytes + 256);
+    json += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    for (int i = 0; i < trace_.size(); ++i) {
+        const TraceEventRecord &event = trace_.at(i);
+        json += "{\"name\":\"";
+        json += StageName(event.stage);
+        json += "\",\"cat\":\"gui\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":";
+        json += QByteArray::number(static_cast<double>(event.start_ns - origin_ns) / 1e3, 'f', 3);
+        json += ",\"dur\":";
+        json += QByteArray::number(static_cast<double>(event.duration_ns) / 1e3, 'f', 3);
+        json += (i + 1 < trace_.size()) ? "},\n" : "}\n";
+        // Written in chunks so a full trace is never held as text at once
+        if (json.size() >= kChunkBytes) {
+            if (file.write(json) != json.size()) {
+                file.cancelWriting();
+                return false;
+            }
+            json.truncate(0);
+        }
+    }
+    json += "]}\n";
+    if (file.write(json) != json.size()) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include <array>
+
+#include "reaction_timing.h"
+
+// GUI hot-path stages timed by LHT_PROFILE_SCOPE
+enum class ProfileStage : quint8 {
+    kKeyPress,          // TrainerWindow::keyPressEvent
+    kNextItem,
+    kShowItem,          // ShowCurrentItem
+    kKeyboard,          // virtual keyboard highlight update
+    kStats,             // UpdateStatsLabel
+    kRender,            // one coalesced RenderDirty pass
+    kSaveHistory,       // session record and log append
+    kCount
+};
+
+struct ProfileSummary {
+    int count = 0;              // samples in the window, at most kWindow
+    qint64 total_count = 0;     // every sample since Clear()
+    qint64 p50_ns = 0;
+    qint64 p99_ns = 0;
+    qint64 max_ns = 0;
+};
+
+// Collects stage durations from the GUI thread. Each stage keeps its last
+// kWindow samples in a fixed ring, so recording never allocates; percentiles
+// are computed only when the overlay asks for them. With tracing on, every
+// sample is also kept as a Chrome trace event until kMaxTraceEvents.
+class Profiler {
+public:
+    static constexpr int kWindow = 1024;
+    static constexpr int kMaxTraceEvents = 1 << 20;
+
+    static Profiler &Instance();
+    static const char *StageName(ProfileStage stage);
+
+    void Record(ProfileStage stage, qint64 start_ns, qint64 end_ns);
+    ProfileSummary Summary(ProfileStage stage) const;
+    void Clear();
+
+    void SetTracing(bool enabled);
+    bool IsTracing() const { return tracing_; }
+    int TraceEventCount() const { return trace_.size(); }
+    // Writes the trace in Chrome's trace event format (chrome://tracing,
+    // Perfetto); timestamps are microseconds since the first event
+    bool ExportTrace(const QString &path) const;
+
+private:
+    struct StageSamples {
+        std::array<qint64, kWindow> durations_ns{};
+        qint64 total_count = 0;
+    };
+    struct TraceEventRecord {
+        qint64 start_ns;
+        qint64 duration_ns;
+        ProfileStage stage;
+    };
+
+    std::array<StageSamples, static_cast<int>(ProfileStage::kCount)> stages_{};
+    bool tracing_ = false;
+    QVector<TraceEventRecord> trace_;
+};
+
+// Times the enclosing scope into Profiler::Instance()
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileStage stage)
+        : stage_(stage), start_ns_(ReactionClock::NowNs()) {}
+    ~ProfileScope() { Profiler::Instance().Record(stage_, start_ns_, ReactionClock::NowNs()); }
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    ProfileStage stage_;
+    qint64 start_ns_;
+};
+
+// Compiled out unless built with -DLHT_PROFILE=ON
+#ifdef LHT_PROFILE
+#define LHT_PROFILE_SCOPE(stage) const ProfileScope lht_profile_scope(stage)
+#else
+#define LHT_PROFILE_SCOPE(stage) static_cast<void>(0)
+#endif
@@ -0,0 +1,124 @@
+#include "progress_chart.h"
+
+#include <QDate>
+#include <QFontMetrics>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QPen>
+#include <QResizeEvent>
+
+ProgressChart::ProgressChart(QWidget *parent)
+    : QWidget(parent) {
+    setFocusPolicy(Qt::NoFocus);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+}
+
+void ProgressChart::SetColors(const QColor &line, const QColor &background) {
+    line_color_ = line;
+    background_ = background;
+    update();
+}
+
+void ProgressChart::SetPoints(const QVector<Point> &points, const QString &unit, int decimals) {
+    points_ = points;
+    unit_ = unit;
+    decimals_ = decimals;
+
+    min_value_ = 0.0;
+    max_value_ = 0.0;
+    if (!points_.isEmpty()) {
+        min_value_ = max_value_ = points_.first().value;
+        for (const Point &point : points_) {
+            min_value_ = qMin(min_value_, point.value);
+            max_value_ = qMax(max_value_, point.value);
+        }
+        // Some headroom, and a visible range for a flat series
+        const double pad = qMax((max_value_ - min_value_) * 0.1, qMax(1e-6, max_value_ * 0.05));
+        min_value_ = qMax(0.0, min_value_ - pad);
+        max_value_ += pad;
+    }
+    RebuildLine();
+}
+
+QSize ProgressChart::sizeHint() const {
+    return QSize(480, 160);
+}
+
+void ProgressChart::paintEvent(QPaintEvent *event) {
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.fillRect(rect(), background_);
+
+    const QColor text_color = palette().color(QPalette::WindowText);
+    const QRectF plot = PlotRect();
+    const QFontMetrics metrics(font());
+
+    if (points_.isEmpty()) {
+        painter.setPen(text_color);
+        painter.drawText(rect(), Qt::AlignCenter, QStringLiteral("暂无数据"));
+        return;
+    }
+
+    // Frame, then the range on the left and the dates below
+    painter.setPen(QPen(palette().color(QPalette::Mid), 1));
+    painter.drawRect(plot);
+
+    painter.setPen(text_color);
+    const QString top = QString::number(max_value_, 'f', decimals_) + unit_;
+    const QString bottom = QString::number(min_value_, 'f', decimals_) + unit_;
+    const qreal label_width = plot.left() - kMargin;
+    painter.drawText(QRectF(0, plot.top(), label_width, metrics.height()),
+                     Qt::AlignRight | Qt::AlignTop, top);
+    painter.drawText(QRectF(0, plot.bottom() - metrics.height(), label_width, metrics.height()),
+                     Qt::AlignRight | Qt::AlignBottom, bottom);
+
+    const QRectF dates(plot.left(), plot.bottom() + 2, plot.width(), metrics.height());
+    const QString first = QDate::fromJulianDay(points_.first().day).toString(QStringLiteral("yyyy-MM-dd"));
+    painter.drawText(dates, Qt::AlignLeft | Qt::AlignTop, first);
+    if (points_.size() > 1) {
+        const QString last = QDate::fromJulianDay(points_.last().day).toString(QStringLiteral("yyyy-MM-dd"));
+        painter.drawText(dates, Qt::AlignRight | Qt::AlignTop, last);
+    }
+
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(QPen(line_color_, 1.5));
+    painter.drawPolyline(line_);
+    if (line_.size() <= kMaxDottedPoints) {
+        painter.setBrush(line_color_);
+        for (const QPointF &point : line_) {
+            painter.drawEllipse(point, 2.0, 2.0);
+        }
+    }
+}
+
+void ProgressChart::resizeEvent(QResizeEvent *event) {
+    QWidget::resizeEvent(event);
+    RebuildLine();
+}
+
+QRectF ProgressChart::PlotRect() const {
+    // Room for the value labels on the left and the dates below
+    const QFontMetrics metrics(font());
+    const QString widest = QString::number(max_value_, 'f', decimals_) + unit_;
+    const qreal left = kMargin + metrics.horizontalAdvance(widest) + kMargin;
+    const qreal bottom = kMargin + metrics.height() + 2;
+    return QRectF(left, kMargin, qMax(1.0, width() - left - kMargin),
+                  qMax(1.0, height() - kMargin - bottom));
+}
+
+void ProgressChart::RebuildLine() {
+    line_.clear();
+    if (!points_.isEmpty()) {
+        const QRectF plot = PlotRect();
+        const double range = qMax(1e-9, max_value_ - min_value_);
+        const int count = points_.size();
+        line_.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            const qreal x = (count > 1) ? plot.left() + plot.width() * i / (count - 1)
+                                        : plot.center().x();
+            const qreal y = plot.bottom() - plot.height() * (points_.at(i).value - min_value_) / range;
+            line_.append(QPointF(x, y));
+        }
+    }
+    update();
+}
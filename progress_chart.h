@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QColor>
+#include <QPolygonF>
+#include <QString>
+#include <QVector>
+#include <QWidget>
+
+class QPaintEvent;
+class QResizeEvent;
+
+// Line chart of one long-term metric, one point per period, oldest on the
+// left. Points are spaced evenly; the first and last dates label the x axis
+// and the value range labels the y axis. The polyline is rebuilt only when
+// the points or the size change.
+class ProgressChart : public QWidget {
+    Q_OBJECT
+
+public:
+    struct Point {
+        qint64 day = 0;             // Julian day, for the axis labels
+        double value = 0.0;
+    };
+
+    explicit ProgressChart(QWidget *parent = nullptr);
+
+    void SetColors(const QColor &line, const QColor &background);
+    // decimals apply to the axis labels
+    void SetPoints(const QVector<Point> &points, const QString &unit, int decimals);
+
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    QRectF PlotRect() const;
+    void RebuildLine();
+
+    QVector<Point> points_;
+    QString unit_;
+    int decimals_ = 0;
+    double min_value_ = 0.0;
+    double max_value_ = 0.0;
+    QPolygonF line_;                // in widget coordinates
+    QColor line_color_;
+    QColor background_;
+
+    static constexpr int kMargin = 6;
+    // Below this many points each one also gets a dot
+    static constexpr int kMaxDottedPoints = 60;
+};
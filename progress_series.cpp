@@ -0,0 +1,174 @@
+#include "progress_series.h"
+
+#include <QDate>
+#include <QDateTime>
+#include <QFile>
+#include <QSaveFile>
+#include <QVarLengthArray>
+
+#include <algorithm>
+
+#include "session_log.h"
+
+double ProgressBucket::KeysPerMinute() const {
+    return (duration_us > 0) ? (6e7 * static_cast<double>(keys) / static_cast<double>(duration_us))
+                             : 0.0;
+}
+
+double ProgressBucket::RoundsPerMinute() const {
+    return (duration_us > 0)
+               ? (6e7 * static_cast<double>(rounds_total) / static_cast<double>(duration_us))
+               : 0.0;
+}
+
+double ProgressBucket::Accuracy() const {
+    return (rounds_total > 0)
+               ? (100.0 * static_cast<double>(rounds_correct) / static_cast<double>(rounds_total))
+               : 0.0;
+}
+
+void ProgressBucket::Merge(const ProgressBucket &other) {
+    sessions += other.sessions;
+    duration_us += other.duration_us;
+    rounds_total += other.rounds_total;
+    rounds_correct += other.rounds_correct;
+    keys += other.keys;
+    reactions.Merge(other.reactions);
+}
+
+qint64 ProgressSeries::DayOf(qint64 timestamp_ms) {
+    return QDateTime::fromMSecsSinceEpoch(timestamp_ms).date().toJulianDay();
+}
+
+qint64 ProgressSeries::PeriodStart(ProgressPeriod period, qint64 day) {
+    const QDate date = QDate::fromJulianDay(day);
+    switch (period) {
+        case ProgressPeriod::kWeek:
+            return day - (date.dayOfWeek() - 1);
+        case ProgressPeriod::kMonth:
+            return QDate(date.year(), date.month(), 1).toJulianDay();
+        default:
+            return day;
+    }
+}
+
+void ProgressSeries::Reset() {
+    session_count_ = 0;
+    for (QVector<ProgressBucket> &buckets : buckets_) {
+        buckets.clear();
+    }
+}
+
+void ProgressSeries::Add(const SessionLogRecord &record,
+                         const KeystrokeLogRecord *keystrokes, int keystroke_count) {
+    session_count_++;
+
+    ProgressBucket session;
+    session.sessions = 1;
+    session.duration_us = record.duration_us;
+    session.rounds_total = record.total_rounds;
+    session.rounds_correct = record.correct_rounds;
+    session.keys = keystroke_count;
+
+    QVarLengthArray<qint64, 512> reactions;
+    for (int i = 0; i < keystroke_count; ++i) {
+        if (keystrokes[i].result == static_cast<quint8>(KeystrokeResult::kComplete) &&
+            keystrokes[i].reaction_ns > 0) {
+            reactions.append(keystrokes[i].reaction_ns);
+        }
+    }
+    session.reactions.Add(reactions.data(), static_cast<int>(reactions.size()));
+
+    const qint64 day = DayOf(record.timestamp_ms);
+    for (int p = 0; p < kPeriodCount; ++p) {
+        QVector<ProgressBucket> &buckets = buckets_[p];
+        session.first_day = static_cast<qint32>(PeriodStart(static_cast<ProgressPeriod>(p), day));
+
+        // Sessions arrive in time order except after a clock change
+        if (!buckets.isEmpty() && buckets.last().first_day == session.first_day) {
+            buckets.last().Merge(session);
+            continue;
+        }
+        auto it = std::lower_bound(buckets.begin(), buckets.end(), session.first_day,
+                                   [](const ProgressBucket &bucket, qint32 first_day) {
+                                       return bucket.first_day < first_day;
+                                   });
+        if (it != buckets.end() && it->first_day == session.first_day) {
+            it->Merge(session);
+        } else {
+            buckets.insert(it, session);
+        }
+    }
+}
+
+bool ProgressSeries::Load(const QString &path, qint64 expected_sessions) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    Header header;
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header) ||
+        header.magic != kMagic ||
+        header.version != kVersion ||
+        header.session_count != expected_sessions) {
+        return false;
+    }
+    qint64 expected_size = sizeof(header);
+    for (int p = 0; p < kPeriodCount; ++p) {
+        if (header.bucket_counts[p] < 0) {
+            return false;
+        }
+        expected_size += static_cast<qint64>(header.bucket_counts[p]) * sizeof(ProgressBucket);
+    }
+    if (file.size() != expected_size) {
+        return false;
+    }
+
+    QVector<ProgressBucket> buckets[kPeriodCount];
+    for (int p = 0; p < kPeriodCount; ++p) {
+        buckets[p].resize(header.bucket_counts[p]);
+        const qint64 bytes = static_cast<qint64>(buckets[p].size()) * sizeof(ProgressBucket);
+        if (file.read(reinterpret_cast<char *>(buckets[p].data()), bytes) != bytes) {
+            return false;
+        }
+        // The digests are copied in raw; a damaged one would index past its
+        // centroids when merged or queried
+        for (const ProgressBucket &bucket : buckets[p]) {
+            if (!bucket.reactions.IsValid()) {
+                return false;
+            }
+        }
+    }
+
+    session_count_ = header.session_count;
+    for (int p = 0; p < kPeriodCount; ++p) {
+        buckets_[p] = buckets[p];
+    }
+    return true;
+}
+
+bool ProgressSeries::Save(const QString &path) const {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    Header header = {};
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.session_count = session_count_;
+    for (int p = 0; p < kPeriodCount; ++p) {
+        header.bucket_counts[p] = static_cast<qint32>(buckets_[p].size());
+    }
+    bool ok = file.write(reinterpret_cast<const char *>(&header), sizeof(header)) == sizeof(header);
+    for (int p = 0; p < kPeriodCount && ok; ++p) {
+        const qint64 bytes = static_cast<qint64>(buckets_[p].size()) * sizeof(ProgressBucket);
+        ok = file.write(reinterpret_cast<const char *>(buckets_[p].constData()), bytes) == bytes;
+    }
+    if (!ok) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
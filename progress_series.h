@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include "reaction_digest.h"
+
+struct KeystrokeLogRecord;
+struct SessionLogRecord;
+
+enum class ProgressPeriod : int {
+    kDay = 0,
+    kWeek = 1,          // starting on Monday
+    kMonth = 2
+};
+
+// Totals of every session that ended in one period, on-disk layout
+struct ProgressBucket {
+    qint32 first_day = 0;           // Julian day the period starts on
+    qint32 sessions = 0;
+    qint64 duration_us = 0;
+    qint64 rounds_total = 0;
+    qint64 rounds_correct = 0;
+    qint64 keys = 0;
+    ReactionDigest reactions;       // completed prompts
+
+    double KeysPerMinute() const;
+    double RoundsPerMinute() const;
+    double Accuracy() const;        // percent, 0 without rounds
+    void Merge(const ProgressBucket &other);
+};
+
+// Long-term progress: per-day, per-week and per-month rollups of the session
+// log, maintained incrementally as sessions are appended. Reaction times are
+// kept as digests, so percentiles over any period come from merging buckets
+// rather than rescanning keystrokes. The per-session data stays in the
+// session log itself. Periods follow the local calendar of the session end.
+class ProgressSeries {
+public:
+    static constexpr int kPeriodCount = 3;
+
+    // Julian day in local time
+    static qint64 DayOf(qint64 timestamp_ms);
+    // First day of the period holding day
+    static qint64 PeriodStart(ProgressPeriod period, qint64 day);
+
+    void Reset();
+    void Add(const SessionLogRecord &record,
+             const KeystrokeLogRecord *keystrokes = nullptr, int keystroke_count = 0);
+
+    // As HistoryAggregates: fails if missing, corrupt or stale, and the
+    // caller rebuilds from the log. Every bucket's digest is checked too.
+    bool Load(const QString &path, qint64 expected_sessions);
+    bool Save(const QString &path) const;
+
+    qint64 SessionCount() const { return session_count_; }
+    // Oldest first; periods without sessions have no bucket
+    const QVector<ProgressBucket> &Buckets(ProgressPeriod period) const {
+        return buckets_[static_cast<int>(period)];
+    }
+
+private:
+    struct Header {
+        quint32 magic;
+        quint32 version;
+        qint64 session_count;
+        qint32 bucket_counts[kPeriodCount];
+        quint32 reserved;
+    };
+
+    static constexpr quint32 kMagic = 0x4c485450;    // "LHTP"
+    static constexpr quint32 kVersion = 1;
+
+    qint64 session_count_ = 0;
+    QVector<ProgressBucket> buckets_[kPeriodCount];
+};
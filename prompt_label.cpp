@@ -0,0 +1,8 @@
+#include "prompt_label.h"
+
+#include "reaction_timing.h"
+
+void PromptLabel::paintEvent(QPaintEvent *event) {
+    QLabel::paintEvent(event);
+    emit Painted(ReactionClock::NowNs());
+}
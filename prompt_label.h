@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QLabel>
+#include <QtGlobal>
+
+class QPaintEvent;
+
+// Big training prompt label. Reports the ReactionClock time right after each
+// repaint, which latency calibration uses as the "prompt painted" mark.
+class PromptLabel : public QLabel {
+    Q_OBJECT
+
+public:
+    using QLabel::QLabel;
+
+signals:
+    void Painted(qint64 painted_ns);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+};
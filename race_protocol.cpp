@@ -0,0 +1,233 @@
+#include "race_protocol.h"
+
+namespace RaceProtocol {
+
+namespace {
+
+constexpr char kMagic0 = 'L';
+constexpr char kMagic1 = 'R';
+constexpr quint8 kVersion = 1;
+constexpr int kHeaderSize = 4;
+
+void BeginPacket(QByteArray *buffer, PacketType type) {
+    // resize() keeps the capacity of a buffer that is reused every frame
+    buffer->resize(kHeaderSize);
+    char *header = buffer->data();
+    header[0] = kMagic0;
+    header[1] = kMagic1;
+    header[2] = static_cast<char>(kVersion);
+    header[3] = static_cast<char>(type);
+}
+
+void PutVarint(QByteArray *buffer, quint32 value) {
+    while (value >= 0x80) {
+        buffer->append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buffer->append(static_cast<char>(value));
+}
+
+// Zigzag, so small negative values stay short
+void PutSigned(QByteArray *buffer, qint32 value) {
+    PutVarint(buffer, (static_cast<quint32>(value) << 1) ^ static_cast<quint32>(value >> 31));
+}
+
+void PutName(QByteArray *buffer, const QString &name) {
+    const QByteArray utf8 = TrimName(name).toUtf8();
+    PutVarint(buffer, static_cast<quint32>(utf8.size()));
+    buffer->append(utf8);
+}
+
+void PutProgress(QByteArray *buffer, const Progress &progress) {
+    PutVarint(buffer, progress.race_id);
+    PutVarint(buffer, progress.sequence);
+    PutVarint(buffer, progress.rounds_total);
+    PutVarint(buffer, progress.rounds_correct);
+    PutVarint(buffer, progress.elapsed_ms);
+    PutVarint(buffer, progress.median_reaction_us);
+    buffer->append(static_cast<char>(progress.finished ? 1 : 0));
+}
+
+// Bounds-checked reader; any overrun makes the whole packet invalid
+class Reader {
+public:
+    explicit Reader(const QByteArray &packet)
+        : data_(packet.constData()), size_(packet.size()), pos_(kHeaderSize) {}
+
+    bool Ok() const { return ok_; }
+    bool AtEnd() const { return pos_ == size_; }
+
+    quint32 Varint() {
+        quint32 value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (pos_ >= size_) break;
+            const quint8 byte = static_cast<quint8>(data_[pos_++]);
+            value |= static_cast<quint32>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+        ok_ = false;
+        return 0;
+    }
+    qint32 Signed() {
+        const quint32 raw = Varint();
+        return static_cast<qint32>((raw >> 1) ^ (0u - (raw & 1)));
+    }
+    quint8 Byte() {
+        if (pos_ >= size_) {
+            ok_ = false;
+            return 0;
+        }
+        return static_cast<quint8>(data_[pos_++]);
+    }
+    QString Name() {
+        const quint32 length = Varint();
+        if (!ok_ || length > static_cast<quint32>(size_ - pos_) ||
+            length > static_cast<quint32>(kMaxNameLength * 4)) {
+            ok_ = false;
+            return QString();
+        }
+        const QString name = QString::fromUtf8(data_ + pos_, static_cast<int>(length));
+        pos_ += static_cast<int>(length);
+        return name;
+    }
+    Progress ReadProgress() {
+        Progress progress;
+        progress.race_id = Varint();
+        progress.sequence = static_cast<quint16>(Varint());
+        progress.rounds_total = Varint();
+        progress.rounds_correct = Varint();
+        progress.elapsed_ms = Varint();
+        progress.median_reaction_us = Varint();
+        progress.finished = Byte() != 0;
+        return progress;
+    }
+
+private:
+    const char *data_;
+    int size_;
+    int pos_;
+    bool ok_ = true;
+};
+
+}  // namespace
+
+bool Progress::SameState(const Progress &other) const {
+    return race_id == other.race_id && rounds_total == other.rounds_total &&
+           rounds_correct == other.rounds_correct && finished == other.finished;
+}
+
+bool IsNewer(quint16 a, quint16 b) {
+    return a != b && static_cast<quint16>(a - b) < 0x8000;
+}
+
+QString TrimName(const QString &name) {
+    return name.trimmed().left(kMaxNameLength);
+}
+
+void EncodeJoin(QByteArray *buffer, const QString &name) {
+    BeginPacket(buffer, PacketType::kJoin);
+    PutName(buffer, name);
+}
+
+void EncodeLeave(QByteArray *buffer) {
+    BeginPacket(buffer, PacketType::kLeave);
+}
+
+void EncodeStart(QByteArray *buffer, const RaceSettings &settings) {
+    BeginPacket(buffer, PacketType::kStart);
+    PutVarint(buffer, settings.race_id);
+    PutVarint(buffer, settings.seed);
+    buffer->append(static_cast<char>(settings.difficulty));
+    buffer->append(static_cast<char>(settings.mode));
+    buffer->append(static_cast<char>(settings.custom_types));
+    PutSigned(buffer, settings.target_rounds);
+    PutSigned(buffer, settings.time_limit_seconds);
+    PutSigned(buffer, settings.sequence_gap_budget_ms);
+    PutVarint(buffer, settings.drill_pack_hash);
+    PutSigned(buffer, settings.start_delay_ms);
+}
+
+void EncodeProgress(QByteArray *buffer, const Progress &progress) {
+    BeginPacket(buffer, PacketType::kProgress);
+    PutProgress(buffer, progress);
+}
+
+void EncodeStandings(QByteArray *buffer, const QVector<Standing> &standings) {
+    BeginPacket(buffer, PacketType::kStandings);
+    const int count = qMin(standings.size(), kMaxPlayers);
+    PutVarint(buffer, static_cast<quint32>(count));
+    for (int i = 0; i < count; ++i) {
+        PutName(buffer, standings.at(i).name);
+        PutProgress(buffer, standings.at(i).progress);
+    }
+}
+
+bool PeekType(const QByteArray &packet, PacketType *type) {
+    if (packet.size() < kHeaderSize || packet.at(0) != kMagic0 || packet.at(1) != kMagic1 ||
+        static_cast<quint8>(packet.at(2)) != kVersion) {
+        return false;
+    }
+    const quint8 raw = static_cast<quint8>(packet.at(3));
+    if (raw < static_cast<quint8>(PacketType::kJoin) ||
+        raw > static_cast<quint8>(PacketType::kStandings)) {
+        return false;
+    }
+    *type = static_cast<PacketType>(raw);
+    return true;
+}
+
+bool DecodeJoin(const QByteArray &packet, QString *name) {
+    Reader reader(packet);
+    *name = reader.Name();
+    return reader.Ok() && reader.AtEnd();
+}
+
+bool DecodeStart(const QByteArray &packet, RaceSettings *settings) {
+    Reader reader(packet);
+    RaceSettings decoded;
+    decoded.race_id = reader.Varint();
+    decoded.seed = reader.Varint();
+    decoded.difficulty = reader.Byte();
+    decoded.mode = reader.Byte();
+    decoded.custom_types = reader.Byte();
+    decoded.target_rounds = reader.Signed();
+    decoded.time_limit_seconds = reader.Signed();
+    decoded.sequence_gap_budget_ms = reader.Signed();
+    decoded.drill_pack_hash = reader.Varint();
+    decoded.start_delay_ms = reader.Signed();
+    if (!reader.Ok() || !reader.AtEnd()) {
+        return false;
+    }
+    *settings = decoded;
+    return true;
+}
+
+bool DecodeProgress(const QByteArray &packet, Progress *progress) {
+    Reader reader(packet);
+    const Progress decoded = reader.ReadProgress();
+    if (!reader.Ok() || !reader.AtEnd()) {
+        return false;
+    }
+    *progress = decoded;
+    return true;
+}
+
+bool DecodeStandings(const QByteArray &packet, QVector<Standing> *standings) {
+    Reader reader(packet);
+    const quint32 count = reader.Varint();
+    if (!reader.Ok() || count > static_cast<quint32>(kMaxPlayers)) {
+        return false;
+    }
+    QVector<Standing> decoded(static_cast<int>(count));
+    for (Standing &standing : decoded) {
+        standing.name = reader.Name();
+        standing.progress = reader.ReadProgress();
+    }
+    if (!reader.Ok() || !reader.AtEnd()) {
+        return false;
+    }
+    *standings = decoded;
+    return true;
+}
+
+}  // namespace RaceProtocol
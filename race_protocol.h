@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+// Datagrams of a LAN race. Every packet is a 4 byte header (magic, version,
+// type) followed by little-endian varints, so a progress update is about a
+// dozen bytes. Packets are encoded into a caller-owned buffer that keeps its
+// capacity, so sending once per frame does not allocate.
+namespace RaceProtocol {
+
+constexpr quint16 kDefaultPort = 47615;
+constexpr int kMaxPlayers = 32;
+constexpr int kMaxNameLength = 12;          // characters, longer names are cut
+
+enum class PacketType : quint8 {
+    kJoin = 1,          // client -> host: name; repeated until standings arrive
+    kLeave = 2,         // client -> host
+    kStart = 3,         // host -> clients: RaceSettings
+    kProgress = 4,      // client -> host: Progress
+    kStandings = 5      // host -> clients: every player's Progress
+};
+
+// Everything a client needs to draw the same prompts as the host
+struct RaceSettings {
+    quint32 race_id = 0;
+    quint32 seed = 0;
+    quint8 difficulty = 0;
+    quint8 mode = 0;
+    quint8 custom_types = 0;            // KeyTrace::kCustom* bits
+    qint32 target_rounds = 0;
+    qint32 time_limit_seconds = 0;
+    qint32 sequence_gap_budget_ms = 0;
+    quint32 drill_pack_hash = 0;        // 0 for the built-in items
+    qint32 start_delay_ms = 0;          // countdown before the first prompt
+};
+
+// One player's state in a race. Sent whole rather than as a difference, so a
+// lost datagram costs nothing but its own update.
+struct Progress {
+    quint32 race_id = 0;
+    quint16 sequence = 0;               // per sender, newer wins
+    quint32 rounds_total = 0;
+    quint32 rounds_correct = 0;
+    quint32 elapsed_ms = 0;
+    quint32 median_reaction_us = 0;
+    bool finished = false;
+
+    // Whether a receiver would see any change
+    bool SameState(const Progress &other) const;
+};
+
+struct Standing {
+    QString name;
+    Progress progress;
+};
+
+// Sequence numbers wrap; a is newer than b within half the range
+bool IsNewer(quint16 a, quint16 b);
+QString TrimName(const QString &name);
+
+void EncodeJoin(QByteArray *buffer, const QString &name);
+void EncodeLeave(QByteArray *buffer);
+void EncodeStart(QByteArray *buffer, const RaceSettings &settings);
+void EncodeProgress(QByteArray *buffer, const Progress &progress);
+void EncodeStandings(QByteArray *buffer, const QVector<Standing> &standings);
+
+// Type of a well-formed packet; false for anything else on the port
+bool PeekType(const QByteArray &packet, PacketType *type);
+bool DecodeJoin(const QByteArray &packet, QString *name);
+bool DecodeStart(const QByteArray &packet, RaceSettings *settings);
+bool DecodeProgress(const QByteArray &packet, Progress *progress);
+bool DecodeStandings(const QByteArray &packet, QVector<Standing> *standings);
+
+}  // namespace RaceProtocol
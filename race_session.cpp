@@ -0,0 +1,408 @@
+#include "race_session.h"
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+#ifdef LHT_HAVE_NETWORK
+#include <QHostAddress>
+#include <QUdpSocket>
+#endif
+
+using RaceProtocol::PacketType;
+using RaceProtocol::Progress;
+using RaceProtocol::Standing;
+
+namespace {
+
+constexpr int kMaxDatagram = 2048;
+
+#ifdef LHT_HAVE_NETWORK
+constexpr int kTickMs = 125;
+constexpr qint64 kStandingsIntervalMs = 250;
+constexpr qint64 kJoinRetryMs = 1000;
+// Clients repeat their latest progress this often, which doubles as keepalive
+constexpr qint64 kProgressRepeatMs = 1000;
+constexpr qint64 kPeerTimeoutMs = 10000;
+// Start is sent this many times, one tick apart; race_id removes duplicates
+constexpr int kStartRepeats = 3;
+#endif
+
+}  // namespace
+
+#ifdef LHT_HAVE_NETWORK
+
+struct RaceSession::Network {
+    struct Peer {
+        QHostAddress address;
+        quint16 port = 0;
+        bool has_progress = false;
+        quint16 sequence = 0;           // newest progress seen
+        qint64 last_seen_ms = 0;
+    };
+
+    QUdpSocket socket;
+    QTimer tick;
+    QElapsedTimer clock;
+    QHostAddress host_address;          // client only
+    quint16 host_port = 0;
+    QVector<Peer> peers;                // host only, peers[i] is standings_[i + 1]
+    QByteArray receive_buffer;
+    qint64 last_join_ms = 0;
+    qint64 last_progress_ms = 0;
+    qint64 last_standings_ms = 0;
+    int start_repeats = 0;
+};
+
+#else
+
+struct RaceSession::Network {};
+
+#endif
+
+RaceSession::RaceSession(QObject *parent)
+    : QObject(parent) {
+    send_buffer_.reserve(kMaxDatagram);
+#ifdef LHT_HAVE_NETWORK
+    net_ = new Network();
+    net_->receive_buffer.resize(kMaxDatagram);
+    net_->clock.start();
+    net_->tick.setInterval(kTickMs);
+    connect(&net_->socket, &QUdpSocket::readyRead, this, &RaceSession::OnReadyRead);
+    connect(&net_->tick, &QTimer::timeout, this, &RaceSession::OnTick);
+#endif
+}
+
+RaceSession::~RaceSession() {
+    // Tell the host, but not the half-destroyed owner
+    blockSignals(true);
+    Leave();
+    delete net_;
+}
+
+bool RaceSession::IsAvailable() {
+#ifdef LHT_HAVE_NETWORK
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool RaceSession::Host(const QString &name, quint16 port, QString *error) {
+    Leave();
+#ifdef LHT_HAVE_NETWORK
+    if (!net_->socket.bind(QHostAddress::AnyIPv4, port)) {
+        if (error) *error = net_->socket.errorString();
+        return false;
+    }
+    role_ = Role::kHost;
+    name_ = RaceProtocol::TrimName(name);
+    standings_.resize(1);
+    standings_[0].name = name_;
+    standings_[0].progress = Progress();
+    net_->tick.start();
+    SetConnected(true);
+    emit StandingsChanged();
+    return true;
+#else
+    Q_UNUSED(name);
+    Q_UNUSED(port);
+    if (error) *error = QStringLiteral("需要 Qt Network 模块");
+    return false;
+#endif
+}
+
+bool RaceSession::Join(const QString &host, const QString &name, quint16 port, QString *error) {
+    Leave();
+#ifdef LHT_HAVE_NETWORK
+    const QHostAddress address(host.trimmed());
+    if (address.isNull()) {
+        if (error) *error = QStringLiteral("无效的地址: %1").arg(host);
+        return false;
+    }
+    if (!net_->socket.bind(QHostAddress::AnyIPv4, 0)) {
+        if (error) *error = net_->socket.errorString();
+        return false;
+    }
+    role_ = Role::kClient;
+    name_ = RaceProtocol::TrimName(name);
+    net_->host_address = address;
+    net_->host_port = port;
+    net_->last_join_ms = net_->clock.elapsed();
+    RaceProtocol::EncodeJoin(&send_buffer_, name_);
+    SendToHost(send_buffer_);
+    net_->tick.start();
+    emit ConnectionChanged();
+    return true;
+#else
+    Q_UNUSED(host);
+    Q_UNUSED(name);
+    Q_UNUSED(port);
+    if (error) *error = QStringLiteral("需要 Qt Network 模块");
+    return false;
+#endif
+}
+
+void RaceSession::Leave() {
+    if (role_ == Role::kIdle) {
+        return;
+    }
+#ifdef LHT_HAVE_NETWORK
+    if (role_ == Role::kClient) {
+        RaceProtocol::EncodeLeave(&send_buffer_);
+        SendToHost(send_buffer_);
+    }
+    net_->tick.stop();
+    net_->socket.close();
+    net_->peers.clear();
+    net_->start_repeats = 0;
+#endif
+    role_ = Role::kIdle;
+    standings_.clear();
+    progress_ = Progress();
+    started_race_id_ = 0;
+    standings_dirty_ = false;
+    connected_ = false;
+    emit StandingsChanged();
+    emit ConnectionChanged();
+}
+
+void RaceSession::StartRace(const RaceProtocol::RaceSettings &settings) {
+    if (role_ != Role::kHost) {
+        return;
+    }
+    race_ = settings;
+    started_race_id_ = settings.race_id;
+#ifdef LHT_HAVE_NETWORK
+    net_->start_repeats = kStartRepeats;
+    OnTick();
+#endif
+    emit RaceStarted(race_);
+}
+
+void RaceSession::UpdateProgress(const Progress &progress) {
+    if (role_ == Role::kIdle || progress.SameState(progress_)) {
+        return;
+    }
+    const quint16 sequence = static_cast<quint16>(progress_.sequence + 1);
+    progress_ = progress;
+    progress_.sequence = sequence;
+
+    if (role_ == Role::kHost) {
+        standings_[0].progress = progress_;
+        standings_dirty_ = true;
+        emit StandingsChanged();
+        return;
+    }
+#ifdef LHT_HAVE_NETWORK
+    net_->last_progress_ms = net_->clock.elapsed();
+    RaceProtocol::EncodeProgress(&send_buffer_, progress_);
+    SendToHost(send_buffer_);
+#endif
+}
+
+void RaceSession::OnReadyRead() {
+#ifdef LHT_HAVE_NETWORK
+    while (net_->socket.hasPendingDatagrams()) {
+        QHostAddress sender;
+        quint16 sender_port = 0;
+        const qint64 size = net_->socket.readDatagram(net_->receive_buffer.data(), kMaxDatagram,
+                                                      &sender, &sender_port);
+        if (size <= 0) {
+            continue;
+        }
+        // Raw view over the receive buffer; decoders copy what they keep
+        const QByteArray packet =
+            QByteArray::fromRawData(net_->receive_buffer.constData(), static_cast<int>(size));
+        PacketType type = PacketType::kJoin;
+        if (!RaceProtocol::PeekType(packet, &type)) {
+            continue;
+        }
+
+        if (role_ == Role::kClient) {
+            if (sender_port == net_->host_port && sender.isEqual(net_->host_address)) {
+                HandleClientPacket(type, packet);
+            }
+            continue;
+        }
+        if (role_ != Role::kHost) {
+            continue;
+        }
+
+        int peer = -1;
+        for (int i = 0; i < net_->peers.size(); ++i) {
+            if (net_->peers.at(i).port == sender_port && net_->peers.at(i).address.isEqual(sender)) {
+                peer = i;
+                break;
+            }
+        }
+        if (peer < 0) {
+            // Unknown senders may only join
+            QString name;
+            if (type != PacketType::kJoin || !RaceProtocol::DecodeJoin(packet, &name) ||
+                standings_.size() >= RaceProtocol::kMaxPlayers) {
+                continue;
+            }
+            Network::Peer added;
+            added.address = sender;
+            added.port = sender_port;
+            net_->peers.append(added);
+            Standing standing;
+            standing.name = name.isEmpty() ? sender.toString() : name;
+            standings_.append(standing);
+            peer = net_->peers.size() - 1;
+            standings_dirty_ = true;
+            emit StandingsChanged();
+        }
+        net_->peers[peer].last_seen_ms = net_->clock.elapsed();
+        HandleHostPacket(peer, type, packet);
+    }
+#endif
+}
+
+void RaceSession::HandleHostPacket(int peer, PacketType type, const QByteArray &packet) {
+#ifdef LHT_HAVE_NETWORK
+    switch (type) {
+    case PacketType::kJoin:
+        // Answer right away so the client stops retrying; a repeated join
+        // also means the standings or the start were lost
+        RaceProtocol::EncodeStandings(&send_buffer_, standings_);
+        net_->socket.writeDatagram(send_buffer_, net_->peers.at(peer).address,
+                                   net_->peers.at(peer).port);
+        break;
+    case PacketType::kLeave:
+        net_->peers.remove(peer);
+        standings_.remove(peer + 1);
+        standings_dirty_ = true;
+        emit StandingsChanged();
+        break;
+    case PacketType::kProgress: {
+        Progress progress;
+        if (!RaceProtocol::DecodeProgress(packet, &progress)) {
+            break;
+        }
+        if (started_race_id_ != 0 && progress.race_id != started_race_id_) {
+            // The client missed every copy of the start
+            RaceProtocol::EncodeStart(&send_buffer_, race_);
+            net_->socket.writeDatagram(send_buffer_, net_->peers.at(peer).address,
+                                       net_->peers.at(peer).port);
+        }
+        Network::Peer &state = net_->peers[peer];
+        // Datagrams may arrive out of order; keep only the newest
+        if (state.has_progress && !RaceProtocol::IsNewer(progress.sequence, state.sequence)) {
+            break;
+        }
+        state.has_progress = true;
+        state.sequence = progress.sequence;
+        Progress &stored = standings_[peer + 1].progress;
+        if (!progress.SameState(stored)) {
+            stored = progress;
+            standings_dirty_ = true;
+            emit StandingsChanged();
+        }
+        break;
+    }
+    default:
+        break;
+    }
+#else
+    Q_UNUSED(peer);
+    Q_UNUSED(type);
+    Q_UNUSED(packet);
+#endif
+}
+
+void RaceSession::HandleClientPacket(PacketType type, const QByteArray &packet) {
+    switch (type) {
+    case PacketType::kStart: {
+        RaceProtocol::RaceSettings settings;
+        if (!RaceProtocol::DecodeStart(packet, &settings) ||
+            settings.race_id == started_race_id_) {
+            break;
+        }
+        race_ = settings;
+        started_race_id_ = settings.race_id;
+        emit RaceStarted(race_);
+        break;
+    }
+    case PacketType::kStandings: {
+        QVector<Standing> standings;
+        if (!RaceProtocol::DecodeStandings(packet, &standings)) {
+            break;
+        }
+        standings_ = standings;
+        SetConnected(true);
+        emit StandingsChanged();
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void RaceSession::OnTick() {
+#ifdef LHT_HAVE_NETWORK
+    const qint64 now = net_->clock.elapsed();
+    if (role_ == Role::kClient) {
+        if (!connected_ && now - net_->last_join_ms >= kJoinRetryMs) {
+            net_->last_join_ms = now;
+            RaceProtocol::EncodeJoin(&send_buffer_, name_);
+            SendToHost(send_buffer_);
+        }
+        if (connected_ && now - net_->last_progress_ms >= kProgressRepeatMs) {
+            net_->last_progress_ms = now;
+            RaceProtocol::EncodeProgress(&send_buffer_, progress_);
+            SendToHost(send_buffer_);
+        }
+        return;
+    }
+    if (role_ != Role::kHost) {
+        return;
+    }
+
+    for (int i = net_->peers.size() - 1; i >= 0; --i) {
+        if (now - net_->peers.at(i).last_seen_ms > kPeerTimeoutMs) {
+            net_->peers.remove(i);
+            standings_.remove(i + 1);
+            standings_dirty_ = true;
+            emit StandingsChanged();
+        }
+    }
+    if (net_->start_repeats > 0) {
+        --net_->start_repeats;
+        RaceProtocol::EncodeStart(&send_buffer_, race_);
+        SendToClients(send_buffer_);
+    }
+    if (standings_dirty_ && now - net_->last_standings_ms >= kStandingsIntervalMs) {
+        standings_dirty_ = false;
+        net_->last_standings_ms = now;
+        RaceProtocol::EncodeStandings(&send_buffer_, standings_);
+        SendToClients(send_buffer_);
+    }
+#endif
+}
+
+void RaceSession::SendToHost(const QByteArray &packet) {
+#ifdef LHT_HAVE_NETWORK
+    net_->socket.writeDatagram(packet, net_->host_address, net_->host_port);
+#else
+    Q_UNUSED(packet);
+#endif
+}
+
+void RaceSession::SendToClients(const QByteArray &packet) {
+#ifdef LHT_HAVE_NETWORK
+    for (const Network::Peer &peer : net_->peers) {
+        net_->socket.writeDatagram(packet, peer.address, peer.port);
+    }
+#else
+    Q_UNUSED(packet);
+#endif
+}
+
+void RaceSession::SetConnected(bool connected) {
+    if (connected_ == connected) {
+        return;
+    }
+    connected_ = connected;
+    emit ConnectionChanged();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include "race_protocol.h"
+
+// One side of a LAN race over UDP. The host keeps the standings of every
+// player, itself included, and sends them to the clients at most every
+// 250 ms while something changed; clients send their own progress whenever
+// it changes and repeat the latest one every second, so a lost datagram is
+// repaired by the next. Without Qt Network the session builds but every
+// call fails.
+class RaceSession : public QObject {
+    Q_OBJECT
+
+public:
+    enum class Role {
+        kIdle,
+        kHost,
+        kClient
+    };
+
+    explicit RaceSession(QObject *parent = nullptr);
+    ~RaceSession() override;
+
+    static bool IsAvailable();
+
+    bool Host(const QString &name, quint16 port, QString *error);
+    // host is a numeric address; no name lookup, so joining never blocks
+    bool Join(const QString &host, const QString &name, quint16 port, QString *error);
+    void Leave();
+
+    Role CurrentRole() const { return role_; }
+    // A client counts as connected once the host has sent standings
+    bool IsConnected() const { return connected_; }
+
+    // Host only: sends the race to every client and starts it locally
+    void StartRace(const RaceProtocol::RaceSettings &settings);
+    // Own progress; cheap when nothing changed, so it can run every frame
+    void UpdateProgress(const RaceProtocol::Progress &progress);
+
+    // Every player, the host first; unsorted
+    const QVector<RaceProtocol::Standing> &Standings() const { return standings_; }
+
+signals:
+    // Emitted on both sides, once per race
+    void RaceStarted(const RaceProtocol::RaceSettings &settings);
+    void StandingsChanged();
+    void ConnectionChanged();
+
+private:
+    struct Network;
+
+    void OnReadyRead();
+    void OnTick();
+    void HandleHostPacket(int peer, RaceProtocol::PacketType type, const QByteArray &packet);
+    void HandleClientPacket(RaceProtocol::PacketType type, const QByteArray &packet);
+    void SendToHost(const QByteArray &packet);
+    void SendToClients(const QByteArray &packet);
+    void SetConnected(bool connected);
+
+    Network *net_ = nullptr;
+    Role role_ = Role::kIdle;
+    bool connected_ = false;
+    QString name_;
+    QVector<RaceProtocol::Standing> standings_;
+    RaceProtocol::Progress progress_;           // own, as last sent
+    RaceProtocol::RaceSettings race_;
+    quint32 started_race_id_ = 0;
+    QByteArray send_buffer_;
+    bool standings_dirty_ = false;
+};
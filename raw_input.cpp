@@ -0,0 +1,323 @@
+#include "raw_input.h"
+
+#include "reaction_timing.h"
+
+#include <QThread>
+
+#if defined(Q_OS_LINUX)
+#include <QDir>
+#include <QFile>
+#include <QVector>
+
+#include <fcntl.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef input_event_sec
+#define input_event_sec time.tv_sec
+#define input_event_usec time.tv_usec
+#endif
+#elif defined(Q_OS_WIN)
+#include <QSemaphore>
+
+#include <atomic>
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace {
+
+// QKeyEvent::nativeScanCode() is the XKB keycode on Linux, which is the
+// evdev code offset by 8; on Windows it is the scan code plus 0x100 for
+// extended (E0) keys, the same value we build from Raw Input.
+quint32 RawCodeFromNative(quint32 native_scan_code) {
+#if defined(Q_OS_LINUX)
+    return native_scan_code >= 8 ? native_scan_code - 8 : 0;
+#else
+    return native_scan_code;
+#endif
+}
+
+}  // namespace
+
+// ===== Reader =====
+
+class RawInputSource::Reader : public QThread {
+public:
+    explicit Reader(RawInputSource *source)
+        : source_(source) {}
+    ~Reader() override;
+
+    // GUI thread: open the backend and start capturing
+    bool Begin();
+    // GUI thread: stop capturing and wait for the thread
+    void End();
+
+protected:
+    void run() override;
+
+private:
+    RawInputSource *source_;
+
+#if defined(Q_OS_LINUX)
+    static bool IsKeyboard(int fd);
+
+    QVector<int> fds_;
+    int wake_[2] = {-1, -1};        // self-pipe that interrupts poll()
+#elif defined(Q_OS_WIN)
+    QSemaphore ready_;
+    bool registered_ = false;
+    std::atomic<DWORD> thread_id_{0};
+#endif
+};
+
+RawInputSource::Reader::~Reader() {
+    End();
+}
+
+#if defined(Q_OS_LINUX)
+
+bool RawInputSource::Reader::IsKeyboard(int fd) {
+    unsigned long ev_bits = 0;
+    if (ioctl(fd, EVIOCGBIT(0, sizeof(ev_bits)), &ev_bits) < 0 ||
+        !(ev_bits & (1UL << EV_KEY))) {
+        return false;
+    }
+    unsigned char key_bits[KEY_MAX / 8 + 1] = {};
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits) < 0) {
+        return false;
+    }
+    // Mice and power buttons report EV_KEY too; require letters and space
+    auto has_key = [&key_bits](int code) {
+        return (key_bits[code / 8] >> (code % 8)) & 1;
+    };
+    return has_key(KEY_A) && has_key(KEY_Q) && has_key(KEY_SPACE);
+}
+
+bool RawInputSource::Reader::Begin() {
+    const QDir dir(QStringLiteral("/dev/input"));
+    const QStringList nodes = dir.entryList({QStringLiteral("event*")}, QDir::System);
+    for (const QString &node : nodes) {
+        const int fd = ::open(QFile::encodeName(dir.filePath(node)).constData(),
+                              O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) continue;
+        if (!IsKeyboard(fd)) {
+            ::close(fd);
+            continue;
+        }
+        // Same clock as ReactionClock (std::chrono::steady_clock)
+        int clock_id = CLOCK_MONOTONIC;
+        if (ioctl(fd, EVIOCSCLOCKID, &clock_id) < 0) {
+            ::close(fd);
+            continue;
+        }
+        fds_.append(fd);
+    }
+
+    if (fds_.isEmpty() || pipe2(wake_, O_CLOEXEC | O_NONBLOCK) < 0) {
+        End();
+        return false;
+    }
+    start(QThread::TimeCriticalPriority);
+    return true;
+}
+
+void RawInputSource::Reader::End() {
+    if (wake_[1] >= 0) {
+        const char byte = 0;
+        (void)::write(wake_[1], &byte, 1);
+    }
+    wait();
+
+    for (int fd : fds_) {
+        ::close(fd);
+    }
+    fds_.clear();
+    for (int &fd : wake_) {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+}
+
+void RawInputSource::Reader::run() {
+    QVector<pollfd> polls;
+    for (int fd : fds_) {
+        polls.append({fd, POLLIN, 0});
+    }
+    polls.append({wake_[0], POLLIN, 0});
+
+    input_event events[64];
+    for (;;) {
+        if (::poll(polls.data(), static_cast<nfds_t>(polls.size()), -1) < 0) {
+            continue;
+        }
+        if (polls.last().revents) {
+            return;
+        }
+        for (int i = 0; i < polls.size() - 1; ++i) {
+            if (polls[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                // Device unplugged; poll() skips negative descriptors
+                polls[i].fd = -1;
+                continue;
+            }
+            if (!(polls[i].revents & POLLIN)) continue;
+
+            const ssize_t bytes = ::read(polls[i].fd, events, sizeof(events));
+            if (bytes <= 0) continue;
+
+            const int count = static_cast<int>(bytes / static_cast<ssize_t>(sizeof(input_event)));
+            for (int e = 0; e < count; ++e) {
+                const input_event &event = events[e];
+                // value 1 is a press, 2 an autorepeat
+                if (event.type != EV_KEY || event.value != 1) continue;
+
+                RawKeyPress press;
+                press.time_ns = static_cast<qint64>(event.input_event_sec) * 1000000000LL +
+                                static_cast<qint64>(event.input_event_usec) * 1000LL;
+                press.scan_code = event.code;
+                source_->queue_.Push(press);
+            }
+        }
+    }
+}
+
+#elif defined(Q_OS_WIN)
+
+bool RawInputSource::Reader::Begin() {
+    start(QThread::TimeCriticalPriority);
+    ready_.acquire();
+    if (!registered_) {
+        wait();
+        return false;
+    }
+    return true;
+}
+
+void RawInputSource::Reader::End() {
+    const DWORD id = thread_id_.exchange(0);
+    if (id != 0) {
+        PostThreadMessageW(id, WM_QUIT, 0, 0);
+    }
+    wait();
+}
+
+void RawInputSource::Reader::run() {
+    // Raw Input is delivered to a window; a message-only one is enough
+    HWND hwnd = CreateWindowExW(0, L"Message", nullptr, 0, 0, 0, 0, 0,
+                                HWND_MESSAGE, nullptr, GetModuleHandleW(nullptr), nullptr);
+    RAWINPUTDEVICE device = {};
+    device.usUsagePage = 0x01;      // generic desktop
+    device.usUsage = 0x06;          // keyboard
+    device.dwFlags = RIDEV_INPUTSINK;
+    device.hwndTarget = hwnd;
+    registered_ = hwnd && RegisterRawInputDevices(&device, 1, sizeof(device));
+    if (registered_) {
+        thread_id_.store(GetCurrentThreadId());
+    }
+    ready_.release();
+    if (!registered_) {
+        if (hwnd) DestroyWindow(hwnd);
+        return;
+    }
+
+    MSG msg;
+    while (GetMessageW(&msg, nullptr, 0, 0) > 0) {
+        if (msg.message == WM_INPUT) {
+            // Stamp on receipt: Raw Input has no finer timestamp than this
+            const qint64 now_ns = ReactionClock::NowNs();
+            RAWINPUT raw;
+            UINT size = sizeof(raw);
+            if (GetRawInputData(reinterpret_cast<HRAWINPUT>(msg.lParam), RID_INPUT, &raw,
+                                &size, sizeof(RAWINPUTHEADER)) != static_cast<UINT>(-1) &&
+                raw.header.dwType == RIM_TYPEKEYBOARD &&
+                !(raw.data.keyboard.Flags & RI_KEY_BREAK)) {
+                RawKeyPress press;
+                press.time_ns = now_ns;
+                press.scan_code = raw.data.keyboard.MakeCode |
+                                  ((raw.data.keyboard.Flags & RI_KEY_E0) ? 0x100 : 0);
+                source_->queue_.Push(press);
+            }
+        }
+        DispatchMessageW(&msg);
+    }
+
+    device.dwFlags = RIDEV_REMOVE;
+    device.hwndTarget = nullptr;
+    RegisterRawInputDevices(&device, 1, sizeof(device));
+    DestroyWindow(hwnd);
+}
+
+#else
+
+bool RawInputSource::Reader::Begin() {
+    return false;
+}
+
+void RawInputSource::Reader::End() {}
+
+void RawInputSource::Reader::run() {}
+
+#endif
+
+// ===== RawInputSource =====
+
+RawInputSource::RawInputSource() = default;
+
+RawInputSource::~RawInputSource() {
+    Stop();
+}
+
+bool RawInputSource::Start() {
+    if (reader_) return true;
+
+    auto *reader = new Reader(this);
+    if (!reader->Begin()) {
+        delete reader;
+        return false;
+    }
+    reader_ = reader;
+    return true;
+}
+
+void RawInputSource::Stop() {
+    delete reader_;
+    reader_ = nullptr;
+
+    RawKeyPress press;
+    while (queue_.Pop(&press)) {}
+    recent_.clear();
+}
+
+bool RawInputSource::TakePress(quint32 native_scan_code, qint64 now_ns, qint64 *time_ns) {
+    if (!reader_) return false;
+
+    RawKeyPress press;
+    while (queue_.Pop(&press)) {
+        if (recent_.size() == recent_.capacity()) {
+            recent_.remove(0);
+        }
+        recent_.append(press);
+    }
+
+    const quint32 code = RawCodeFromNative(native_scan_code);
+    for (int i = recent_.size() - 1; i >= 0; --i) {
+        const RawKeyPress &candidate = recent_.at(i);
+        if (candidate.scan_code != code) continue;
+
+        const qint64 age = now_ns - candidate.time_ns;
+        if (age < 0 || age > kMatchWindowNs) {
+            return false;
+        }
+        *time_ns = candidate.time_ns;
+        // Everything up to this press has been delivered by Qt by now
+        recent_.remove(0, i + 1);
+        return true;
+    }
+    return false;
+}
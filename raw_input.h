@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QVarLengthArray>
+#include <QtGlobal>
+
+#include "spsc_queue.h"
+
+// Key press as seen by the operating system's input layer
+struct RawKeyPress {
+    qint64 time_ns = 0;         // ReactionClock
+    quint32 scan_code = 0;      // in QKeyEvent::nativeScanCode() terms
+};
+
+// Optional OS-level keyboard capture for reaction timing: evdev on Linux,
+// Raw Input on Windows. A dedicated thread timestamps every key press as it
+// leaves the kernel and pushes it into a lock-free queue; the GUI thread
+// picks the matching press up when Qt delivers the key event, so timings
+// no longer include event loop dispatch delays. Elsewhere, or without
+// access to the input devices, Start() fails and Qt timestamps are used.
+class RawInputSource {
+public:
+    RawInputSource();
+    ~RawInputSource();
+
+    bool Start();
+    void Stop();
+    bool IsRunning() const { return reader_ != nullptr; }
+
+    // GUI thread: OS time of the latest unclaimed press of the key with this
+    // native scan code, at most kMatchWindowNs before now_ns
+    bool TakePress(quint32 native_scan_code, qint64 now_ns, qint64 *time_ns);
+
+private:
+    class Reader;
+
+    SpscQueue<RawKeyPress, 256> queue_;
+    // Drained presses not yet claimed by a Qt key event, oldest first
+    QVarLengthArray<RawKeyPress, 32> recent_;
+    Reader *reader_ = nullptr;
+
+    static constexpr qint64 kMatchWindowNs = 250LL * 1000 * 1000;
+};
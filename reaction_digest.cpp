@@ -0,0 +1,167 @@
+#include "reaction_digest.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// t-digest compression: the k1 scale spans kCompression / 2, so a compressed
+// digest holds at most kCompression + 1 centroids
+constexpr double kCompression = 28.0;
+constexpr double kPi = 3.14159265358979323846;
+// Samples merged per pass, so adding needs no heap
+constexpr int kAddChunk = 224;
+
+double Scale(double q) {
+    return kCompression / (2.0 * kPi) * std::asin(2.0 * qBound(0.0, q, 1.0) - 1.0);
+}
+
+}  // namespace
+
+void ReactionDigest::Clear() {
+    *this = ReactionDigest();
+}
+
+void ReactionDigest::Add(qint64 *values_ns, int count) {
+    if (count <= 0) {
+        return;
+    }
+    std::sort(values_ns, values_ns + count);
+    if (total_ == 0) {
+        min_ns_ = values_ns[0];
+        max_ns_ = values_ns[count - 1];
+    } else {
+        min_ns_ = qMin(min_ns_, values_ns[0]);
+        max_ns_ = qMax(max_ns_, values_ns[count - 1]);
+    }
+
+    Centroid merged[kCapacity + kAddChunk];
+    for (int first = 0; first < count; first += kAddChunk) {
+        const int chunk = qMin(kAddChunk, count - first);
+        // Both inputs are sorted; merge them by mean
+        int a = 0;
+        int b = 0;
+        int length = 0;
+        while (a < count_ || b < chunk) {
+            const float value_us = (b < chunk)
+                                       ? static_cast<float>(values_ns[first + b] / 1000.0)
+                                       : 0.0f;
+            if (b >= chunk || (a < count_ && centroids_[a].mean_us <= value_us)) {
+                merged[length++] = centroids_[a++];
+            } else {
+                merged[length].mean_us = value_us;
+                merged[length].weight = 1;
+                ++length;
+                ++b;
+            }
+        }
+        total_ += chunk;
+        Compress(merged, length);
+    }
+}
+
+void ReactionDigest::Merge(const ReactionDigest &other) {
+    if (other.total_ == 0) {
+        return;
+    }
+    if (total_ == 0) {
+        *this = other;
+        return;
+    }
+    min_ns_ = qMin(min_ns_, other.min_ns_);
+    max_ns_ = qMax(max_ns_, other.max_ns_);
+
+    Centroid merged[2 * kCapacity];
+    const Centroid *end = std::merge(centroids_.begin(), centroids_.begin() + count_,
+                                     other.centroids_.begin(),
+                                     other.centroids_.begin() + other.count_, merged,
+                                     [](const Centroid &x, const Centroid &y) {
+                                         return x.mean_us < y.mean_us;
+                                     });
+    total_ += other.total_;
+    Compress(merged, static_cast<int>(end - merged));
+}
+
+qint64 ReactionDigest::QuantileNs(double q) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    if (q <= 0.0) {
+        return min_ns_;
+    }
+    if (q >= 1.0) {
+        return max_ns_;
+    }
+
+    // Each centroid's mean sits at the middle of its weight; interpolate
+    // between neighbouring middles, and towards min/max beyond the ends
+    const double target = q * static_cast<double>(total_);
+    double previous_position = 0.0;
+    double previous_value = static_cast<double>(min_ns_);
+    double weight_before = 0.0;
+    for (int i = 0; i < count_; ++i) {
+        const double weight = centroids_[i].weight;
+        const double position = weight_before + weight / 2.0;
+        const double value = centroids_[i].mean_us * 1000.0;
+        if (target < position) {
+            const double t = (target - previous_position) / (position - previous_position);
+            return static_cast<qint64>(previous_value + t * (value - previous_value));
+        }
+        previous_position = position;
+        previous_value = value;
+        weight_before += weight;
+    }
+    const double span = static_cast<double>(total_) - previous_position;
+    const double t = (span > 0.0) ? (target - previous_position) / span : 1.0;
+    return static_cast<qint64>(previous_value + t * (static_cast<double>(max_ns_) - previous_value));
+}
+
+bool ReactionDigest::IsValid() const {
+    if (count_ < 0 || count_ > kCapacity || total_ < 0 || (count_ == 0) != (total_ == 0)) {
+        return false;
+    }
+    if (count_ > 0 && min_ns_ > max_ns_) {
+        return false;
+    }
+    qint64 weight = 0;
+    for (int i = 0; i < count_; ++i) {
+        const Centroid &centroid = centroids_[i];
+        if (centroid.weight == 0 || !std::isfinite(centroid.mean_us) ||
+            (i > 0 && centroid.mean_us < centroids_[i - 1].mean_us)) {
+            return false;
+        }
+        weight += centroid.weight;
+    }
+    return weight == total_;
+}
+
+void ReactionDigest::Compress(const Centroid *input, int count) {
+    const double total = static_cast<double>(total_);
+    double mean = input[0].mean_us;
+    double weight = input[0].weight;
+    double weight_before = 0.0;
+    double scale_left = Scale(0.0);
+    count_ = 0;
+
+    for (int i = 1; i < count; ++i) {
+        const double next_weight = input[i].weight;
+        const bool fits = Scale((weight_before + weight + next_weight) / total) - scale_left <= 1.0;
+        // The last slot takes whatever is left, which the scale bound should
+        // never need
+        if (fits || count_ == kCapacity - 1) {
+            mean += (input[i].mean_us - mean) * next_weight / (weight + next_weight);
+            weight += next_weight;
+            continue;
+        }
+        centroids_[count_].mean_us = static_cast<float>(mean);
+        centroids_[count_].weight = static_cast<quint32>(weight);
+        ++count_;
+        weight_before += weight;
+        scale_left = Scale(weight_before / total);
+        mean = input[i].mean_us;
+        weight = next_weight;
+    }
+    centroids_[count_].mean_us = static_cast<float>(mean);
+    centroids_[count_].weight = static_cast<quint32>(weight);
+    ++count_;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <array>
+
+// Mergeable sketch of a reaction time distribution: a merging t-digest with
+// a fixed number of centroids, so it can sit in a flat on-disk record. Small
+// centroids near both tails keep P95/P99 within a few percent, and merging
+// two digests gives the digest of the combined samples, which is how daily
+// buckets roll up into weeks and months without keeping every sample.
+class ReactionDigest {
+public:
+    static constexpr int kCapacity = 32;
+
+    void Clear();
+    // Adds count samples; sorts values in place
+    void Add(qint64 *values_ns, int count);
+    void Merge(const ReactionDigest &other);
+
+    qint64 Count() const { return total_; }
+    qint64 MinNs() const { return min_ns_; }
+    qint64 MaxNs() const { return max_ns_; }
+    // Interpolated quantile, q in [0, 1]; 0 without samples
+    qint64 QuantileNs(double q) const;
+
+    // Whether a digest read from disk is consistent: centroid count within
+    // kCapacity, sorted positive-weight centroids adding up to Count(), and
+    // min <= max. Merge and QuantileNs rely on all of it.
+    bool IsValid() const;
+
+private:
+    struct Centroid {
+        float mean_us = 0.0f;
+        quint32 weight = 0;
+    };
+
+    // Rebuilds the centroids from input sorted by mean, holding total weight
+    void Compress(const Centroid *input, int count);
+
+    std::array<Centroid, kCapacity> centroids_;
+    qint32 count_ = 0;
+    quint32 reserved_ = 0;
+    qint64 total_ = 0;
+    qint64 min_ns_ = 0;
+    qint64 max_ns_ = 0;
+};
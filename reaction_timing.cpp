@@ -0,0 +1,80 @@
+#include "reaction_timing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace ReactionClock {
+
+qint64 NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace ReactionClock
+
+// ===== KeyEventClock =====
+
+qint64 KeyEventClock::Stamp(quint64 event_timestamp_ms) {
+    const qint64 now = ReactionClock::NowNs();
+    if (event_timestamp_ms == 0) {
+        return now;
+    }
+
+    const qint64 event_ns = static_cast<qint64>(event_timestamp_ms) * 1000000LL;
+    const qint64 offset = now - event_ns;
+
+    if (!has_offset_ || offset < offset_ns_ ||
+        offset - offset_ns_ > kReseedThresholdNs) {
+        offset_ns_ = offset;
+        has_offset_ = true;
+    }
+
+    return qMin(now, event_ns + offset_ns_);
+}
+
+void KeyEventClock::Reset() {
+    offset_ns_ = 0;
+    has_offset_ = false;
+}
+
+// ===== ReactionStats =====
+
+void ReactionStats::Clear() {
+    samples_.clear();
+    sorted_ns_.clear();
+}
+
+void ReactionStats::Add(int item_index, qint64 reaction_ns) {
+    ReactionSample sample;
+    sample.item_index = item_index;
+    sample.reaction_ns = qMax<qint64>(0, reaction_ns);
+    samples_.append(sample);
+
+    auto pos = std::upper_bound(sorted_ns_.begin(), sorted_ns_.end(), sample.reaction_ns);
+    sorted_ns_.insert(pos, sample.reaction_ns);
+}
+
+qint64 ReactionStats::Percentile(double p) const {
+    if (sorted_ns_.isEmpty()) {
+        return 0;
+    }
+    const int n = sorted_ns_.size();
+    int rank = static_cast<int>(std::ceil(qBound(0.0, p, 100.0) / 100.0 * n));
+    rank = qBound(1, rank, n);
+    return sorted_ns_.at(rank - 1);
+}
+
+ReactionSummary ReactionStats::Summary() const {
+    ReactionSummary summary;
+    summary.count = sorted_ns_.size();
+    if (summary.count == 0) {
+        return summary;
+    }
+    summary.min_ns = sorted_ns_.first();
+    summary.median_ns = Percentile(50.0);
+    summary.p95_ns = Percentile(95.0);
+    summary.p99_ns = Percentile(99.0);
+    return summary;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+
+// Monotonic nanosecond clock used for every latency measurement.
+namespace ReactionClock {
+
+qint64 NowNs();
+
+}  // namespace ReactionClock
+
+// Maps window-system key event timestamps (milliseconds, unknown epoch) onto
+// ReactionClock. The smallest observed arrival delay is taken as the clock
+// offset, so events that sat in the GUI queue during layout or painting are
+// dated to when they were generated rather than when they were dispatched.
+class KeyEventClock {
+public:
+    // event_timestamp_ms is QKeyEvent::timestamp(); 0 means "unavailable"
+    qint64 Stamp(quint64 event_timestamp_ms);
+    void Reset();
+
+private:
+    qint64 offset_ns_ = 0;
+    bool has_offset_ = false;
+
+    // Offsets further than this from the current estimate mean the event
+    // clock jumped (suspend, new input device) and the estimate is reseeded.
+    static constexpr qint64 kReseedThresholdNs = 1000LL * 1000 * 1000;
+};
+
+struct ReactionSample {
+    int item_index = -1;
+    qint64 reaction_ns = 0;
+};
+
+struct ReactionSummary {
+    int count = 0;
+    qint64 min_ns = 0;
+    qint64 median_ns = 0;
+    qint64 p95_ns = 0;
+    qint64 p99_ns = 0;
+};
+
+// Reaction-time samples of one session. Samples are kept in arrival order
+// (per item) and in a sorted copy, so percentiles are O(1) to read.
+class ReactionStats {
+public:
+    void Clear();
+    void Add(int item_index, qint64 reaction_ns);
+
+    int Count() const { return samples_.size(); }
+    const QVector<ReactionSample> &Samples() const { return samples_; }
+
+    // Nearest-rank percentile, p in [0, 100]
+    qint64 Percentile(double p) const;
+    ReactionSummary Summary() const;
+
+private:
+    QVector<ReactionSample> samples_;
+    QVector<qint64> sorted_ns_;
+};
@@ -0,0 +1,41 @@
+#include "render_scheduler.h"
+
+RenderScheduler::RenderScheduler(QObject *parent)
+    : QObject(parent) {
+    timer_.setSingleShot(true);
+    timer_.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&timer_, &QTimer::timeout, this, &RenderScheduler::Flush);
+}
+
+void RenderScheduler::SetRefreshRate(double refresh_hz) {
+    if (refresh_hz <= 0.0) {
+        refresh_hz = 60.0;
+    }
+    frame_ms_ = qMax(1, static_cast<int>(1000.0 / refresh_hz));
+}
+
+void RenderScheduler::Mark(quint32 parts) {
+    dirty_ |= parts;
+    if (timer_.isActive()) {
+        return;
+    }
+
+    // The first change after an idle frame goes out on the next event loop
+    // turn; anything after that waits for the rest of the frame
+    int delay = 0;
+    if (last_flush_.isValid()) {
+        delay = static_cast<int>(qMax<qint64>(0, frame_ms_ - last_flush_.elapsed()));
+    }
+    timer_.start(delay);
+}
+
+void RenderScheduler::Flush() {
+    timer_.stop();
+    const quint32 parts = dirty_;
+    dirty_ = 0;
+    if (parts == 0) {
+        return;
+    }
+    last_flush_.start();
+    emit Render(parts);
+}
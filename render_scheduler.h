@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include <QtGlobal>
+
+// Coalesces UI updates requested from input handling. Callers mark parts of
+// the UI dirty; at most once per display frame the accumulated set is handed
+// to Render(). Input is still handled synchronously and in order, only the
+// widget updates it causes are batched.
+class RenderScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    enum Part : quint32 {
+        kStats = 1u << 0,
+        kTarget = 1u << 1,
+        kError = 1u << 2,
+        kKeyboard = 1u << 3,
+        kReaction = 1u << 4,
+        kRolling = 1u << 5,
+        kLookAhead = 1u << 6,
+        kRace = 1u << 7
+    };
+
+    explicit RenderScheduler(QObject *parent = nullptr);
+
+    void SetRefreshRate(double refresh_hz);
+
+    void Mark(quint32 parts);
+    // Drop pending parts, e.g. when the view they belong to was replaced
+    void Discard(quint32 parts) { dirty_ &= ~parts; }
+    // Render pending parts right away
+    void Flush();
+
+    bool IsPending(quint32 parts) const { return (dirty_ & parts) != 0; }
+
+signals:
+    void Render(quint32 parts);
+
+private:
+    QTimer timer_;
+    QElapsedTimer last_flush_;
+    quint32 dirty_ = 0;
+    int frame_ms_ = 16;
+};
@@ -0,0 +1,137 @@
+#include "rolling_metrics.h"
+
+namespace {
+
+// Rates over less than this are too noisy to show
+constexpr qint64 kMinRateSpanNs = 1000LL * 1000 * 1000;
+
+double PerMinute(int count, qint64 span_ns) {
+    return 60e9 * static_cast<double>(count) /
+           static_cast<double>(qMax(span_ns, kMinRateSpanNs));
+}
+
+}  // namespace
+
+double RollingWindow::KeysPerMinute() const {
+    return PerMinute(keys, covered_ns);
+}
+
+double RollingWindow::RoundsPerMinute() const {
+    return PerMinute(rounds_total, covered_ns);
+}
+
+double RollingWindow::Accuracy() const {
+    return (rounds_total > 0)
+               ? 100.0 * static_cast<double>(rounds_correct) / static_cast<double>(rounds_total)
+               : 0.0;
+}
+
+void RollingMetrics::Clear() {
+    ring_.fill(Counts());
+    windows_.fill(Counts());
+    bucket_ = 0;
+    now_ns_ = 0;
+}
+
+void RollingMetrics::AddKey(qint64 active_ns) {
+    Advance(active_ns);
+    ring_[bucket_ % kRingSize].keys++;
+    for (Counts &window : windows_) {
+        window.keys++;
+    }
+}
+
+void RollingMetrics::AddRound(qint64 active_ns, bool correct) {
+    Advance(active_ns);
+    Counts &bucket = ring_[bucket_ % kRingSize];
+    bucket.rounds_total++;
+    bucket.rounds_correct += correct ? 1 : 0;
+    for (Counts &window : windows_) {
+        window.rounds_total++;
+        window.rounds_correct += correct ? 1 : 0;
+    }
+}
+
+void RollingMetrics::AddReaction(qint64 active_ns, qint64 reaction_ns) {
+    Advance(active_ns);
+    const int bin = ReactionBin(reaction_ns);
+    Counts &bucket = ring_[bucket_ % kRingSize];
+    bucket.reactions++;
+    bucket.reaction_bins[bin]++;
+    for (Counts &window : windows_) {
+        window.reactions++;
+        window.reaction_bins[bin]++;
+    }
+}
+
+void RollingMetrics::Advance(qint64 active_ns) {
+    if (active_ns <= now_ns_) {
+        return;
+    }
+    now_ns_ = active_ns;
+
+    const qint64 target = active_ns / kBucketNs;
+    if (target - bucket_ >= kRingSize) {
+        // Everything recorded so far is older than the longest window
+        ring_.fill(Counts());
+        windows_.fill(Counts());
+        bucket_ = target;
+        return;
+    }
+
+    while (bucket_ < target) {
+        ++bucket_;
+        for (int w = 0; w < kWindowCount; ++w) {
+            const qint64 leaving = bucket_ - kWindowSeconds[w];
+            if (leaving >= 0) {
+                Subtract(windows_[w], ring_[leaving % kRingSize]);
+            }
+        }
+        // The slot held the bucket that just left the longest window
+        ring_[bucket_ % kRingSize] = Counts();
+    }
+}
+
+RollingWindow RollingMetrics::Window(int window) const {
+    const Counts &counts = windows_[window];
+
+    RollingWindow result;
+    result.seconds = kWindowSeconds[window];
+    result.keys = counts.keys;
+    result.rounds_total = counts.rounds_total;
+    result.rounds_correct = counts.rounds_correct;
+
+    const qint64 first_bucket = qMax<qint64>(0, bucket_ - kWindowSeconds[window] + 1);
+    result.covered_ns = now_ns_ - first_bucket * kBucketNs;
+
+    if (counts.reactions > 0) {
+        // Nearest-rank median, as in ReactionStats
+        const int rank = (counts.reactions + 1) / 2;
+        int seen = 0;
+        for (int bin = 0; bin < kReactionBins; ++bin) {
+            seen += counts.reaction_bins[bin];
+            if (seen >= rank) {
+                result.median_reaction_ns = bin * kReactionBinNs + kReactionBinNs / 2;
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+int RollingMetrics::ReactionBin(qint64 reaction_ns) {
+    return static_cast<int>(qBound<qint64>(0, reaction_ns / kReactionBinNs, kReactionBins - 1));
+}
+
+void RollingMetrics::Subtract(Counts &from, const Counts &bucket) {
+    from.keys -= bucket.keys;
+    from.rounds_total -= bucket.rounds_total;
+    from.rounds_correct -= bucket.rounds_correct;
+    if (bucket.reactions == 0) {
+        return;
+    }
+    from.reactions -= bucket.reactions;
+    for (int bin = 0; bin < kReactionBins; ++bin) {
+        from.reaction_bins[bin] -= bucket.reaction_bins[bin];
+    }
+}
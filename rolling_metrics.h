@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <array>
+
+// Aggregates of one rolling window
+struct RollingWindow {
+    int seconds = 0;                // window length
+    int keys = 0;                   // key presses that reached the matcher
+    int rounds_total = 0;
+    int rounds_correct = 0;
+    qint64 covered_ns = 0;          // session time the window actually spans
+    qint64 median_reaction_ns = 0;  // 0 without samples
+
+    double KeysPerMinute() const;
+    double RoundsPerMinute() const;
+    double Accuracy() const;        // percent, 0 without rounds
+};
+
+// Keys, rounds and reaction times over the last 10, 30 and 60 seconds of
+// active session time.
+//
+// Time is split into one-second buckets kept in a ring. Every window keeps
+// running sums that are updated when a sample arrives and when a bucket falls
+// out of it, so recording is O(1) and reading a window does not touch the
+// samples. Reaction times go into a fixed histogram of kReactionBinNs wide
+// bins; the median is the midpoint of the bin that holds it.
+class RollingMetrics {
+public:
+    static constexpr int kWindowCount = 3;
+    static constexpr int kWindowSeconds[kWindowCount] = {10, 30, 60};
+    static constexpr qint64 kReactionBinNs = 10LL * 1000 * 1000;
+    static constexpr int kReactionBins = 160;   // last bin collects >= 1.59 s
+
+    void Clear();
+
+    // All times are active (unpaused) session time, never decreasing
+    void AddKey(qint64 active_ns);
+    void AddRound(qint64 active_ns, bool correct);
+    void AddReaction(qint64 active_ns, qint64 reaction_ns);
+    // Retires buckets that left their windows; Add* do this implicitly
+    void Advance(qint64 active_ns);
+
+    // window in [0, kWindowCount); as of the last Add* / Advance call
+    RollingWindow Window(int window) const;
+
+private:
+    struct Counts {
+        int keys = 0;
+        int rounds_total = 0;
+        int rounds_correct = 0;
+        int reactions = 0;
+        std::array<quint16, kReactionBins> reaction_bins{};
+    };
+
+    static constexpr int kRingSize = 60;        // largest window
+    static constexpr qint64 kBucketNs = 1000LL * 1000 * 1000;
+
+    static int ReactionBin(qint64 reaction_ns);
+    static void Subtract(Counts &from, const Counts &bucket);
+
+    std::array<Counts, kRingSize> ring_;
+    std::array<Counts, kWindowCount> windows_;
+    qint64 bucket_ = 0;             // index of the bucket now being filled
+    qint64 now_ns_ = 0;
+};
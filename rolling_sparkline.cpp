@@ -0,0 +1,120 @@
+#include "rolling_sparkline.h"
+
+#include <QPaintEvent>
+#include <QPainter>
+#include <QPen>
+#include <QResizeEvent>
+#include <QtMath>
+
+RollingSparkline::RollingSparkline(QWidget *parent)
+    : QWidget(parent) {
+    setFocusPolicy(Qt::NoFocus);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    samples_.reserve(kMaxSamples);
+}
+
+void RollingSparkline::SetColors(const QColor &line, const QColor &background) {
+    line_color_ = line;
+    background_ = background;
+    RedrawAll();
+}
+
+void RollingSparkline::AddSample(double value) {
+    if (samples_.size() == kMaxSamples) {
+        samples_.remove(0);
+    }
+    samples_.append(qMax(0.0, value));
+
+    if (value > scale_max_) {
+        // Grow in 30 unit steps so the scale does not change on every sample
+        scale_max_ = qCeil(value / 30.0) * 30.0;
+        RedrawAll();
+        return;
+    }
+    if (graph_.isNull()) {
+        return;
+    }
+
+    const qreal dpr = graph_.devicePixelRatio();
+    const int step_device = qRound(kStepPx * dpr);
+    graph_.scroll(-step_device, 0, graph_.rect());
+
+    // Clear the uncovered strip and draw the segments that cross it
+    const QRectF strip(width() - kStepPx, 0, kStepPx, height());
+    QPainter painter(&graph_);
+    painter.fillRect(strip, background_);
+    painter.setClipRect(strip);
+    painter.setRenderHint(QPainter::Antialiasing);
+    DrawSegments(painter, qMax(1, samples_.size() - 2));
+    painter.end();
+
+    update();
+}
+
+void RollingSparkline::Clear() {
+    samples_.clear();
+    scale_max_ = kMinScale;
+    RedrawAll();
+}
+
+QSize RollingSparkline::sizeHint() const {
+    return QSize(240, 36);
+}
+
+void RollingSparkline::paintEvent(QPaintEvent *event) {
+    QPainter painter(this);
+    if (graph_.isNull()) {
+        painter.fillRect(event->rect(), background_);
+        return;
+    }
+    const qreal dpr = graph_.devicePixelRatio();
+    const QRect rect = event->rect();
+    painter.drawPixmap(rect, graph_,
+                       QRectF(rect.x() * dpr, rect.y() * dpr, rect.width() * dpr,
+                              rect.height() * dpr).toAlignedRect());
+}
+
+void RollingSparkline::resizeEvent(QResizeEvent *event) {
+    QWidget::resizeEvent(event);
+    RedrawAll();
+}
+
+double RollingSparkline::SampleY(int index) const {
+    // One pixel of margin so the line is not cut at the top and bottom
+    const double usable = qMax(1, height() - 2);
+    return 1.0 + usable * (1.0 - samples_.at(index) / scale_max_);
+}
+
+qreal RollingSparkline::SampleX(int index) const {
+    // The newest sample sits on the right edge
+    return width() - 1 - static_cast<qreal>(samples_.size() - 1 - index) * kStepPx;
+}
+
+void RollingSparkline::DrawSegments(QPainter &painter, int first) const {
+    painter.setPen(QPen(line_color_, 1.5));
+    for (int i = qMax(1, first); i < samples_.size(); ++i) {
+        painter.drawLine(QPointF(SampleX(i - 1), SampleY(i - 1)),
+                         QPointF(SampleX(i), SampleY(i)));
+    }
+}
+
+void RollingSparkline::RedrawAll() {
+    if (width() <= 0 || height() <= 0) {
+        graph_ = QPixmap();
+        return;
+    }
+
+    const qreal dpr = devicePixelRatioF();
+    graph_ = QPixmap(size() * dpr);
+    graph_.setDevicePixelRatio(dpr);
+    graph_.fill(background_);
+
+    QPainter painter(&graph_);
+    painter.setRenderHint(QPainter::Antialiasing);
+    // Only the samples that are still on screen
+    const int visible = width() / kStepPx + 2;
+    DrawSegments(painter, samples_.size() - visible);
+    painter.end();
+
+    update();
+}
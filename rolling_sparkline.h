@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QColor>
+#include <QPixmap>
+#include <QVector>
+#include <QWidget>
+
+class QPainter;
+class QPaintEvent;
+class QResizeEvent;
+
+// Small line graph of the most recent values, newest on the right. The graph
+// lives in a cached pixmap: a new sample scrolls it left by one step and only
+// the uncovered strip is drawn. The whole graph is redrawn only when the size,
+// the colors or the vertical scale change.
+class RollingSparkline : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit RollingSparkline(QWidget *parent = nullptr);
+
+    void SetColors(const QColor &line, const QColor &background);
+    void AddSample(double value);
+    void Clear();
+
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    double SampleY(int index) const;
+    qreal SampleX(int index) const;
+    // Paints the segments ending at samples [first, size())
+    void DrawSegments(QPainter &painter, int first) const;
+    void RedrawAll();
+
+    QVector<double> samples_;       // oldest first, at most kMaxSamples
+    double scale_max_ = kMinScale;
+    QPixmap graph_;
+    QColor line_color_;
+    QColor background_;
+
+    static constexpr int kStepPx = 4;
+    static constexpr int kMaxSamples = 256;
+    static constexpr double kMinScale = 60.0;
+};
@@ -0,0 +1,342 @@
+#include "session_log.h"
+
+#include "persistence_writer.h"
+
+#include <QDir>
+#include <QStandardPaths>
+
+#include <cstring>
+
+// ===== RecordFile =====
+
+RecordFile::RecordFile(const char *magic, quint32 version, quint32 record_size)
+    : magic_(magic),
+      version_(version),
+      record_size_(record_size) {
+}
+
+RecordFile::~RecordFile() {
+    Close();
+}
+
+bool RecordFile::Open(const QString &path, bool map) {
+    Close();
+    mapped_ = map;
+
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+
+    if (file_.size() < static_cast<qint64>(sizeof(Header))) {
+        // New (or truncated before the header was complete) log
+        if (!WriteHeader()) {
+            Close();
+            return false;
+        }
+    } else {
+        Header header;
+        file_.seek(0);
+        if (file_.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header) ||
+            std::memcmp(header.magic, magic_, sizeof(header.magic)) != 0 ||
+            header.version != version_ ||
+            header.record_size != record_size_ ||
+            header.endian_tag != kEndianTag) {
+            // Not a log we can read; leave the file untouched
+            Close();
+            return false;
+        }
+    }
+
+    // Drop a partial trailing record left by a crash during append
+    const qint64 body = file_.size() - static_cast<qint64>(sizeof(Header));
+    count_ = body / record_size_;
+    const qint64 valid_size = static_cast<qint64>(sizeof(Header)) + count_ * record_size_;
+    if (file_.size() != valid_size) {
+        file_.resize(valid_size);
+    }
+
+    return Remap();
+}
+
+void RecordFile::Close() {
+    if (map_) {
+        file_.unmap(map_);
+        map_ = nullptr;
+    }
+    if (file_.isOpen()) {
+        file_.close();
+    }
+    count_ = 0;
+}
+
+bool RecordFile::Append(const void *records, int count) {
+    if (!file_.isOpen() || count <= 0) {
+        return count == 0;
+    }
+
+    const qint64 bytes = static_cast<qint64>(count) * record_size_;
+    file_.seek(static_cast<qint64>(sizeof(Header)) + count_ * record_size_);
+    if (file_.write(static_cast<const char *>(records), bytes) != bytes) {
+        // Roll back whatever part of the batch made it to disk; a mapped file
+        // cannot be shrunk on every platform
+        if (map_) {
+            file_.unmap(map_);
+            map_ = nullptr;
+        }
+        file_.resize(static_cast<qint64>(sizeof(Header)) + count_ * record_size_);
+        Remap();
+        return false;
+    }
+    file_.flush();
+
+    count_ += count;
+    return Remap();
+}
+
+bool RecordFile::Clear() {
+    if (!file_.isOpen()) {
+        return false;
+    }
+    if (map_) {
+        file_.unmap(map_);
+        map_ = nullptr;
+    }
+    count_ = 0;
+    if (!file_.resize(sizeof(Header))) {
+        return false;
+    }
+    return Remap();
+}
+
+const uchar *RecordFile::RecordAt(qint64 index) const {
+    if (!map_ || index < 0 || index >= count_) {
+        return nullptr;
+    }
+    return map_ + sizeof(Header) + index * record_size_;
+}
+
+bool RecordFile::WriteHeader() {
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, magic_, sizeof(header.magic));
+    header.version = version_;
+    header.record_size = record_size_;
+    header.endian_tag = kEndianTag;
+
+    if (!file_.resize(0)) {
+        return false;
+    }
+    file_.seek(0);
+    if (file_.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+    return file_.flush();
+}
+
+bool RecordFile::Remap() {
+    if (map_) {
+        file_.unmap(map_);
+        map_ = nullptr;
+    }
+    if (count_ == 0 || !mapped_) {
+        return true;
+    }
+    map_ = file_.map(0, file_.size(), QFileDevice::MapPrivateOption);
+    return map_ != nullptr;
+}
+
+// ===== SessionLog =====
+
+SessionLog::SessionLog(const QString &directory)
+    : directory_(directory),
+      sessions_("LHTSESS", kSessionVersion, sizeof(SessionLogRecord)),
+      keystrokes_("LHTKEYS", kKeystrokeVersion, sizeof(KeystrokeLogRecord)),
+      write_sessions_("LHTSESS", kSessionVersion, sizeof(SessionLogRecord)),
+      write_keystrokes_("LHTKEYS", kKeystrokeVersion, sizeof(KeystrokeLogRecord)) {
+}
+
+SessionLog::~SessionLog() {
+    // Queued jobs still use write_sessions_ and write_keystrokes_
+    if (writer_) {
+        writer_->Flush();
+    }
+}
+
+QString SessionLog::DefaultDirectory() {
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) +
+           QStringLiteral("/LeftHandTrainer");
+}
+
+bool SessionLog::Open() {
+    open_ = false;
+    if (!QDir().mkpath(directory_)) {
+        return false;
+    }
+    if (!sessions_.Open(directory_ + QStringLiteral("/sessions.bin")) ||
+        !keystrokes_.Open(directory_ + QStringLiteral("/keystrokes.bin"))) {
+        sessions_.Close();
+        keystrokes_.Close();
+        return false;
+    }
+    open_ = true;
+
+    // Only a missing or stale cache costs a scan of the log
+    if (!aggregates_.Load(AggregatesPath(), sessions_.Count()) ||
+        !progress_.Load(ProgressPath(), sessions_.Count())) {
+        RebuildAggregates();
+    }
+    return true;
+}
+
+bool SessionLog::AppendSession(SessionLogRecord record,
+                               const QVector<KeystrokeLogRecord> &keystrokes) {
+    if (!open_) {
+        return false;
+    }
+
+    if (!writer_) {
+        if (!WriteSession(sessions_, keystrokes_, &record, keystrokes)) {
+            return false;
+        }
+        aggregates_.Add(record, keystrokes.constData(), static_cast<int>(record.keystroke_count));
+        aggregates_.Save(AggregatesPath());
+        progress_.Add(record, keystrokes.constData(), static_cast<int>(record.keystroke_count));
+        progress_.Save(ProgressPath());
+        return true;
+    }
+
+    // Visible right away; a failed write only shows after a restart
+    record.first_keystroke = static_cast<quint64>(KeystrokeCount());
+    record.keystroke_count = static_cast<quint32>(keystrokes.size());
+    pending_keystrokes_ += keystrokes;
+    pending_sessions_.append(record);
+    aggregates_.Add(record, keystrokes.constData(), keystrokes.size());
+    progress_.Add(record, keystrokes.constData(), keystrokes.size());
+
+    // The writer saves snapshots: the aggregates are a flat struct copied in
+    // full each time, while the progress series' vectors are implicitly
+    // shared and only copied when the next session modifies them
+    const HistoryAggregates aggregates = aggregates_;
+    const ProgressSeries progress = progress_;
+    const QString aggregates_path = AggregatesPath();
+    const QString progress_path = ProgressPath();
+    writer_->Post([this, record, keystrokes, aggregates, progress, aggregates_path,
+                   progress_path]() mutable {
+        if (OpenWriteFiles() &&
+            WriteSession(write_sessions_, write_keystrokes_, &record, keystrokes)) {
+            aggregates.Save(aggregates_path);
+            progress.Save(progress_path);
+        }
+    });
+    return true;
+}
+
+bool SessionLog::Clear() {
+    if (!open_) {
+        return false;
+    }
+    aggregates_.Reset();
+    progress_.Reset();
+
+    if (!writer_) {
+        bool ok = sessions_.Clear() && keystrokes_.Clear();
+        aggregates_.Save(AggregatesPath());
+        progress_.Save(ProgressPath());
+        return ok;
+    }
+
+    // A mapped file cannot be truncated on every platform; nothing is read
+    // from disk any more after this
+    sessions_.Close();
+    keystrokes_.Close();
+    pending_sessions_.clear();
+    pending_keystrokes_.clear();
+    const HistoryAggregates aggregates = aggregates_;
+    const QString aggregates_path = AggregatesPath();
+    const QString progress_path = ProgressPath();
+    writer_->Post([this, aggregates, aggregates_path, progress_path]() {
+        if (OpenWriteFiles()) {
+            write_sessions_.Clear();
+            write_keystrokes_.Clear();
+        }
+        aggregates.Save(aggregates_path);
+        ProgressSeries().Save(progress_path);
+    });
+    return true;
+}
+
+SessionLogRecord SessionLog::Session(int index) const {
+    SessionLogRecord record;
+    if (const uchar *data = sessions_.RecordAt(index)) {
+        std::memcpy(&record, data, sizeof(record));
+    } else if (index >= sessions_.Count()) {
+        record = pending_sessions_.value(index - static_cast<int>(sessions_.Count()));
+    }
+    return record;
+}
+
+KeystrokeLogRecord SessionLog::Keystroke(qint64 index) const {
+    KeystrokeLogRecord record;
+    if (const uchar *data = keystrokes_.RecordAt(index)) {
+        std::memcpy(&record, data, sizeof(record));
+    } else if (index >= keystrokes_.Count()) {
+        record = pending_keystrokes_.value(static_cast<int>(index - keystrokes_.Count()));
+    }
+    return record;
+}
+
+QString SessionLog::AggregatesPath() const {
+    return directory_ + QStringLiteral("/aggregates.bin");
+}
+
+QString SessionLog::ProgressPath() const {
+    return directory_ + QStringLiteral("/progress.bin");
+}
+
+bool SessionLog::WriteSession(RecordFile &sessions, RecordFile &keystrokes,
+                              SessionLogRecord *record,
+                              const QVector<KeystrokeLogRecord> &keystroke_records) {
+    // Keystrokes go first so a session never points past the keystroke log
+    record->first_keystroke = static_cast<quint64>(keystrokes.Count());
+    record->keystroke_count = static_cast<quint32>(keystroke_records.size());
+    if (!keystrokes.Append(keystroke_records.constData(), keystroke_records.size())) {
+        record->keystroke_count = 0;
+    }
+    return sessions.Append(record, 1);
+}
+
+bool SessionLog::OpenWriteFiles() {
+    if (write_sessions_.IsOpen()) {
+        return true;
+    }
+    if (!write_sessions_.Open(directory_ + QStringLiteral("/sessions.bin"), false) ||
+        !write_keystrokes_.Open(directory_ + QStringLiteral("/keystrokes.bin"), false)) {
+        write_sessions_.Close();
+        write_keystrokes_.Close();
+        return false;
+    }
+    return true;
+}
+
+void SessionLog::RebuildAggregates() {
+    aggregates_.Reset();
+    progress_.Reset();
+    QVector<KeystrokeLogRecord> keystrokes;
+    const int count = SessionCount();
+    for (int i = 0; i < count; ++i) {
+        const SessionLogRecord record = Session(i);
+        keystrokes.clear();
+        if (record.first_keystroke + record.keystroke_count <=
+            static_cast<quint64>(KeystrokeCount())) {
+            keystrokes.reserve(static_cast<int>(record.keystroke_count));
+            for (quint32 k = 0; k < record.keystroke_count; ++k) {
+                keystrokes.append(Keystroke(static_cast<qint64>(record.first_keystroke + k)));
+            }
+        }
+        aggregates_.Add(record, keystrokes.constData(), keystrokes.size());
+        progress_.Add(record, keystrokes.constData(), keystrokes.size());
+    }
+    aggregates_.Save(AggregatesPath());
+    progress_.Save(ProgressPath());
+}
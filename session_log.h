@@ -0,0 +1,165 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include "history_aggregates.h"
+#include "progress_series.h"
+
+class PersistenceWriter;
+
+// On-disk session record. Fixed size and layout so the log can be mapped
+// and indexed directly; fields only ever get added in place of reserved ones.
+struct SessionLogRecord {
+    qint64 timestamp_ms = 0;        // session end, UTC ms since epoch
+    qint64 duration_us = 0;
+    qint32 total_rounds = 0;
+    qint32 correct_rounds = 0;
+    quint8 difficulty = 0;
+    quint8 mode = 0;
+    quint16 reserved0 = 0;
+    qint32 reaction_count = 0;
+    qint64 reaction_min_ns = 0;
+    qint64 reaction_median_ns = 0;
+    qint64 reaction_p95_ns = 0;
+    qint64 reaction_p99_ns = 0;
+    quint64 first_keystroke = 0;    // index into the keystroke log
+    quint32 keystroke_count = 0;
+    quint32 reserved1 = 0;
+};
+static_assert(sizeof(SessionLogRecord) == 80, "SessionLogRecord layout changed");
+
+// Outcome of one key press during training
+enum class KeystrokeResult : quint8 {
+    kMiss = 0,
+    kStep = 1,          // correct key inside a sequence
+    kComplete = 2,      // correct key that finished the prompt
+    kTooSlow = 3        // correct sequence key after more than the gap budget;
+                        // counts as a miss
+};
+
+// On-disk per-keystroke record
+struct KeystrokeLogRecord {
+    qint64 offset_ns = 0;           // since session start
+    qint64 reaction_ns = 0;         // prompt reaction time, kComplete only
+    qint32 item_id = -1;            // index into the training item catalog
+    qint32 key = 0;                 // Qt::Key
+    quint32 modifiers = 0;          // Qt::KeyboardModifiers
+    quint8 result = 0;              // KeystrokeResult
+    quint8 expected_slot = 0;       // kMiss, kTooSlow: HistoryAggregates::KeySlot of the expected key
+    // Time since the previous key of the same sequence in 100 us units,
+    // saturated; 0 for a sequence's first key, after a pause and outside
+    // sequences
+    quint16 step_gap_100us = 0;
+};
+static_assert(sizeof(KeystrokeLogRecord) == 32, "KeystrokeLogRecord layout changed");
+
+// Append-only file of fixed-size records behind a small versioned header.
+// Records are read through a read-only memory mapping of the whole file.
+class RecordFile {
+public:
+    RecordFile(const char *magic, quint32 version, quint32 record_size);
+    ~RecordFile();
+
+    // Without map the file is only appended to and RecordAt() returns nothing
+    bool Open(const QString &path, bool map = true);
+    void Close();
+
+    bool Append(const void *records, int count);
+    bool Clear();
+
+    bool IsOpen() const { return file_.isOpen(); }
+    qint64 Count() const { return count_; }
+    const uchar *RecordAt(qint64 index) const;
+
+private:
+    struct Header {
+        char magic[8];
+        quint32 version;
+        quint32 record_size;
+        quint32 endian_tag;
+        quint32 reserved;
+    };
+
+    bool WriteHeader();
+    bool Remap();
+
+    const char *magic_;
+    quint32 version_;
+    quint32 record_size_;
+    QFile file_;
+    uchar *map_ = nullptr;
+    bool mapped_ = true;
+    qint64 count_ = 0;
+
+    static constexpr quint32 kEndianTag = 0x01020304;
+};
+
+// Session history: one record per session plus every keystroke of it.
+// Saving a session appends to both files and updates the cached aggregates
+// and progress rollups, O(1) regardless of history size. With a writer set, the files are written
+// on the writer's thread and records saved since Open() are read from memory.
+class SessionLog {
+public:
+    explicit SessionLog(const QString &directory = DefaultDirectory());
+    ~SessionLog();
+    SessionLog(const SessionLog &) = delete;
+    SessionLog &operator=(const SessionLog &) = delete;
+
+    // Before Open(); writer must outlive the log
+    void SetWriter(PersistenceWriter *writer) { writer_ = writer; }
+
+    static QString DefaultDirectory();
+
+    bool Open();
+    bool IsOpen() const { return open_; }
+
+    bool AppendSession(SessionLogRecord record,
+                       const QVector<KeystrokeLogRecord> &keystrokes);
+    bool Clear();
+
+    // Sessions in chronological order, oldest first
+    int SessionCount() const {
+        return static_cast<int>(sessions_.Count()) + pending_sessions_.size();
+    }
+    SessionLogRecord Session(int index) const;
+
+    qint64 KeystrokeCount() const { return keystrokes_.Count() + pending_keystrokes_.size(); }
+    KeystrokeLogRecord Keystroke(qint64 index) const;
+
+    const HistoryAggregates &Aggregates() const { return aggregates_; }
+    const ProgressSeries &Progress() const { return progress_; }
+
+private:
+    QString AggregatesPath() const;
+    QString ProgressPath() const;
+    // Rebuilds the aggregates and the progress rollups from the log
+    void RebuildAggregates();
+    // Appends one session to a pair of files; record's keystroke fields are
+    // set from what was actually written
+    static bool WriteSession(RecordFile &sessions, RecordFile &keystrokes,
+                             SessionLogRecord *record,
+                             const QVector<KeystrokeLogRecord> &keystroke_records);
+    // Writer thread: opens the unmapped handles on first use
+    bool OpenWriteFiles();
+
+    QString directory_;
+    RecordFile sessions_;
+    RecordFile keystrokes_;
+    HistoryAggregates aggregates_;
+    ProgressSeries progress_;
+    bool open_ = false;
+
+    PersistenceWriter *writer_ = nullptr;
+    // Writer thread only
+    RecordFile write_sessions_;
+    RecordFile write_keystrokes_;
+    // Saved since the files were mapped, when writes are deferred
+    QVector<SessionLogRecord> pending_sessions_;
+    QVector<KeystrokeLogRecord> pending_keystrokes_;
+
+    static constexpr quint32 kSessionVersion = 1;
+    static constexpr quint32 kKeystrokeVersion = 1;
+};
@@ -0,0 +1,258 @@
+#include "sound_engine.h"
+
+#include "reaction_timing.h"
+
+#include <QIODevice>
+#include <QVector>
+#include <QtMath>
+
+#include <atomic>
+#include <cstring>
+
+#ifdef LHT_HAVE_MULTIMEDIA
+#include <QAudioFormat>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <QAudioDevice>
+#include <QAudioSink>
+#include <QMediaDevices>
+#else
+#include <QAudioDeviceInfo>
+#include <QAudioOutput>
+#endif
+#endif
+
+namespace {
+
+constexpr int kSoundCount = 2;
+constexpr int kPreferredSampleRate = 48000;
+// Requested device buffer; backends may round it up
+constexpr int kBufferMs = 5;
+
+// Short tone with a fast attack and exponential decay
+QVector<qint16> Synthesize(int sample_rate, double frequency, int duration_ms, bool square) {
+    const int frames = sample_rate * duration_ms / 1000;
+    const int attack = qMax(1, sample_rate / 500);      // 2 ms
+    QVector<qint16> samples(frames);
+    for (int i = 0; i < frames; ++i) {
+        const double t = static_cast<double>(i) / sample_rate;
+        double wave = qSin(2.0 * M_PI * frequency * t);
+        if (square) {
+            wave = (wave >= 0.0) ? 0.6 : -0.6;
+        }
+        const double envelope = qMin(1.0, static_cast<double>(i) / attack) *
+                                qExp(-5.0 * i / frames);
+        samples[i] = static_cast<qint16>(wave * envelope * 0.3 * 32767.0);
+    }
+    return samples;
+}
+
+}  // namespace
+
+// State written by the GUI thread and read by the audio thread, or the
+// other way round; atomics only.
+struct SoundEngine::Shared {
+    std::atomic<int> pending{0};            // Sound + 1, 0 when idle
+    std::atomic<qint64> pending_ns{0};      // ReactionClock time of Play()
+    std::atomic<bool> available{false};
+
+    std::atomic<int> count{0};
+    std::atomic<qint64> last_ns{0};
+    std::atomic<qint64> max_ns{0};
+    std::atomic<qint64> buffer_ns{0};
+};
+
+// ===== Mixer =====
+
+// Endless PCM stream pulled by the audio device: the current sound, then
+// silence. Runs on the audio thread.
+class SoundEngine::Mixer : public QIODevice {
+public:
+    Mixer(Shared *shared, int sample_rate, int channels)
+        : shared_(shared),
+          channels_(channels) {
+        sounds_[static_cast<int>(SoundEngine::Sound::kCorrect)] =
+            Synthesize(sample_rate, 880.0, 60, false);
+        sounds_[static_cast<int>(SoundEngine::Sound::kWrong)] =
+            Synthesize(sample_rate, 220.0, 120, true);
+    }
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override {
+        return QIODevice::bytesAvailable() + (1 << 16);
+    }
+
+protected:
+    qint64 readData(char *data, qint64 max_size) override {
+        const int frame_bytes = channels_ * static_cast<int>(sizeof(qint16));
+        const qint64 frames = max_size / frame_bytes;
+
+        const int pending = shared_->pending.exchange(0, std::memory_order_acquire);
+        if (pending > 0) {
+            voice_ = pending - 1;
+            position_ = 0;
+            RecordLatency(shared_->pending_ns.load(std::memory_order_relaxed));
+        }
+
+        const QVector<qint16> *samples = (voice_ >= 0) ? &sounds_[voice_] : nullptr;
+        char *out = data;
+        for (qint64 f = 0; f < frames; ++f) {
+            qint16 value = 0;
+            if (samples && position_ < samples->size()) {
+                value = samples->at(position_++);
+            }
+            for (int c = 0; c < channels_; ++c) {
+                std::memcpy(out, &value, sizeof(value));
+                out += sizeof(value);
+            }
+        }
+        if (samples && position_ >= samples->size()) {
+            voice_ = -1;
+        }
+        return frames * frame_bytes;
+    }
+
+    qint64 writeData(const char *data, qint64 size) override {
+        Q_UNUSED(data);
+        Q_UNUSED(size);
+        return -1;
+    }
+
+private:
+    void RecordLatency(qint64 requested_ns) {
+        // Everything already in the device buffer plays before this sample
+        const qint64 latency = ReactionClock::NowNs() - requested_ns +
+                               shared_->buffer_ns.load(std::memory_order_relaxed);
+        shared_->last_ns.store(latency, std::memory_order_relaxed);
+        if (latency > shared_->max_ns.load(std::memory_order_relaxed)) {
+            shared_->max_ns.store(latency, std::memory_order_relaxed);
+        }
+        shared_->count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Shared *shared_;
+    int channels_;
+    QVector<qint16> sounds_[kSoundCount];
+    int voice_ = -1;
+    int position_ = 0;
+};
+
+// ===== Output =====
+
+// Owns the audio device; created, used and destroyed on the audio thread
+class SoundEngine::Output : public QObject {
+public:
+    explicit Output(Shared *shared)
+        : shared_(shared) {}
+
+    void Start();
+    void Stop();
+
+private:
+    Shared *shared_;
+#ifdef LHT_HAVE_MULTIMEDIA
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    QAudioSink *sink_ = nullptr;
+#else
+    QAudioOutput *sink_ = nullptr;
+#endif
+    Mixer *mixer_ = nullptr;
+#endif
+};
+
+void SoundEngine::Output::Start() {
+#ifdef LHT_HAVE_MULTIMEDIA
+    QAudioFormat format;
+    format.setSampleRate(kPreferredSampleRate);
+    format.setChannelCount(1);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    const QAudioDevice device = QMediaDevices::defaultAudioOutput();
+    if (device.isNull()) return;
+    format.setSampleFormat(QAudioFormat::Int16);
+    if (!device.isFormatSupported(format)) {
+        format = device.preferredFormat();
+        format.setSampleFormat(QAudioFormat::Int16);
+        if (!device.isFormatSupported(format)) return;
+    }
+    sink_ = new QAudioSink(device, format, this);
+#else
+    const QAudioDeviceInfo device = QAudioDeviceInfo::defaultOutputDevice();
+    if (device.isNull()) return;
+    format.setSampleSize(16);
+    format.setSampleType(QAudioFormat::SignedInt);
+    format.setByteOrder(QSysInfo::ByteOrder == QSysInfo::LittleEndian
+                            ? QAudioFormat::LittleEndian
+                            : QAudioFormat::BigEndian);
+    format.setCodec(QStringLiteral("audio/pcm"));
+    if (!device.isFormatSupported(format)) {
+        format = device.nearestFormat(format);
+        if (format.sampleSize() != 16 || format.sampleType() != QAudioFormat::SignedInt) return;
+    }
+    sink_ = new QAudioOutput(device, format, this);
+#endif
+
+    const int bytes_per_second = format.sampleRate() * format.channelCount() *
+                                 static_cast<int>(sizeof(qint16));
+    sink_->setBufferSize(bytes_per_second * kBufferMs / 1000);
+
+    mixer_ = new Mixer(shared_, format.sampleRate(), format.channelCount());
+    mixer_->open(QIODevice::ReadOnly);
+    sink_->start(mixer_);
+
+    // The backend settles on the real buffer size once started
+    const qint64 buffer_bytes = sink_->bufferSize();
+    shared_->buffer_ns.store(buffer_bytes * 1000000000LL / bytes_per_second);
+    shared_->available.store(true);
+#endif
+}
+
+void SoundEngine::Output::Stop() {
+    shared_->available.store(false);
+#ifdef LHT_HAVE_MULTIMEDIA
+    if (sink_) {
+        sink_->stop();
+        delete sink_;
+        sink_ = nullptr;
+    }
+    delete mixer_;
+    mixer_ = nullptr;
+#endif
+}
+
+// ===== SoundEngine =====
+
+SoundEngine::SoundEngine(QObject *parent)
+    : QObject(parent),
+      shared_(new Shared()),
+      output_(new Output(shared_)) {
+    output_->moveToThread(&thread_);
+    thread_.start(QThread::TimeCriticalPriority);
+    QMetaObject::invokeMethod(output_, [this]() { output_->Start(); }, Qt::QueuedConnection);
+}
+
+SoundEngine::~SoundEngine() {
+    QMetaObject::invokeMethod(output_, [this]() { output_->Stop(); },
+                              Qt::BlockingQueuedConnection);
+    thread_.quit();
+    thread_.wait();
+    delete output_;
+    delete shared_;
+}
+
+bool SoundEngine::IsAvailable() const {
+    return shared_->available.load();
+}
+
+void SoundEngine::Play(Sound sound) {
+    if (!shared_->available.load(std::memory_order_relaxed)) return;
+    shared_->pending_ns.store(ReactionClock::NowNs(), std::memory_order_relaxed);
+    shared_->pending.store(static_cast<int>(sound) + 1, std::memory_order_release);
+}
+
+SoundLatency SoundEngine::Latency() const {
+    SoundLatency latency;
+    latency.count = shared_->count.load();
+    latency.last_ns = shared_->last_ns.load();
+    latency.max_ns = shared_->max_ns.load();
+    latency.buffer_ns = shared_->buffer_ns.load();
+    return latency;
+}
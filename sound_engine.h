@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QObject>
+#include <QThread>
+#include <QtGlobal>
+
+// Playback latency as measured by the audio thread: time from Play() until
+// the sample was handed to the device, plus the device buffer in front of it
+struct SoundLatency {
+    int count = 0;
+    qint64 last_ns = 0;
+    qint64 max_ns = 0;
+    qint64 buffer_ns = 0;       // output buffer duration, included above
+};
+
+// Feedback sounds. The samples are synthesized into memory at startup and
+// the audio device is opened once, with a short buffer, on a dedicated
+// thread that keeps pulling from an in-memory mixer. Play() only sets an
+// atomic flag, so it costs the key handler nothing. Without Qt Multimedia
+// the engine builds but stays silent.
+class SoundEngine : public QObject {
+    Q_OBJECT
+
+public:
+    enum class Sound {
+        kCorrect,
+        kWrong
+    };
+
+    explicit SoundEngine(QObject *parent = nullptr);
+    ~SoundEngine() override;
+
+    // Whether an output device was opened
+    bool IsAvailable() const;
+
+    // Safe to call from any thread; never blocks
+    void Play(Sound sound);
+
+    SoundLatency Latency() const;
+
+private:
+    struct Shared;
+    class Mixer;
+    class Output;
+
+    Shared *shared_ = nullptr;
+    Output *output_ = nullptr;
+    QThread thread_;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <atomic>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Push fails instead of blocking when the queue is full.
+template <typename T, int Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+public:
+    // Producer side
+    bool Push(const T &value) {
+        const quint32 tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= static_cast<quint32>(Capacity)) {
+            return false;
+        }
+        items_[tail & kMask] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool Pop(T *value) {
+        const quint32 head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *value = items_[head & kMask];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static constexpr quint32 kMask = Capacity - 1;
+
+    // Separate cache lines so the two threads do not contend on one
+    alignas(64) std::atomic<quint32> head_{0};
+    alignas(64) std::atomic<quint32> tail_{0};
+    T items_[Capacity];
+};
@@ -0,0 +1,47 @@
+#include "startup_trace.h"
+
+#include <cstdio>
+
+#include "reaction_timing.h"
+
+namespace StartupTrace {
+
+namespace {
+
+bool enabled = false;
+qint64 start_ns = 0;
+qint64 last_ns = 0;
+
+double Ms(qint64 ns) {
+    return static_cast<double>(ns) / 1e6;
+}
+
+}  // namespace
+
+void Enable() {
+    enabled = true;
+    start_ns = ReactionClock::NowNs();
+    last_ns = start_ns;
+}
+
+bool IsEnabled() {
+    return enabled;
+}
+
+void Mark(const char *phase) {
+    if (!enabled) return;
+    const qint64 now_ns = ReactionClock::NowNs();
+    std::fprintf(stderr, "startup %-20s %8.2f ms  (at %8.2f ms)\n",
+                 phase, Ms(now_ns - last_ns), Ms(now_ns - start_ns));
+    last_ns = now_ns;
+}
+
+void Finish(const char *phase) {
+    if (!enabled) return;
+    Mark(phase);
+    std::fprintf(stderr, "startup %-20s %8.2f ms\n", "total", Ms(last_ns - start_ns));
+    std::fflush(stderr);
+    enabled = false;
+}
+
+}  // namespace StartupTrace
@@ -0,0 +1,17 @@
+#pragma once
+
+// Time spent in each startup phase, printed to stderr when the app is run
+// with --startup-trace. Phases are marked in order and each line shows the
+// phase's own time and the total since Enable(). Does nothing when disabled.
+namespace StartupTrace {
+
+// Starts the clock; call first thing in main()
+void Enable();
+bool IsEnabled();
+
+// Ends the phase that ran since the previous mark
+void Mark(const char *phase);
+// Marks the last phase and prints the total; later calls do nothing
+void Finish(const char *phase);
+
+}  // namespace StartupTrace
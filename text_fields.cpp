@@ -0,0 +1,96 @@
+#include "text_fields.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Writes value in decimal; returns the length
+int FormatUnsigned(char *out, quint64 value, int min_digits) {
+    char reversed[24];
+    int length = 0;
+    do {
+        reversed[length++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (length < min_digits && length < static_cast<int>(sizeof(reversed))) {
+        reversed[length++] = '0';
+    }
+    for (int i = 0; i < length; ++i) {
+        out[i] = reversed[length - 1 - i];
+    }
+    return length;
+}
+
+}  // namespace
+
+void TextFields::Resize(int count) {
+    count_ = qBound(0, count, kMaxFields);
+    for (int i = 0; i < count_; ++i) {
+        fields_[i].length = 0;
+    }
+}
+
+bool TextFields::SetInt(int field, qint64 value, int min_digits) {
+    char text[kFieldCapacity];
+    int length = 0;
+    if (value < 0) {
+        text[length++] = '-';
+    }
+    const quint64 magnitude = value < 0 ? 0 - static_cast<quint64>(value)
+                                        : static_cast<quint64>(value);
+    length += FormatUnsigned(text + length, magnitude, qBound(1, min_digits, 19));
+    return Store(field, text, length);
+}
+
+bool TextFields::SetFixed(int field, double value, int decimals) {
+    // Out of range for the integer path below, and never shown in practice
+    if (!std::isfinite(value) || std::fabs(value) >= 1e12) {
+        return SetPlaceholder(field);
+    }
+    decimals = qBound(0, decimals, 6);
+    quint64 scale = 1;
+    for (int i = 0; i < decimals; ++i) {
+        scale *= 10;
+    }
+    const quint64 scaled = static_cast<quint64>(std::llround(std::fabs(value) * scale));
+
+    char text[kFieldCapacity];
+    int length = 0;
+    if (value < 0 && scaled != 0) {
+        text[length++] = '-';
+    }
+    length += FormatUnsigned(text + length, scaled / scale, 1);
+    if (decimals > 0) {
+        text[length++] = '.';
+        length += FormatUnsigned(text + length, scaled % scale, decimals);
+    }
+    return Store(field, text, length);
+}
+
+bool TextFields::SetClock(int field, qint64 seconds) {
+    seconds = qMax<qint64>(0, seconds);
+    char text[kFieldCapacity];
+    int length = FormatUnsigned(text, static_cast<quint64>(seconds / 60), 2);
+    text[length++] = ':';
+    length += FormatUnsigned(text + length, static_cast<quint64>(seconds % 60), 2);
+    return Store(field, text, length);
+}
+
+bool TextFields::SetPlaceholder(int field) {
+    return Store(field, "--", 2);
+}
+
+bool TextFields::Store(int field, const char *text, int length) {
+    if (field < 0 || field >= count_) {
+        return false;
+    }
+    Field &target = fields_[field];
+    length = qMin(length, kFieldCapacity);
+    if (target.length == length && std::memcmp(target.text, text, length) == 0) {
+        return false;
+    }
+    std::memcpy(target.text, text, length);
+    target.length = length;
+    return true;
+}
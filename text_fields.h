@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <array>
+
+// The changing parts of a line of text whose wording is fixed, such as the
+// numbers of the stats line. Each field formats into its own inline buffer,
+// so updating a value on every key never allocates. Setters report whether
+// the text actually changed, so callers can skip a repaint.
+class TextFields {
+public:
+    static constexpr int kMaxFields = 12;
+    static constexpr int kFieldCapacity = 24;
+
+    void Resize(int count);
+    int Count() const { return count_; }
+
+    // Decimal integer, zero-padded to min_digits
+    bool SetInt(int field, qint64 value, int min_digits = 1);
+    // Fixed point with 0-6 decimals, as QString::number(value, 'f', decimals)
+    bool SetFixed(int field, double value, int decimals);
+    // mm:ss, minutes past 99 keep growing
+    bool SetClock(int field, qint64 seconds);
+    // "--", for a value that is not known yet
+    bool SetPlaceholder(int field);
+
+    // ASCII, not NUL-terminated
+    const char *Data(int field) const { return fields_[field].text; }
+    int Length(int field) const { return fields_[field].length; }
+
+private:
+    struct Field {
+        char text[kFieldCapacity];
+        int length = 0;
+    };
+
+    bool Store(int field, const char *text, int length);
+
+    std::array<Field, kMaxFields> fields_;
+    int count_ = 0;
+};
@@ -0,0 +1,306 @@
+#include "theme.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QLabel>
+#include <QPair>
+#include <QSettings>
+#include <QWidget>
+
+Theme Theme::Dark() {
+    Theme theme;
+    theme.id = QStringLiteral("dark");
+    theme.name = QStringLiteral("暗色");
+    theme.toggle_icon = QStringLiteral("🌙");
+
+    theme.background = QColor(0x1a, 0x1a, 0x2e);
+    theme.text = QColor(0xea, 0xea, 0xea);
+    theme.button_background = QColor(0x16, 0x21, 0x3e);
+    theme.button_border = QColor(0x0f, 0x34, 0x60);
+    theme.button_hover = QColor(0x0f, 0x34, 0x60);
+    theme.button_disabled_background = QColor(0x0d, 0x1b, 0x2a);
+    theme.button_disabled_text = QColor(0x5c, 0x5c, 0x5c);
+    theme.error_text = QColor(0xe9, 0x45, 0x60);
+    theme.frame_border = QColor(0x0f, 0x34, 0x60);
+    theme.input_background = QColor(0x16, 0x21, 0x3e);
+    theme.progress_background = QColor(0x16, 0x21, 0x3e);
+    theme.progress_chunk = QColor(0xe9, 0x45, 0x60);
+
+    theme.keyboard.key_background = QColor(0x16, 0x21, 0x3e);
+    theme.keyboard.key_text = QColor(0xea, 0xea, 0xea);
+    theme.keyboard.key_border = QColor(0x0f, 0x34, 0x60);
+    theme.keyboard.highlight_background = QColor(0xe9, 0x45, 0x60);
+    theme.keyboard.highlight_text = QColor(Qt::white);
+    theme.keyboard.highlight_border = QColor(0xff, 0x6b, 0x6b);
+    theme.keyboard.modifier_background = QColor(0x0f, 0x34, 0x60);
+    theme.keyboard.modifier_text = QColor(0x00, 0xd9, 0xff);
+    theme.keyboard.modifier_border = QColor(0x00, 0xd9, 0xff);
+    return theme;
+}
+
+Theme Theme::Light() {
+    Theme theme;
+    theme.id = QStringLiteral("light");
+    theme.name = QStringLiteral("亮色");
+    theme.toggle_icon = QStringLiteral("☀️");
+
+    theme.background = QColor(0xf5, 0xf5, 0xf5);
+    theme.text = QColor(0x33, 0x33, 0x33);
+    theme.button_background = QColor(0xff, 0xff, 0xff);
+    theme.button_border = QColor(0xcc, 0xcc, 0xcc);
+    theme.button_hover = QColor(0xe8, 0xe8, 0xe8);
+    theme.button_disabled_background = QColor(0xf0, 0xf0, 0xf0);
+    theme.button_disabled_text = QColor(0x99, 0x99, 0x99);
+    theme.error_text = QColor(0xd3, 0x2f, 0x2f);
+    theme.frame_border = QColor(0xcc, 0xcc, 0xcc);
+    theme.input_background = QColor(0xff, 0xff, 0xff);
+    theme.progress_background = QColor(0xe0, 0xe0, 0xe0);
+    theme.progress_chunk = QColor(0x19, 0x76, 0xd2);
+
+    theme.keyboard.key_background = QColor(0xff, 0xff, 0xff);
+    theme.keyboard.key_text = QColor(0x33, 0x33, 0x33);
+    theme.keyboard.key_border = QColor(0xcc, 0xcc, 0xcc);
+    theme.keyboard.highlight_background = QColor(0x19, 0x76, 0xd2);
+    theme.keyboard.highlight_text = QColor(Qt::white);
+    theme.keyboard.highlight_border = QColor(0x15, 0x65, 0xc0);
+    theme.keyboard.modifier_background = QColor(0xe3, 0xf2, 0xfd);
+    theme.keyboard.modifier_text = QColor(0x19, 0x76, 0xd2);
+    theme.keyboard.modifier_border = QColor(0x19, 0x76, 0xd2);
+    return theme;
+}
+
+// ===== ThemeRegistry =====
+
+ThemeRegistry::ThemeRegistry() {
+    AddTheme(Theme::Dark());
+    AddTheme(Theme::Light());
+}
+
+void ThemeRegistry::LoadUserThemes(const QString &directory) {
+    const QDir dir(directory);
+    const QStringList files = dir.entryList({QStringLiteral("*.ini")}, QDir::Files, QDir::Name);
+
+    for (const QString &file_name : files) {
+        QSettings settings(dir.filePath(file_name), QSettings::IniFormat);
+        Theme theme = Theme::Dark();
+
+        // Ids end up inside stylesheet selectors; keep them to safe characters
+        QString id;
+        for (QChar ch : QFileInfo(file_name).completeBaseName()) {
+            if (ch.isLetterOrNumber() || ch == QLatin1Char('_') || ch == QLatin1Char('-')) {
+                id += ch;
+            }
+        }
+        if (id.isEmpty()) continue;
+        theme.id = QStringLiteral("user_") + id;
+        if (IndexOf(theme.id) >= 0) continue;
+
+        theme.name = settings.value(QStringLiteral("name"), id).toString();
+        theme.toggle_icon = settings.value(QStringLiteral("toggle_icon"), QStringLiteral("🎨")).toString();
+
+        auto color = [&settings](const char *key, QColor *out) {
+            const QColor value(settings.value(QLatin1String(key)).toString());
+            if (value.isValid()) {
+                *out = value;
+            }
+        };
+        color("background", &theme.background);
+        color("text", &theme.text);
+        color("button_background", &theme.button_background);
+        color("button_border", &theme.button_border);
+        color("button_hover", &theme.button_hover);
+        color("button_disabled_background", &theme.button_disabled_background);
+        color("button_disabled_text", &theme.button_disabled_text);
+        color("error_text", &theme.error_text);
+        color("frame_border", &theme.frame_border);
+        color("input_background", &theme.input_background);
+        color("progress_background", &theme.progress_background);
+        color("progress_chunk", &theme.progress_chunk);
+        color("key_background", &theme.keyboard.key_background);
+        color("key_text", &theme.keyboard.key_text);
+        color("key_border", &theme.keyboard.key_border);
+        color("highlight_background", &theme.keyboard.highlight_background);
+        color("highlight_text", &theme.keyboard.highlight_text);
+        color("highlight_border", &theme.keyboard.highlight_border);
+        color("modifier_background", &theme.keyboard.modifier_background);
+        color("modifier_text", &theme.keyboard.modifier_text);
+        color("modifier_border", &theme.keyboard.modifier_border);
+
+        AddTheme(theme);
+    }
+}
+
+int ThemeRegistry::IndexOf(const QString &id) const {
+    for (int i = 0; i < themes_.size(); ++i) {
+        if (themes_.at(i).id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const QString &ThemeRegistry::StyleSheet() const {
+    if (style_sheet_.isEmpty()) {
+        for (const Theme &theme : themes_) {
+            style_sheet_ += BuildRules(theme);
+        }
+    }
+    return style_sheet_;
+}
+
+void ThemeRegistry::AddTheme(const Theme &theme) {
+    themes_.append(theme);
+    palettes_.append(BuildPalette(theme));
+    style_sheet_.clear();
+}
+
+QPalette ThemeRegistry::BuildPalette(const Theme &theme) {
+    QPalette palette;
+    palette.setColor(QPalette::Window, theme.background);
+    palette.setColor(QPalette::WindowText, theme.text);
+    palette.setColor(QPalette::Base, theme.input_background);
+    palette.setColor(QPalette::Text, theme.text);
+    palette.setColor(QPalette::Button, theme.button_background);
+    palette.setColor(QPalette::ButtonText, theme.text);
+    palette.setColor(QPalette::Highlight, theme.button_hover);
+    palette.setColor(QPalette::HighlightedText, theme.text);
+    palette.setColor(QPalette::Mid, theme.frame_border);
+    palette.setColor(QPalette::Disabled, QPalette::ButtonText, theme.button_disabled_text);
+    palette.setColor(QPalette::Disabled, QPalette::Text, theme.button_disabled_text);
+    return palette;
+}
+
+bool ThemeRegistry::HasThemedRules(const QWidget *widget) {
+    // One entry per widget selector in BuildRules
+    static const char *const kClasses[] = {
+        "QPushButton", "QGroupBox", "QComboBox", "QSpinBox",
+        "QLineEdit", "QProgressBar", "QScrollArea", "QListView",
+    };
+    for (const char *class_name : kClasses) {
+        if (widget->inherits(class_name)) {
+            return true;
+        }
+    }
+    if (!qobject_cast<const QLabel *>(widget)) {
+        return false;
+    }
+    const QString &name = widget->objectName();
+    return name == QLatin1String("errorLabel") || name == QLatin1String("profileOverlay") ||
+           name == QLatin1String("keyLabel");
+}
+
+QString ThemeRegistry::BuildRules(const Theme &theme) {
+    // $W is the scoped window selector, @name a color of the theme. Plain
+    // widgets, labels and check boxes have no rule and take background and
+    // text from the palette.
+    QString rules = QStringLiteral(
+        "$W QPushButton {"
+        "  background-color: @button_background;"
+        "  color: @text;"
+        "  border: 1px solid @button_border;"
+        "  border-radius: 6px;"
+        "  padding: 8px 16px;"
+        "  font-size: 14px;"
+        "}"
+        "$W QPushButton:hover {"
+        "  background-color: @button_hover;"
+        "}"
+        "$W QPushButton:disabled {"
+        "  background-color: @button_disabled_background;"
+        "  color: @button_disabled_text;"
+        "}"
+        "$W QLabel#errorLabel {"
+        "  color: @error_text;"
+        "  font-weight: bold;"
+        "}"
+        "$W QLabel#profileOverlay {"
+        "  background-color: @input_background;"
+        "  border: 1px solid @frame_border;"
+        "  padding: 4px;"
+        "}"
+        "$W QGroupBox {"
+        "  border: 1px solid @frame_border;"
+        "  border-radius: 6px;"
+        "  margin-top: 10px;"
+        "  padding-top: 10px;"
+        "}"
+        "$W QGroupBox::title {"
+        "  subcontrol-origin: margin;"
+        "  left: 10px;"
+        "  padding: 0 5px;"
+        "}"
+        "$W QComboBox, $W QSpinBox {"
+        "  background-color: @input_background;"
+        "  color: @text;"
+        "  border: 1px solid @frame_border;"
+        "  border-radius: 4px;"
+        "  padding: 4px 8px;"
+        "}"
+        "$W QProgressBar {"
+        "  background-color: @progress_background;"
+        "  border: none;"
+        "  border-radius: 4px;"
+        "}"
+        "$W QProgressBar::chunk {"
+        "  background-color: @progress_chunk;"
+        "  border-radius: 4px;"
+        "}"
+        "$W QScrollArea, $W QListView {"
+        "  border: none;"
+        "}"
+        "$W QLineEdit, $W QListView {"
+        "  background-color: @background;"
+        "  color: @text;"
+        "}"
+        "$W QLabel#keyLabel {"
+        "  background-color: @key_background;"
+        "  color: @key_text;"
+        "  border: 1px solid @key_border;"
+        "  border-radius: 4px;"
+        "  font-size: 12px;"
+        "  font-weight: bold;"
+        "}"
+        "$W QLabel#keyLabel[highlighted=\"true\"] {"
+        "  background-color: @highlight_background;"
+        "  color: @highlight_text;"
+        "  border: 2px solid @highlight_border;"
+        "}"
+        "$W QLabel#keyLabel[modifier=\"true\"] {"
+        "  background-color: @modifier_background;"
+        "  color: @modifier_text;"
+        "  border: 2px solid @modifier_border;"
+        "}"
+    );
+
+    const KeyboardColors &keys = theme.keyboard;
+    const QPair<const char *, QColor> colors[] = {
+        // Longer names first so no token is a prefix of one replaced later
+        {"@button_disabled_background", theme.button_disabled_background},
+        {"@button_disabled_text", theme.button_disabled_text},
+        {"@button_background", theme.button_background},
+        {"@button_border", theme.button_border},
+        {"@button_hover", theme.button_hover},
+        {"@progress_background", theme.progress_background},
+        {"@progress_chunk", theme.progress_chunk},
+        {"@input_background", theme.input_background},
+        {"@frame_border", theme.frame_border},
+        {"@error_text", theme.error_text},
+        {"@key_background", keys.key_background},
+        {"@key_text", keys.key_text},
+        {"@key_border", keys.key_border},
+        {"@highlight_background", keys.highlight_background},
+        {"@highlight_text", keys.highlight_text},
+        {"@highlight_border", keys.highlight_border},
+        {"@modifier_background", keys.modifier_background},
+        {"@modifier_text", keys.modifier_text},
+        {"@modifier_border", keys.modifier_border},
+        {"@background", theme.background},
+        {"@text", theme.text},
+    };
+    for (const auto &color : colors) {
+        rules.replace(QLatin1String(color.first), color.second.name());
+    }
+    rules.replace(QLatin1String("$W"),
+                  QStringLiteral("QMainWindow[theme=\"%1\"]").arg(theme.id));
+    return rules;
+}
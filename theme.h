@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QColor>
+#include <QPalette>
+#include <QString>
+#include <QVector>
+
+class QWidget;
+
+// Colors for one theme of the virtual keyboard
+struct KeyboardColors {
+    QColor key_background;
+    QColor key_text;
+    QColor key_border;
+    QColor highlight_background;
+    QColor highlight_text;
+    QColor highlight_border;
+    QColor modifier_background;
+    QColor modifier_text;
+    QColor modifier_border;
+};
+
+struct Theme {
+    QString id;             // value of the window "theme" property
+    QString name;
+    QString toggle_icon;    // shown on the theme button
+
+    QColor background;
+    QColor text;
+    QColor button_background;
+    QColor button_border;
+    QColor button_hover;
+    QColor button_disabled_background;
+    QColor button_disabled_text;
+    QColor error_text;
+    QColor frame_border;        // group boxes, combo and spin boxes
+    QColor input_background;
+    QColor progress_background;
+    QColor progress_chunk;
+    KeyboardColors keyboard;
+
+    static Theme Dark();
+    static Theme Light();
+};
+
+// All available themes and the one stylesheet that covers them. Every rule is
+// scoped to the main window's "theme" property, so the stylesheet is built
+// and parsed once. Switching themes sets the theme's palette, which reaches
+// every widget, changes the property and repolishes only the widgets that
+// a rule matches.
+class ThemeRegistry {
+public:
+    ThemeRegistry();
+
+    // Adds every *.ini theme in directory; keys are the Theme color names,
+    // missing colors fall back to the dark theme
+    void LoadUserThemes(const QString &directory);
+
+    int Count() const { return themes_.size(); }
+    const Theme &At(int index) const { return themes_.at(index); }
+    // Palette for widgets that paint themselves, e.g. the history delegate
+    const QPalette &Palette(int index) const { return palettes_.at(index); }
+    int IndexOf(const QString &id) const;
+
+    const QString &StyleSheet() const;
+    // Whether a rule of StyleSheet() matches widget, i.e. its style has to
+    // be recomputed when the theme changes
+    static bool HasThemedRules(const QWidget *widget);
+
+private:
+    void AddTheme(const Theme &theme);
+    static QString BuildRules(const Theme &theme);
+    static QPalette BuildPalette(const Theme &theme);
+
+    QVector<Theme> themes_;
+    QVector<QPalette> palettes_;
+    mutable QString style_sheet_;
+};
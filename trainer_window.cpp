@@ -1,106 +1,203 @@
 #include "trainer_window.h"
 
+#include "field_label.h"
+#include "history_list_model.h"
+#include "painted_keyboard.h"
+#include "profiler.h"
+#include "progress_chart.h"
+#include "prompt_label.h"
+#include "race_session.h"
+#include "render_scheduler.h"
+#include "rolling_sparkline.h"
+#include "sound_engine.h"
+#include "startup_trace.h"
+
 #include <QApplication>
 #include <QCheckBox>
 #include <QCloseEvent>
+#include <QDir>
 #include <QComboBox>
 #include <QDateTime>
-#include <QElapsedTimer>
 #include <QFont>
+#include <QFontDatabase>
 #include <QFrame>
 #include <QGridLayout>
 #include <QGroupBox>
+#include <QGuiApplication>
 #include <QHBoxLayout>
 #include <QKeyEvent>
 #include <QLabel>
+#include <QLineEdit>
+#include <QListView>
 #include <QProgressBar>
 #include <QPushButton>
 #include <QRandomGenerator>
 #include <QResizeEvent>
-#include <QScrollArea>
+#include <QScreen>
 #include <QSettings>
+#include <QSignalBlocker>
 #include <QSpinBox>
 #include <QStackedWidget>
+#include <QStyle>
 #include <QTimer>
+#include <QVariant>
 #include <QVBoxLayout>
+#include <QVarLengthArray>
+#include <QWindow>
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+// Countdown between a race start and its first prompt
+constexpr int kRaceStartDelayMs = 3000;
+// Longest countdown accepted from a race host
+constexpr int kMaxRaceStartDelayMs = 10000;
+
+// Settings page ranges; race settings from the network are clamped to them
+constexpr int kMinTimeLimitSeconds = 10;
+constexpr int kMaxTimeLimitSeconds = 600;
+constexpr int kMinTargetRounds = 5;
+constexpr int kMaxTargetRounds = 500;
+constexpr int kMaxGapBudgetMs = 2000;
+
+// Fields of the per-key labels, in the order they are added
+enum StatsField { kStatsCorrect, kStatsTotal, kStatsAccuracy, kStatsSpeed };
+enum ReactionField { kReactionMin, kReactionMedian, kReactionP95, kReactionP99 };
+// Rolling label: one group of RollingMetrics::kWindowCount fields each
+enum RollingGroup { kRollingKeys, kRollingAccuracy, kRollingMedian };
+
+int RollingField(RollingGroup group, int window) {
+    return group * RollingMetrics::kWindowCount + window;
+}
+
+// Long-term chart metrics, in combo box order
+enum ProgressMetric {
+    kProgressKeys,
+    kProgressRounds,
+    kProgressAccuracy,
+    kProgressMedian,
+    kProgressP95,
+    kProgressP99
+};
+// Period combo data besides the ProgressPeriod values: one point per session
+constexpr int kProgressPerSession = -1;
+// Most recent sessions charted one point each
+constexpr int kMaxProgressSessions = 500;
+
+bool ProgressValue(const ProgressBucket &bucket, int metric, double *value) {
+    switch (metric) {
+        case kProgressKeys:
+            *value = bucket.KeysPerMinute();
+            return bucket.duration_us > 0;
+        case kProgressRounds:
+            *value = bucket.RoundsPerMinute();
+            return bucket.duration_us > 0;
+        case kProgressAccuracy:
+            *value = bucket.Accuracy();
+            return bucket.rounds_total > 0;
+        default: {
+            static const double kQuantiles[] = {0.5, 0.95, 0.99};
+            *value = bucket.reactions.QuantileNs(kQuantiles[metric - kProgressMedian]) / 1e6;
+            return bucket.reactions.Count() > 0;
+        }
+    }
+}
 
-// ===== TrainingItem helpers =====
-
-TrainerWindow::TrainingItem TrainerWindow::TrainingItem::MakeSingleKey(
-    QChar ch, Difficulty diff) {
-    TrainingItem item;
-    item.type = TrainingType::kSingleKey;
-    item.sequence = QString(ch).toLower();
-    item.label = QString(ch).toUpper();
-    item.min_difficulty = diff;
-    return item;
-}
-
-TrainerWindow::TrainingItem TrainerWindow::TrainingItem::MakeSequence(
-    const QString &seq, Difficulty diff) {
-    TrainingItem item;
-    item.type = TrainingType::kSequence;
-    item.sequence = seq.toLower();
-    item.label = seq.toUpper();
-    item.min_difficulty = diff;
-    return item;
-}
-
-TrainerWindow::TrainingItem TrainerWindow::TrainingItem::MakeCombo(
-    Qt::KeyboardModifiers mods, int key, const QString &label, Difficulty diff) {
-    TrainingItem item;
-    item.type = TrainingType::kCombo;
-    item.key = key;
-    item.modifiers = mods;
-    item.label = label;
-    item.min_difficulty = diff;
-    return item;
-}
-
-TrainerWindow::TrainingItem TrainerWindow::TrainingItem::MakeSpecialKey(
-    int key, const QString &label, Difficulty diff) {
-    TrainingItem item;
-    item.type = TrainingType::kSpecialKey;
-    item.key = key;
-    item.label = label;
-    item.min_difficulty = diff;
-    return item;
+bool ProgressValue(const SessionLogRecord &record, int metric, double *value) {
+    const double minutes = static_cast<double>(record.duration_us) / 6e7;
+    switch (metric) {
+        case kProgressKeys:
+            *value = (minutes > 0) ? record.keystroke_count / minutes : 0.0;
+            return minutes > 0;
+        case kProgressRounds:
+            *value = (minutes > 0) ? record.total_rounds / minutes : 0.0;
+            return minutes > 0;
+        case kProgressAccuracy:
+            *value = (record.total_rounds > 0)
+                         ? 100.0 * record.correct_rounds / record.total_rounds
+                         : 0.0;
+            return record.total_rounds > 0;
+        case kProgressMedian:
+            *value = record.reaction_median_ns / 1e6;
+            return record.reaction_count > 0;
+        case kProgressP95:
+            *value = record.reaction_p95_ns / 1e6;
+            return record.reaction_count > 0;
+        default:
+            *value = record.reaction_p99_ns / 1e6;
+            return record.reaction_count > 0;
+    }
 }
 
+}  // namespace
+
 // ===== TrainerWindow implementation =====
 
 TrainerWindow::TrainerWindow(QWidget *parent)
     : QMainWindow(parent),
-      elapsed_(new QElapsedTimer()),
-      countdown_timer_(new QTimer(this)) {
+      deadline_timer_(new QTimer(this)),
+      display_timer_(new QTimer(this)),
+      render_(new RenderScheduler(this)),
+      race_(new RaceSession(this)),
+      race_countdown_timer_(new QTimer(this)),
+      sound_(new SoundEngine(this)) {
     setWindowTitle(QStringLiteral("左手快捷键训练器 - SC2风格"));
     resize(900, 700);
     setMinimumSize(700, 500);
 
-    // Load saved settings and history
+    // Load saved settings; the history log is opened when first needed
+    session_log_.SetWriter(&persistence_);
     LoadSettings();
-    LoadHistory();
+    StartupTrace::Mark("settings");
 
-    // Initialize all training items
-    InitAllTrainingItems();
+    BuildPromptViews();
+    StartupTrace::Mark("prompt views");
 
-    // Setup UI
+    // Only the training page is built here; the others on first visit
     SetupMainUI();
+    StartupTrace::Mark("training page");
 
     // Connect timer
-    QObject::connect(countdown_timer_, &QTimer::timeout,
-                     this, &TrainerWindow::OnTimerTick);
+    deadline_timer_->setSingleShot(true);
+    deadline_timer_->setTimerType(Qt::PreciseTimer);
+    display_timer_->setSingleShot(true);
+    display_timer_->setTimerType(Qt::PreciseTimer);
+    QObject::connect(deadline_timer_, &QTimer::timeout,
+                     this, &TrainerWindow::OnDeadline);
+    QObject::connect(display_timer_, &QTimer::timeout,
+                     this, &TrainerWindow::OnDisplayTick);
+    QObject::connect(render_, &RenderScheduler::Render,
+                     this, &TrainerWindow::RenderDirty);
+    race_countdown_timer_->setSingleShot(true);
+    race_countdown_timer_->setTimerType(Qt::PreciseTimer);
+    QObject::connect(race_countdown_timer_, &QTimer::timeout,
+                     this, &TrainerWindow::OnRaceCountdown);
+    QObject::connect(race_, &RaceSession::RaceStarted,
+                     this, &TrainerWindow::OnRaceStarted);
+    QObject::connect(race_, &RaceSession::StandingsChanged,
+                     this, &TrainerWindow::UpdateRaceControls);
+    QObject::connect(race_, &RaceSession::ConnectionChanged,
+                     this, &TrainerWindow::UpdateRaceControls);
 
     // Apply theme
     ApplyTheme();
+    StartupTrace::Mark("theme");
+
+    SetRawInputEnabled(raw_input_enabled_);
 
     // Filter items by current difficulty
-    FilterItemsByDifficulty();
+    engine_.SetConfig(config_);
+    ApplyDrillPack();
+    StartupTrace::Mark("engine");
 }
 
 TrainerWindow::~TrainerWindow() {
+    if (racing_) {
+        EndRace();
+    }
     SaveSettings();
-    delete elapsed_;
 }
 
 void TrainerWindow::SetupMainUI() {
@@ -113,12 +210,7 @@ void TrainerWindow::SetupMainUI() {
     stacked_widget_ = new QStackedWidget(this);
 
     SetupTrainingPage();
-    SetupSettingsPage();
-    SetupHistoryPage();
-
     stacked_widget_->addWidget(training_page_);
-    stacked_widget_->addWidget(settings_page_);
-    stacked_widget_->addWidget(history_page_);
 
     main_layout->addWidget(stacked_widget_);
 }
@@ -134,12 +226,14 @@ void TrainerWindow::SetupTrainingPage() {
     mode_label_ = new QLabel(QStringLiteral("模式: 无尽"), this);
     mode_label_->setAlignment(Qt::AlignLeft | Qt::AlignVCenter);
 
-    timer_label_ = new QLabel(QStringLiteral("--:--"), this);
-    timer_label_->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    timer_label_ = new FieldLabel(this);
+    timer_label_->SetAlignment(Qt::AlignRight | Qt::AlignVCenter);
     QFont timer_font = timer_label_->font();
     timer_font.setPointSize(16);
     timer_font.setBold(true);
     timer_label_->setFont(timer_font);
+    timer_label_->AddField();
+    timer_label_->ShowMessage(QStringLiteral("--:--"));
 
     top_bar->addWidget(mode_label_);
     top_bar->addStretch();
@@ -157,14 +251,37 @@ void TrainerWindow::SetupTrainingPage() {
     error_label_->setText(QString());
     error_label_->raise();
 
+#ifdef LHT_PROFILE
+    // Floating per-stage timings in the top right corner, off until enabled
+    profile_overlay_ = new QLabel(training_page_);
+    profile_overlay_->setObjectName(QStringLiteral("profileOverlay"));
+    profile_overlay_->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    profile_overlay_->setAttribute(Qt::WA_TransparentForMouseEvents);
+    profile_overlay_->hide();
+    profile_timer_ = new QTimer(this);
+    profile_timer_->setInterval(500);
+    QObject::connect(profile_timer_, &QTimer::timeout,
+                     this, &TrainerWindow::UpdateProfileOverlay);
+#endif
+
     // Center big text
-    target_label_ = new QLabel(QStringLiteral("点击 \"开始\" 开始训练"), this);
+    target_label_ = new PromptLabel(QStringLiteral("点击 \"开始\" 开始训练"), this);
     target_label_->setAlignment(Qt::AlignCenter);
     QFont big_font = target_label_->font();
     big_font.setPointSize(48);
     big_font.setBold(true);
     target_label_->setFont(big_font);
     target_label_->setMinimumHeight(150);
+    QObject::connect(target_label_, &PromptLabel::Painted,
+                     this, &TrainerWindow::OnPromptPainted);
+
+    // Upcoming prompts, so the player can read ahead
+    lookahead_label_ = new QLabel(QString(), this);
+    lookahead_label_->setAlignment(Qt::AlignCenter);
+    QFont lookahead_font = lookahead_label_->font();
+    lookahead_font.setPointSize(20);
+    lookahead_label_->setFont(lookahead_font);
+    lookahead_label_->setEnabled(false);    // drawn in the theme's muted text color
 
     // Progress bar (for timed/challenge modes)
     progress_bar_ = new QProgressBar(this);
@@ -176,11 +293,70 @@ void TrainerWindow::SetupTrainingPage() {
     progress_bar_->hide();
 
     // Stats at bottom
-    stats_label_ = new QLabel(QStringLiteral("未开始"), this);
-    stats_label_->setAlignment(Qt::AlignCenter);
+    stats_label_ = new FieldLabel(this);
+    stats_label_->SetAlignment(Qt::AlignCenter);
     QFont stats_font = stats_label_->font();
     stats_font.setPointSize(14);
     stats_label_->setFont(stats_font);
+    stats_label_->AddText(QStringLiteral("完成: "));
+    stats_label_->AddField();                           // kStatsCorrect
+    stats_label_->AddText(QStringLiteral("/"));
+    stats_label_->AddField();                           // kStatsTotal
+    stats_label_->AddText(QStringLiteral("   正确率: "));
+    stats_label_->AddField();                           // kStatsAccuracy
+    stats_label_->AddText(QStringLiteral("%   速度: "));
+    stats_label_->AddField();                           // kStatsSpeed
+    stats_label_->AddText(QStringLiteral(" 轮/分钟"));
+    stats_label_->ShowMessage(QStringLiteral("未开始"));
+
+    // Reaction time summary below the stats
+    reaction_label_ = new FieldLabel(this);
+    reaction_label_->SetAlignment(Qt::AlignCenter);
+    QFont reaction_font = reaction_label_->font();
+    reaction_font.setPointSize(11);
+    reaction_label_->setFont(reaction_font);
+    reaction_label_->AddText(QStringLiteral("反应时间: 最快 "));
+    reaction_label_->AddField();                        // kReactionMin
+    reaction_label_->AddText(QStringLiteral(" ms   中位 "));
+    reaction_label_->AddField();                        // kReactionMedian
+    reaction_label_->AddText(QStringLiteral(" ms   P95 "));
+    reaction_label_->AddField();                        // kReactionP95
+    reaction_label_->AddText(QStringLiteral(" ms   P99 "));
+    reaction_label_->AddField();                        // kReactionP99
+    reaction_label_->AddText(QStringLiteral(" ms"));
+    reaction_label_->ShowMessage(QString());
+
+    // Recent form: rolling windows plus a sparkline of the 10 s rate
+    rolling_label_ = new FieldLabel(this);
+    rolling_label_->setFont(reaction_font);
+    const QString rolling_texts[] = {QStringLiteral("近10/30/60秒  按键: "),
+                                     QStringLiteral(" 次/分   正确率: "),
+                                     QStringLiteral("%   中位反应: ")};
+    for (const QString &text : rolling_texts) {
+        rolling_label_->AddText(text);
+        for (int w = 0; w < RollingMetrics::kWindowCount; ++w) {
+            if (w > 0) {
+                rolling_label_->AddText(QStringLiteral("/"));
+            }
+            rolling_label_->AddField();
+        }
+    }
+    rolling_label_->AddText(QStringLiteral(" ms"));
+    rolling_label_->ShowMessage(QString());
+    rolling_sparkline_ = new RollingSparkline(this);
+    rolling_sparkline_->setToolTip(QStringLiteral("最近10秒按键速度 (次/分钟)"));
+    auto *rolling_layout = new QHBoxLayout();
+    rolling_layout->addStretch();
+    rolling_layout->addWidget(rolling_label_);
+    rolling_layout->addWidget(rolling_sparkline_, 1);
+    rolling_layout->addStretch();
+
+    // LAN race standings, shown while in a race room
+    race_label_ = new QLabel(QString(), this);
+    race_label_->setAlignment(Qt::AlignCenter);
+    race_label_->setFont(reaction_font);
+    race_label_->setWordWrap(true);
+    race_label_->hide();
 
     // Virtual keyboard
     SetupVirtualKeyboard();
@@ -218,8 +394,12 @@ void TrainerWindow::SetupTrainingPage() {
 
     layout->addLayout(top_bar);
     layout->addWidget(target_label_, 1);
+    layout->addWidget(lookahead_label_);
     layout->addWidget(progress_bar_);
     layout->addWidget(stats_label_);
+    layout->addWidget(reaction_label_);
+    layout->addLayout(rolling_layout);
+    layout->addWidget(race_label_);
     layout->addWidget(keyboard_widget_);
     layout->addLayout(button_layout);
 
@@ -230,7 +410,7 @@ void TrainerWindow::SetupTrainingPage() {
                      this, &TrainerWindow::StopTraining);
     QObject::connect(pause_button_, &QPushButton::clicked,
                      this, [this]() {
-                         if (paused_) {
+                         if (engine_.IsPaused()) {
                              ResumeTraining();
                          } else {
                              PauseTraining();
@@ -246,68 +426,102 @@ void TrainerWindow::SetupTrainingPage() {
 
 void TrainerWindow::SetupVirtualKeyboard() {
     keyboard_widget_ = new QWidget(this);
-    auto *keyboard_layout = new QVBoxLayout(keyboard_widget_);
-    keyboard_layout->setSpacing(4);
-    keyboard_layout->setContentsMargins(0, 10, 0, 0);
-
-    // Keyboard rows for left hand
-    const QVector<QStringList> rows = {
-        {"`", "1", "2", "3", "4", "5", "6"},
-        {"Tab", "Q", "W", "E", "R", "T"},
-        {"Caps", "A", "S", "D", "F", "G"},
-        {"Shift", "Z", "X", "C", "V", "B"},
-        {"Ctrl", "Alt", "Space"}
-    };
+    auto *container_layout = new QVBoxLayout(keyboard_widget_);
+    container_layout->setContentsMargins(0, 0, 0, 0);
+
+    BuildKeyboardBoard();
+
+    keyboard_widget_->setVisible(show_keyboard_);
+}
 
-    // Function keys row
-    const QStringList f_keys = {"F1", "F2", "F3", "F4", "F5", "F6", "F7", "F8"};
-
-    // F-keys row
-    auto *f_row_layout = new QHBoxLayout();
-    f_row_layout->setSpacing(4);
-    f_row_layout->addStretch();
-    for (const QString &key : f_keys) {
-        auto *label = new QLabel(key, this);
-        label->setAlignment(Qt::AlignCenter);
-        label->setFixedSize(40, 30);
-        label->setObjectName(QStringLiteral("keyLabel"));
-        label->setProperty("keyName", key);
-        f_row_layout->addWidget(label);
-        key_labels_[key] = label;
-    }
-    f_row_layout->addStretch();
-    keyboard_layout->addLayout(f_row_layout);
-
-    // Main keyboard rows
-    for (const QStringList &row : rows) {
-        auto *row_layout = new QHBoxLayout();
-        row_layout->setSpacing(4);
-        row_layout->addStretch();
-
-        for (const QString &key : row) {
-            auto *label = new QLabel(key, this);
-            label->setAlignment(Qt::AlignCenter);
-            label->setObjectName(QStringLiteral("keyLabel"));
-            label->setProperty("keyName", key);
-
-            // Set sizes for special keys
-            if (key == "Space") {
-                label->setFixedSize(200, 40);
-            } else if (key == "Tab" || key == "Caps" || key == "Shift" || key == "Ctrl" || key == "Alt") {
-                label->setFixedSize(60, 40);
-            } else {
-                label->setFixedSize(40, 40);
+void TrainerWindow::BuildKeyboardBoard() {
+    // Drop the previous renderer, if any
+    delete keyboard_board_;
+    keyboard_board_ = nullptr;
+    painted_keyboard_ = nullptr;
+    key_labels_.clear();
+    key_states_.clear();
+
+    if (keyboard_renderer_ == KeyboardRenderer::kPainted) {
+        painted_keyboard_ = new PaintedKeyboard(keyboard_widget_);
+        painted_keyboard_->SetColors(themes_.At(theme_index_).keyboard);
+        keyboard_board_ = painted_keyboard_;
+    } else {
+        keyboard_board_ = new QWidget(keyboard_widget_);
+        auto *keyboard_layout = new QVBoxLayout(keyboard_board_);
+        keyboard_layout->setSpacing(KeyboardLayout::kRowSpacing);
+        keyboard_layout->setContentsMargins(0, 10, 0, 0);
+
+        for (const QVector<KeyCap> &row : KeyboardLayout::Rows()) {
+            auto *row_layout = new QHBoxLayout();
+            row_layout->setSpacing(KeyboardLayout::kKeySpacing);
+            row_layout->addStretch();
+
+            for (const KeyCap &cap : row) {
+                const QString key = QString::fromLatin1(cap.name);
+                auto *label = new QLabel(key, keyboard_board_);
+                label->setAlignment(Qt::AlignCenter);
+                label->setFixedSize(cap.width, cap.height);
+                label->setObjectName(QStringLiteral("keyLabel"));
+                label->setProperty("keyName", key);
+                row_layout->addWidget(label);
+                key_labels_[key] = label;
             }
 
-            row_layout->addWidget(label);
-            key_labels_[key] = label;
+            row_layout->addStretch();
+            keyboard_layout->addLayout(row_layout);
         }
+    }
+
+    keyboard_widget_->layout()->addWidget(keyboard_board_);
+    SetKeyboardHighlights(KeyHighlightList(highlights_));
+    ApplyHeatmap();
+}
 
-        row_layout->addStretch();
-        keyboard_layout->addLayout(row_layout);
+void TrainerWindow::ApplyHeatmap() {
+    // Read straight from the incrementally kept per-key totals
+    KeyHeatList heat;
+    if (show_heatmap_) {
+        LoadHistory();
+        const HistoryAggregates &aggregates = session_log_.Aggregates();
+        for (const QVector<KeyCap> &row : KeyboardLayout::Rows()) {
+            for (const KeyCap &cap : row) {
+                KeyHeat entry;
+                entry.name = QString::fromLatin1(cap.name);
+                const int key = KeyboardLayout::KeyCode(entry.name);
+                if (key == 0) {
+                    continue;
+                }
+                const HistoryAggregates::KeyTotals &totals = aggregates.Key(key);
+                entry.attempts = totals.Attempts();
+                entry.accuracy = totals.Accuracy();
+                entry.mean_reaction_ns = totals.MeanReactionNs();
+                heat.append(entry);
+            }
+        }
     }
 
-    keyboard_widget_->setVisible(show_keyboard_);
+    if (painted_keyboard_) {
+        painted_keyboard_->SetHeatmap(heat);
+        return;
+    }
+    // The per-label keyboard only shows the numbers as tooltips
+    for (auto it = key_labels_.begin(); it != key_labels_.end(); ++it) {
+        it.value()->setToolTip(QString());
+    }
+    for (const KeyHeat &entry : heat) {
+        QLabel *label = key_labels_.value(entry.name);
+        if (!label || entry.attempts <= 0) {
+            continue;
+        }
+        QString tip = QStringLiteral("正确率 %1% (%2 次)")
+                          .arg(QString::number(entry.accuracy, 'f', 1))
+                          .arg(entry.attempts);
+        if (entry.mean_reaction_ns > 0) {
+            tip += QStringLiteral("\n平均反应 %1 ms").arg(entry.mean_reaction_ns / 1000000);
+        }
+        label->setToolTip(tip);
+    }
 }
 
 void TrainerWindow::SetupSettingsPage() {
@@ -323,6 +537,19 @@ void TrainerWindow::SetupSettingsPage() {
     title->setFont(title_font);
     title->setAlignment(Qt::AlignCenter);
 
+    // Training content: built-in items or a drill pack
+    auto *pack_group = new QGroupBox(QStringLiteral("训练内容"), this);
+    auto *pack_layout = new QHBoxLayout(pack_group);
+    auto *pack_label = new QLabel(QStringLiteral("训练包:"), this);
+    drill_pack_combo_ = new QComboBox(this);
+    drill_pack_label_ = new QLabel(this);
+    drill_pack_label_->setToolTip(QStringLiteral("把 .lhtdrill / .lhtpack 文件放入 %1")
+                                      .arg(QDir::toNativeSeparators(DrillPack::DefaultDirectory())));
+    pack_layout->addWidget(pack_label);
+    pack_layout->addWidget(drill_pack_combo_);
+    pack_layout->addWidget(drill_pack_label_);
+    pack_layout->addStretch();
+
     // Difficulty selection
     auto *diff_group = new QGroupBox(QStringLiteral("难度级别"), this);
     auto *diff_layout = new QHBoxLayout(diff_group);
@@ -332,7 +559,7 @@ void TrainerWindow::SetupSettingsPage() {
     difficulty_combo_->addItem(QStringLiteral("进阶 - 单键+特殊键+简单组合键"), static_cast<int>(Difficulty::kIntermediate));
     difficulty_combo_->addItem(QStringLiteral("高级 - 所有按键和序列"), static_cast<int>(Difficulty::kAdvanced));
     difficulty_combo_->addItem(QStringLiteral("自定义 - 选择练习类型"), static_cast<int>(Difficulty::kCustom));
-    difficulty_combo_->setCurrentIndex(static_cast<int>(difficulty_));
+    difficulty_combo_->setCurrentIndex(static_cast<int>(config_.difficulty));
     diff_layout->addWidget(diff_label);
     diff_layout->addWidget(difficulty_combo_);
     diff_layout->addStretch();
@@ -344,16 +571,16 @@ void TrainerWindow::SetupSettingsPage() {
     custom_special_check_ = new QCheckBox(QStringLiteral("特殊键"), this);
     custom_combo_check_ = new QCheckBox(QStringLiteral("组合键"), this);
     custom_sequence_check_ = new QCheckBox(QStringLiteral("序列"), this);
-    custom_single_check_->setChecked(custom_single_keys_);
-    custom_special_check_->setChecked(custom_special_keys_);
-    custom_combo_check_->setChecked(custom_combos_);
-    custom_sequence_check_->setChecked(custom_sequences_);
+    custom_single_check_->setChecked(config_.custom_single_keys);
+    custom_special_check_->setChecked(config_.custom_special_keys);
+    custom_combo_check_->setChecked(config_.custom_combos);
+    custom_sequence_check_->setChecked(config_.custom_sequences);
     custom_layout->addWidget(custom_single_check_);
     custom_layout->addWidget(custom_special_check_);
     custom_layout->addWidget(custom_combo_check_);
     custom_layout->addWidget(custom_sequence_check_);
     custom_layout->addStretch();
-    custom_options_widget_->setVisible(difficulty_ == Difficulty::kCustom);
+    custom_options_widget_->setVisible(config_.difficulty == Difficulty::kCustom);
 
     // Training mode
     auto *mode_group = new QGroupBox(QStringLiteral("训练模式"), this);
@@ -366,7 +593,7 @@ void TrainerWindow::SetupSettingsPage() {
     mode_combo_->addItem(QStringLiteral("计时模式 - 固定时间"), static_cast<int>(TrainingMode::kTimed));
     mode_combo_->addItem(QStringLiteral("挑战模式 - 固定轮数"), static_cast<int>(TrainingMode::kChallenge));
     mode_combo_->addItem(QStringLiteral("禅模式 - 无统计，纯练习"), static_cast<int>(TrainingMode::kZen));
-    mode_combo_->setCurrentIndex(static_cast<int>(mode_));
+    mode_combo_->setCurrentIndex(static_cast<int>(config_.mode));
     mode_row->addWidget(mode_label);
     mode_row->addWidget(mode_combo_);
     mode_row->addStretch();
@@ -375,9 +602,9 @@ void TrainerWindow::SetupSettingsPage() {
     auto *time_row = new QHBoxLayout();
     auto *time_label = new QLabel(QStringLiteral("时间限制(秒):"), this);
     time_spin_ = new QSpinBox(this);
-    time_spin_->setRange(10, 600);
-    time_spin_->setValue(time_limit_seconds_);
-    time_spin_->setEnabled(mode_ == TrainingMode::kTimed);
+    time_spin_->setRange(kMinTimeLimitSeconds, kMaxTimeLimitSeconds);
+    time_spin_->setValue(config_.time_limit_seconds);
+    time_spin_->setEnabled(config_.mode == TrainingMode::kTimed);
     time_row->addWidget(time_label);
     time_row->addWidget(time_spin_);
     time_row->addStretch();
@@ -386,14 +613,59 @@ void TrainerWindow::SetupSettingsPage() {
     auto *rounds_row = new QHBoxLayout();
     auto *rounds_label = new QLabel(QStringLiteral("目标轮数:"), this);
     rounds_spin_ = new QSpinBox(this);
-    rounds_spin_->setRange(5, 500);
-    rounds_spin_->setValue(target_rounds_);
-    rounds_spin_->setEnabled(mode_ == TrainingMode::kChallenge);
+    rounds_spin_->setRange(kMinTargetRounds, kMaxTargetRounds);
+    rounds_spin_->setValue(config_.target_rounds);
+    rounds_spin_->setEnabled(config_.mode == TrainingMode::kChallenge);
     rounds_row->addWidget(rounds_label);
     rounds_row->addWidget(rounds_spin_);
     rounds_row->addStretch();
     mode_layout->addLayout(rounds_row);
 
+    auto *gap_row = new QHBoxLayout();
+    auto *gap_label = new QLabel(QStringLiteral("序列按键间隔上限:"), this);
+    gap_budget_spin_ = new QSpinBox(this);
+    gap_budget_spin_->setRange(0, kMaxGapBudgetMs);
+    gap_budget_spin_->setSingleStep(50);
+    gap_budget_spin_->setSuffix(QStringLiteral(" ms"));
+    gap_budget_spin_->setSpecialValueText(QStringLiteral("不限"));
+    gap_budget_spin_->setValue(config_.sequence_gap_budget_ms);
+    gap_budget_spin_->setToolTip(QStringLiteral("序列中任意两键间隔超过上限即判为失败"));
+    gap_row->addWidget(gap_label);
+    gap_row->addWidget(gap_budget_spin_);
+    gap_row->addStretch();
+    mode_layout->addLayout(gap_row);
+
+    // LAN race room
+    auto *race_group = new QGroupBox(QStringLiteral("局域网竞速"), this);
+    auto *race_layout = new QVBoxLayout(race_group);
+    auto *race_player_row = new QHBoxLayout();
+    race_name_edit_ = new QLineEdit(race_name_, this);
+    race_name_edit_->setMaxLength(RaceProtocol::kMaxNameLength);
+    race_name_edit_->setPlaceholderText(QStringLiteral("玩家"));
+    race_host_edit_ = new QLineEdit(race_host_, this);
+    race_host_edit_->setPlaceholderText(QStringLiteral("主机 IP, 如 192.168.1.10"));
+    race_player_row->addWidget(new QLabel(QStringLiteral("名字:"), this));
+    race_player_row->addWidget(race_name_edit_);
+    race_player_row->addWidget(new QLabel(QStringLiteral("主机地址:"), this));
+    race_player_row->addWidget(race_host_edit_, 1);
+    race_layout->addLayout(race_player_row);
+    auto *race_button_row = new QHBoxLayout();
+    race_host_button_ = new QPushButton(QStringLiteral("创建房间"), this);
+    race_join_button_ = new QPushButton(QStringLiteral("加入房间"), this);
+    race_leave_button_ = new QPushButton(QStringLiteral("离开"), this);
+    race_start_button_ = new QPushButton(QStringLiteral("开始比赛"), this);
+    race_start_button_->setToolTip(QStringLiteral("以当前难度和模式开始, 所有玩家的提示顺序相同"));
+    race_status_label_ = new QLabel(this);
+    for (QPushButton *button : {race_host_button_, race_join_button_,
+                                race_leave_button_, race_start_button_}) {
+        button->setFocusPolicy(Qt::NoFocus);
+        race_button_row->addWidget(button);
+    }
+    race_button_row->addWidget(race_status_label_);
+    race_button_row->addStretch();
+    race_layout->addLayout(race_button_row);
+    UpdateRaceControls();
+
     // Other options
     auto *options_group = new QGroupBox(QStringLiteral("其他设置"), this);
     auto *options_layout = new QVBoxLayout(options_group);
@@ -401,8 +673,76 @@ void TrainerWindow::SetupSettingsPage() {
     sound_check_->setChecked(sound_enabled_);
     keyboard_check_ = new QCheckBox(QStringLiteral("显示虚拟键盘"), this);
     keyboard_check_->setChecked(show_keyboard_);
+    auto *renderer_row = new QHBoxLayout();
+    auto *renderer_label = new QLabel(QStringLiteral("键盘渲染:"), this);
+    keyboard_renderer_combo_ = new QComboBox(this);
+    keyboard_renderer_combo_->addItem(QStringLiteral("经典 - 每个按键一个控件"), static_cast<int>(KeyboardRenderer::kLabels));
+    keyboard_renderer_combo_->addItem(QStringLiteral("绘制 - 单控件, 更流畅"), static_cast<int>(KeyboardRenderer::kPainted));
+    keyboard_renderer_combo_->setCurrentIndex(static_cast<int>(keyboard_renderer_));
+    renderer_row->addWidget(renderer_label);
+    renderer_row->addWidget(keyboard_renderer_combo_);
+    renderer_row->addStretch();
+    sound_latency_label_ = new QLabel(this);
     options_layout->addWidget(sound_check_);
+    options_layout->addWidget(sound_latency_label_);
     options_layout->addWidget(keyboard_check_);
+    heatmap_check_ = new QCheckBox(QStringLiteral("键盘热力图 (按历史正确率着色, 显示平均反应时间)"), this);
+    heatmap_check_->setChecked(show_heatmap_);
+    options_layout->addWidget(heatmap_check_);
+    options_layout->addLayout(renderer_row);
+    auto *look_ahead_row = new QHBoxLayout();
+    auto *look_ahead_label = new QLabel(QStringLiteral("预览后续提示:"), this);
+    look_ahead_spin_ = new QSpinBox(this);
+    look_ahead_spin_->setRange(0, TrainingEngine::kPrefetchDepth);
+    look_ahead_spin_->setValue(look_ahead_);
+    look_ahead_spin_->setSuffix(QStringLiteral(" 个"));
+    look_ahead_row->addWidget(look_ahead_label);
+    look_ahead_row->addWidget(look_ahead_spin_);
+    look_ahead_row->addStretch();
+    options_layout->addLayout(look_ahead_row);
+    raw_input_check_ = new QCheckBox(QStringLiteral("底层输入计时 (直接读取键盘设备, 需要设备访问权限)"), this);
+    raw_input_check_->setChecked(raw_input_enabled_);
+    raw_input_label_ = new QLabel(this);
+    options_layout->addWidget(raw_input_check_);
+    options_layout->addWidget(raw_input_label_);
+
+    auto *latency_row = new QHBoxLayout();
+    calibrate_button_ = new QPushButton(QStringLiteral("延迟校准"), this);
+    calibrate_button_->setFocusPolicy(Qt::NoFocus);
+    latency_offset_label_ = new QLabel(this);
+    latency_row->addWidget(calibrate_button_);
+    latency_row->addWidget(latency_offset_label_);
+    latency_row->addStretch();
+    options_layout->addLayout(latency_row);
+    UpdateLatencyOffsetLabel();
+
+#ifdef LHT_PROFILE
+    auto *profile_row = new QHBoxLayout();
+    auto *profile_overlay_check = new QCheckBox(QStringLiteral("性能分析浮层"), this);
+    profile_overlay_check->setChecked(profile_overlay_->isVisibleTo(training_page_));
+    auto *profile_trace_check = new QCheckBox(QStringLiteral("记录 Chrome 跟踪"), this);
+    profile_trace_check->setChecked(Profiler::Instance().IsTracing());
+    auto *profile_export_button = new QPushButton(QStringLiteral("导出跟踪"), this);
+    profile_export_button->setFocusPolicy(Qt::NoFocus);
+    profile_trace_label_ = new QLabel(this);
+    profile_row->addWidget(profile_overlay_check);
+    profile_row->addWidget(profile_trace_check);
+    profile_row->addWidget(profile_export_button);
+    profile_row->addWidget(profile_trace_label_);
+    profile_row->addStretch();
+    options_layout->addLayout(profile_row);
+
+    QObject::connect(profile_overlay_check, &QCheckBox::toggled,
+                     this, &TrainerWindow::SetProfileOverlayVisible);
+    QObject::connect(profile_trace_check, &QCheckBox::toggled, this, [this](bool checked) {
+        Profiler::Instance().SetTracing(checked);
+        profile_trace_label_->setText(checked ? QStringLiteral("记录中") : QString());
+    });
+    QObject::connect(profile_export_button, &QPushButton::clicked,
+                     this, &TrainerWindow::ExportProfileTrace);
+#endif
+    UpdateRawInputLabel();
+    UpdateDrillPackLabel();
 
     // Back button
     auto *back_button = new QPushButton(QStringLiteral("← 返回训练"), this);
@@ -410,9 +750,11 @@ void TrainerWindow::SetupSettingsPage() {
 
     layout->addWidget(title);
     layout->addSpacing(20);
+    layout->addWidget(pack_group);
     layout->addWidget(diff_group);
     layout->addWidget(custom_options_widget_);
     layout->addWidget(mode_group);
+    layout->addWidget(race_group);
     layout->addWidget(options_group);
     layout->addStretch();
     layout->addWidget(back_button);
@@ -422,42 +764,86 @@ void TrainerWindow::SetupSettingsPage() {
                      this, &TrainerWindow::OnDifficultyChanged);
     QObject::connect(mode_combo_, QOverload<int>::of(&QComboBox::currentIndexChanged),
                      this, &TrainerWindow::OnModeChanged);
+    QObject::connect(drill_pack_combo_, QOverload<int>::of(&QComboBox::currentIndexChanged),
+                     this, [this](int index) {
+                         if (index < 0) return;
+                         drill_pack_id_ = drill_pack_combo_->itemData(index).toString();
+                         ApplyDrillPack();
+                     });
     QObject::connect(back_button, &QPushButton::clicked,
                      this, &TrainerWindow::ShowTraining);
+    QObject::connect(calibrate_button_, &QPushButton::clicked,
+                     this, &TrainerWindow::StartCalibration);
+    QObject::connect(race_name_edit_, &QLineEdit::textChanged, this, [this](const QString &text) {
+        race_name_ = text;
+    });
+    QObject::connect(race_host_edit_, &QLineEdit::textChanged, this, [this](const QString &text) {
+        race_host_ = text;
+    });
+    QObject::connect(race_host_button_, &QPushButton::clicked,
+                     this, &TrainerWindow::HostRace);
+    QObject::connect(race_join_button_, &QPushButton::clicked,
+                     this, &TrainerWindow::JoinRace);
+    QObject::connect(race_leave_button_, &QPushButton::clicked,
+                     this, &TrainerWindow::LeaveRace);
+    QObject::connect(race_start_button_, &QPushButton::clicked,
+                     this, &TrainerWindow::StartLanRace);
 
     QObject::connect(sound_check_, &QCheckBox::toggled, this, [this](bool checked) {
         sound_enabled_ = checked;
     });
+    QObject::connect(raw_input_check_, &QCheckBox::toggled,
+                     this, &TrainerWindow::SetRawInputEnabled);
     QObject::connect(keyboard_check_, &QCheckBox::toggled, this, [this](bool checked) {
         show_keyboard_ = checked;
         if (keyboard_widget_) {
             keyboard_widget_->setVisible(checked);
         }
     });
+    QObject::connect(look_ahead_spin_, QOverload<int>::of(&QSpinBox::valueChanged),
+                     this, [this](int value) {
+                         look_ahead_ = value;
+                     });
+    QObject::connect(heatmap_check_, &QCheckBox::toggled, this, [this](bool checked) {
+        show_heatmap_ = checked;
+        ApplyHeatmap();
+    });
+    QObject::connect(keyboard_renderer_combo_, QOverload<int>::of(&QComboBox::currentIndexChanged),
+                     this, [this](int index) {
+                         keyboard_renderer_ = static_cast<KeyboardRenderer>(
+                             keyboard_renderer_combo_->itemData(index).toInt());
+                         BuildKeyboardBoard();
+                     });
 
     // Custom type checkboxes
     QObject::connect(custom_single_check_, &QCheckBox::toggled, this, [this](bool checked) {
-        custom_single_keys_ = checked;
-        FilterItemsByDifficulty();
+        config_.custom_single_keys = checked;
+        engine_.SetConfig(config_);
     });
     QObject::connect(custom_special_check_, &QCheckBox::toggled, this, [this](bool checked) {
-        custom_special_keys_ = checked;
-        FilterItemsByDifficulty();
+        config_.custom_special_keys = checked;
+        engine_.SetConfig(config_);
     });
     QObject::connect(custom_combo_check_, &QCheckBox::toggled, this, [this](bool checked) {
-        custom_combos_ = checked;
-        FilterItemsByDifficulty();
+        config_.custom_combos = checked;
+        engine_.SetConfig(config_);
     });
     QObject::connect(custom_sequence_check_, &QCheckBox::toggled, this, [this](bool checked) {
-        custom_sequences_ = checked;
-        FilterItemsByDifficulty();
+        config_.custom_sequences = checked;
+        engine_.SetConfig(config_);
     });
 
     QObject::connect(time_spin_, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int value) {
-        time_limit_seconds_ = value;
+        config_.time_limit_seconds = value;
+        engine_.SetConfig(config_);
     });
     QObject::connect(rounds_spin_, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int value) {
-        target_rounds_ = value;
+        config_.target_rounds = value;
+        engine_.SetConfig(config_);
+    });
+    QObject::connect(gap_budget_spin_, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int value) {
+        config_.sequence_gap_budget_ms = value;
+        engine_.SetConfig(config_);
     });
 }
 
@@ -482,24 +868,80 @@ void TrainerWindow::SetupHistoryPage() {
     best_speed_label_ = new QLabel(QStringLiteral("最佳速度: -- 轮/分钟"), this);
     best_accuracy_label_ = new QLabel(QStringLiteral("最佳正确率: --%"), this);
 
+    rolling_speed_label_ = new QLabel(QStringLiteral("近10次平均速度: -- 轮/分钟"), this);
+    rolling_accuracy_label_ = new QLabel(QStringLiteral("近10次平均正确率: --%"), this);
+    total_practice_label_ = new QLabel(QStringLiteral("累计练习: 0 轮"), this);
+    difficulty_totals_label_ = new QLabel(this);
+    difficulty_totals_label_->setWordWrap(true);
+    transitions_label_ = new QLabel(this);
+    transitions_label_->setWordWrap(true);
+
     summary_layout->addWidget(total_sessions_label_, 0, 0);
     summary_layout->addWidget(best_speed_label_, 0, 1);
     summary_layout->addWidget(best_accuracy_label_, 1, 0);
+    summary_layout->addWidget(total_practice_label_, 1, 1);
+    summary_layout->addWidget(rolling_speed_label_, 2, 0);
+    summary_layout->addWidget(rolling_accuracy_label_, 2, 1);
+    summary_layout->addWidget(difficulty_totals_label_, 3, 0, 1, 2);
+    summary_layout->addWidget(transitions_label_, 4, 0, 1, 2);
+
+    // Long-term progress, drawn from the rollups kept with the session log
+    auto *progress_group = new QGroupBox(QStringLiteral("长期趋势"), this);
+    auto *progress_layout = new QVBoxLayout(progress_group);
+    progress_metric_combo_ = new QComboBox(this);
+    progress_metric_combo_->addItem(QStringLiteral("按键速度 (次/分钟)"));
+    progress_metric_combo_->addItem(QStringLiteral("速度 (轮/分钟)"));
+    progress_metric_combo_->addItem(QStringLiteral("正确率"));
+    progress_metric_combo_->addItem(QStringLiteral("反应时间 中位"));
+    progress_metric_combo_->addItem(QStringLiteral("反应时间 P95"));
+    progress_metric_combo_->addItem(QStringLiteral("反应时间 P99"));
+    progress_period_combo_ = new QComboBox(this);
+    progress_period_combo_->addItem(QStringLiteral("按次"), kProgressPerSession);
+    progress_period_combo_->addItem(QStringLiteral("按日"), static_cast<int>(ProgressPeriod::kDay));
+    progress_period_combo_->addItem(QStringLiteral("按周"), static_cast<int>(ProgressPeriod::kWeek));
+    progress_period_combo_->addItem(QStringLiteral("按月"), static_cast<int>(ProgressPeriod::kMonth));
+    progress_period_combo_->setCurrentIndex(1);
+    progress_metric_combo_->setFocusPolicy(Qt::NoFocus);
+    progress_period_combo_->setFocusPolicy(Qt::NoFocus);
+    progress_change_label_ = new QLabel(this);
+
+    auto *progress_controls = new QHBoxLayout();
+    progress_controls->addWidget(progress_metric_combo_);
+    progress_controls->addWidget(progress_period_combo_);
+    progress_controls->addWidget(progress_change_label_, 1);
+
+    progress_chart_ = new ProgressChart(this);
+    progress_chart_->SetColors(themes_.At(theme_index_).progress_chunk,
+                               themes_.At(theme_index_).background);
+    progress_layout->addLayout(progress_controls);
+    progress_layout->addWidget(progress_chart_);
+
+    QObject::connect(progress_metric_combo_, QOverload<int>::of(&QComboBox::currentIndexChanged),
+                     this, [this]() { UpdateProgressChart(); });
+    QObject::connect(progress_period_combo_, QOverload<int>::of(&QComboBox::currentIndexChanged),
+                     this, [this]() { UpdateProgressChart(); });
 
     // History list
     auto *list_group = new QGroupBox(QStringLiteral("最近训练记录"), this);
     auto *list_layout = new QVBoxLayout(list_group);
 
-    auto *scroll = new QScrollArea(this);
-    scroll->setWidgetResizable(true);
-    scroll->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    // Rows are fetched lazily from the session log as the list scrolls
+    history_model_ = new HistoryListModel(&session_log_, this);
+    history_view_ = new QListView(this);
+    history_view_->setModel(history_model_);
+    history_view_->setItemDelegate(new HistoryItemDelegate(history_view_));
+    history_view_->setUniformItemSizes(true);
+    history_view_->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    history_view_->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    history_view_->setSelectionMode(QAbstractItemView::NoSelection);
+    history_view_->setFocusPolicy(Qt::NoFocus);
 
-    history_list_label_ = new QLabel(this);
-    history_list_label_->setAlignment(Qt::AlignTop | Qt::AlignLeft);
-    history_list_label_->setWordWrap(true);
-    scroll->setWidget(history_list_label_);
+    history_empty_label_ = new QLabel(QStringLiteral("暂无训练记录"), this);
+    history_empty_label_->setAlignment(Qt::AlignCenter);
+    history_empty_label_->setEnabled(false);
 
-    list_layout->addWidget(scroll);
+    list_layout->addWidget(history_view_);
+    list_layout->addWidget(history_empty_label_);
 
     // Buttons
     auto *button_layout = new QHBoxLayout();
@@ -515,6 +957,7 @@ void TrainerWindow::SetupHistoryPage() {
     layout->addWidget(title);
     layout->addSpacing(20);
     layout->addWidget(summary_group);
+    layout->addWidget(progress_group);
     layout->addWidget(list_group, 1);
     layout->addLayout(button_layout);
 
@@ -524,229 +967,72 @@ void TrainerWindow::SetupHistoryPage() {
                      this, &TrainerWindow::ShowTraining);
 }
 
-void TrainerWindow::InitAllTrainingItems() {
-    all_items_.clear();
-
-    // ===== 1. Single Keys (Beginner) =====
-    const QString basic_keys = QStringLiteral("12345qwertasdfgzxcvb");
-    for (QChar ch : basic_keys) {
-        all_items_.append(TrainingItem::MakeSingleKey(ch, Difficulty::kBeginner));
-    }
-
-    // Additional single keys (Intermediate)
-    const QString extra_keys = QStringLiteral("67yhun");
-    for (QChar ch : extra_keys) {
-        all_items_.append(TrainingItem::MakeSingleKey(ch, Difficulty::kIntermediate));
-    }
-
-    // ===== 2. Special Keys =====
-    all_items_.append(TrainingItem::MakeSpecialKey(Qt::Key_Space, QStringLiteral("Space"), Difficulty::kBeginner));
-    all_items_.append(TrainingItem::MakeSpecialKey(Qt::Key_Tab, QStringLiteral("Tab"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeSpecialKey(Qt::Key_CapsLock, QStringLiteral("Caps"), Difficulty::kIntermediate));
-
-    // F keys
-    all_items_.append(TrainingItem::MakeSpecialKey(Qt::Key_F1, QStringLiteral("F1"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeSpecialKey(Qt::Key_F2, QStringLiteral("F2"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeSpecialKey(Qt::Key_F3, QStringLiteral("F3"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeSpecialKey(Qt::Key_F4, QStringLiteral("F4"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeSpecialKey(Qt::Key_F5, QStringLiteral("F5"), Difficulty::kAdvanced));
-    all_items_.append(TrainingItem::MakeSpecialKey(Qt::Key_F6, QStringLiteral("F6"), Difficulty::kAdvanced));
-    all_items_.append(TrainingItem::MakeSpecialKey(Qt::Key_F7, QStringLiteral("F7"), Difficulty::kAdvanced));
-    all_items_.append(TrainingItem::MakeSpecialKey(Qt::Key_F8, QStringLiteral("F8"), Difficulty::kAdvanced));
-
-    // ===== 3. Ctrl Combos (Control Groups) =====
-    for (int i = 1; i <= 5; ++i) {
-        int key_code = Qt::Key_0 + i;
-        QString label = QStringLiteral("Ctrl+%1").arg(i);
-        all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, key_code, label, Difficulty::kIntermediate));
-    }
-    for (int i = 6; i <= 9; ++i) {
-        int key_code = Qt::Key_0 + i;
-        QString label = QStringLiteral("Ctrl+%1").arg(i);
-        all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, key_code, label, Difficulty::kAdvanced));
-    }
-    all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, Qt::Key_0, QStringLiteral("Ctrl+0"), Difficulty::kAdvanced));
-
-    // ===== 4. Shift Combos (Add to Group) =====
-    struct ShiftDigitCombo {
-        int key;
-        const char *label;
-        Difficulty diff;
-    };
-    const ShiftDigitCombo shift_combos[] = {
-        {Qt::Key_Exclam, "Shift+1", Difficulty::kIntermediate},
-        {Qt::Key_At, "Shift+2", Difficulty::kIntermediate},
-        {Qt::Key_NumberSign, "Shift+3", Difficulty::kIntermediate},
-        {Qt::Key_Dollar, "Shift+4", Difficulty::kIntermediate},
-        {Qt::Key_Percent, "Shift+5", Difficulty::kIntermediate},
-    };
-    for (const auto &combo : shift_combos) {
-        all_items_.append(TrainingItem::MakeCombo(Qt::ShiftModifier, combo.key,
-                                                   QString::fromLatin1(combo.label), combo.diff));
-    }
-
-    // Common Ctrl letter combos
-    all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, Qt::Key_Q, QStringLiteral("Ctrl+Q"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, Qt::Key_W, QStringLiteral("Ctrl+W"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, Qt::Key_E, QStringLiteral("Ctrl+E"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, Qt::Key_R, QStringLiteral("Ctrl+R"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, Qt::Key_A, QStringLiteral("Ctrl+A"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, Qt::Key_S, QStringLiteral("Ctrl+S"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, Qt::Key_D, QStringLiteral("Ctrl+D"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, Qt::Key_F, QStringLiteral("Ctrl+F"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, Qt::Key_Z, QStringLiteral("Ctrl+Z"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, Qt::Key_X, QStringLiteral("Ctrl+X"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, Qt::Key_C, QStringLiteral("Ctrl+C"), Difficulty::kIntermediate));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ControlModifier, Qt::Key_V, QStringLiteral("Ctrl+V"), Difficulty::kIntermediate));
-
-    // Common Shift letter combos
-    all_items_.append(TrainingItem::MakeCombo(Qt::ShiftModifier, Qt::Key_Q, QStringLiteral("Shift+Q"), Difficulty::kAdvanced));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ShiftModifier, Qt::Key_W, QStringLiteral("Shift+W"), Difficulty::kAdvanced));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ShiftModifier, Qt::Key_E, QStringLiteral("Shift+E"), Difficulty::kAdvanced));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ShiftModifier, Qt::Key_R, QStringLiteral("Shift+R"), Difficulty::kAdvanced));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ShiftModifier, Qt::Key_A, QStringLiteral("Shift+A"), Difficulty::kAdvanced));
-    all_items_.append(TrainingItem::MakeCombo(Qt::ShiftModifier, Qt::Key_S, QStringLiteral("Shift+S"), Difficulty::kAdvanced));
-
-    // Alt combos
-    all_items_.append(TrainingItem::MakeCombo(Qt::AltModifier, Qt::Key_F1, QStringLiteral("Alt+F1"), Difficulty::kAdvanced));
-    all_items_.append(TrainingItem::MakeCombo(Qt::AltModifier, Qt::Key_F2, QStringLiteral("Alt+F2"), Difficulty::kAdvanced));
-    all_items_.append(TrainingItem::MakeCombo(Qt::AltModifier, Qt::Key_F3, QStringLiteral("Alt+F3"), Difficulty::kAdvanced));
-    all_items_.append(TrainingItem::MakeCombo(Qt::AltModifier, Qt::Key_F4, QStringLiteral("Alt+F4"), Difficulty::kAdvanced));
-
-    // ===== 5. Sequences (Advanced) =====
-    const QVector<QString> basic_sequences = {
-        QStringLiteral("1a"), QStringLiteral("2a"), QStringLiteral("3a"),
-        QStringLiteral("1s"), QStringLiteral("2s"), QStringLiteral("3s"),
-        QStringLiteral("1d"), QStringLiteral("2d"), QStringLiteral("3d"),
-        QStringLiteral("1q"), QStringLiteral("2q"), QStringLiteral("3q"),
-    };
-    for (const QString &seq : basic_sequences) {
-        all_items_.append(TrainingItem::MakeSequence(seq, Difficulty::kIntermediate));
-    }
-
-    const QVector<QString> advanced_sequences = {
-        QStringLiteral("1aa"), QStringLiteral("2aa"), QStringLiteral("3aa"),
-        QStringLiteral("1ss"), QStringLiteral("2ss"), QStringLiteral("3ss"),
-        QStringLiteral("1qqqq"), QStringLiteral("2ww"), QStringLiteral("3ee"),
-        QStringLiteral("qwer"), QStringLiteral("asdf"), QStringLiteral("zxcv"),
-        QStringLiteral("wasd"), QStringLiteral("1a2a"), QStringLiteral("1s2s"),
-        QStringLiteral("4sd"), QStringLiteral("5vv"), QStringLiteral("1a2a3a"),
-        QStringLiteral("qqqq"), QStringLiteral("aaaa"), QStringLiteral("ssss"),
-        QStringLiteral("1234"), QStringLiteral("5432"), QStringLiteral("qwert"),
-        QStringLiteral("asdfg"), QStringLiteral("zxcvb"),
-    };
-    for (const QString &seq : advanced_sequences) {
-        all_items_.append(TrainingItem::MakeSequence(seq, Difficulty::kAdvanced));
-    }
+void TrainerWindow::UpdateVirtualKeyboard(const QString &highlight_keys,
+                                          Qt::KeyboardModifiers mods) {
+    SetKeyboardHighlights(KeyboardLayout::ResolveHighlights(highlight_keys, mods));
 }
 
-void TrainerWindow::FilterItemsByDifficulty() {
-    items_.clear();
+void TrainerWindow::SetKeyboardHighlights(const KeyHighlightList &highlights) {
+    LHT_PROFILE_SCOPE(ProfileStage::kKeyboard);
+    highlights_ = highlights;
 
-    for (const TrainingItem &item : all_items_) {
-        bool include = false;
-
-        switch (difficulty_) {
-            case Difficulty::kBeginner:
-                include = (item.min_difficulty == Difficulty::kBeginner);
-                break;
-            case Difficulty::kIntermediate:
-                include = (item.min_difficulty == Difficulty::kBeginner ||
-                          item.min_difficulty == Difficulty::kIntermediate);
-                break;
-            case Difficulty::kAdvanced:
-                include = true;
-                break;
-            case Difficulty::kCustom:
-                switch (item.type) {
-                    case TrainingType::kSingleKey:
-                        include = custom_single_keys_;
-                        break;
-                    case TrainingType::kSpecialKey:
-                        include = custom_special_keys_;
-                        break;
-                    case TrainingType::kCombo:
-                        include = custom_combos_;
-                        break;
-                    case TrainingType::kSequence:
-                        include = custom_sequences_;
-                        break;
-                }
-                break;
-        }
-
-        if (include) {
-            items_.append(item);
-        }
-    }
-
-    // Ensure at least some items
-    if (items_.isEmpty()) {
-        items_ = all_items_;
+    if (painted_keyboard_) {
+        painted_keyboard_->SetHighlights(highlights);
+        return;
     }
-}
 
-void TrainerWindow::UpdateVirtualKeyboard(const QString &highlight_keys,
-                                          Qt::KeyboardModifiers mods) {
-    // Reset all keys
-    for (auto it = key_labels_.begin(); it != key_labels_.end(); ++it) {
-        it.value()->setProperty("highlighted", false);
-        it.value()->setProperty("modifier", false);
-        it.value()->style()->unpolish(it.value());
-        it.value()->style()->polish(it.value());
-    }
-
-    // Highlight modifier keys
-    if (mods & Qt::ControlModifier) {
-        if (key_labels_.contains("Ctrl")) {
-            key_labels_["Ctrl"]->setProperty("modifier", true);
-            key_labels_["Ctrl"]->style()->unpolish(key_labels_["Ctrl"]);
-            key_labels_["Ctrl"]->style()->polish(key_labels_["Ctrl"]);
-        }
-    }
-    if (mods & Qt::ShiftModifier) {
-        if (key_labels_.contains("Shift")) {
-            key_labels_["Shift"]->setProperty("modifier", true);
-            key_labels_["Shift"]->style()->unpolish(key_labels_["Shift"]);
-            key_labels_["Shift"]->style()->polish(key_labels_["Shift"]);
+    // Only labels whose state actually changes get repolished; a full-board
+    // repolish costs one stylesheet resolve per key on every keystroke.
+    QVarLengthArray<QPair<QLabel *, KeyState>, 8> wanted;
+    for (const KeyHighlight &highlight : highlights) {
+        QLabel *label = key_labels_.value(highlight.name, nullptr);
+        if (label) {
+            wanted.append(qMakePair(label, highlight.state));
         }
     }
-    if (mods & Qt::AltModifier) {
-        if (key_labels_.contains("Alt")) {
-            key_labels_["Alt"]->setProperty("modifier", true);
-            key_labels_["Alt"]->style()->unpolish(key_labels_["Alt"]);
-            key_labels_["Alt"]->style()->polish(key_labels_["Alt"]);
+
+    // Reset keys that are no longer part of the prompt
+    for (auto it = key_states_.begin(); it != key_states_.end();) {
+        bool still_wanted = std::any_of(wanted.cbegin(), wanted.cend(),
+                                        [&](const QPair<QLabel *, KeyState> &w) {
+                                            return w.first == it.key();
+                                        });
+        if (still_wanted) {
+            ++it;
+        } else {
+            ApplyKeyState(it.key(), KeyState::kNormal);
+            it = key_states_.erase(it);
         }
     }
 
-    // Highlight target keys
-    for (QChar ch : highlight_keys) {
-        QString key = ch.toUpper();
-        if (key_labels_.contains(key)) {
-            key_labels_[key]->setProperty("highlighted", true);
-            key_labels_[key]->style()->unpolish(key_labels_[key]);
-            key_labels_[key]->style()->polish(key_labels_[key]);
+    // Light up new keys, skipping those already in the right state
+    for (const auto &w : wanted) {
+        auto it = key_states_.find(w.first);
+        if (it != key_states_.end() && it.value() == w.second) {
+            continue;
         }
+        ApplyKeyState(w.first, w.second);
+        key_states_.insert(w.first, w.second);
     }
 }
 
+void TrainerWindow::ApplyKeyState(QLabel *label, KeyState state) {
+    label->setProperty("highlighted", state == KeyState::kHighlighted);
+    label->setProperty("modifier", state == KeyState::kModifier);
+    label->style()->unpolish(label);
+    label->style()->polish(label);
+}
+
 void TrainerWindow::StartTraining() {
-    if (items_.isEmpty()) {
-        FilterItemsByDifficulty();
-        if (items_.isEmpty()) {
-            return;
-        }
-    }
+    BeginSession(QRandomGenerator::global()->generate());
+}
 
-    rounds_total_ = 0;
-    rounds_correct_ = 0;
-    training_ = true;
-    paused_ = false;
-    sequence_pos_ = 0;
-    paused_elapsed_ = 0;
+bool TrainerWindow::BeginSession(quint32 seed) {
+    if (!engine_.Start(ReactionClock::NowNs(), seed)) {
+        return false;
+    }
 
     UpdateErrorLabel(QString());
-    elapsed_->restart();
 
     start_button_->setEnabled(false);
     stop_button_->setEnabled(true);
@@ -757,22 +1043,20 @@ void TrainerWindow::StartTraining() {
 
     // Update mode label
     QString mode_text;
-    switch (mode_) {
+    switch (config_.mode) {
         case TrainingMode::kEndless:
             mode_text = QStringLiteral("模式: 无尽");
             progress_bar_->hide();
             break;
         case TrainingMode::kTimed:
-            mode_text = QStringLiteral("模式: 计时 (%1秒)").arg(time_limit_seconds_);
-            remaining_seconds_ = time_limit_seconds_;
-            progress_bar_->setMaximum(time_limit_seconds_);
-            progress_bar_->setValue(time_limit_seconds_);
+            mode_text = QStringLiteral("模式: 计时 (%1秒)").arg(config_.time_limit_seconds);
+            progress_bar_->setMaximum(config_.time_limit_seconds);
+            progress_bar_->setValue(config_.time_limit_seconds);
             progress_bar_->show();
-            countdown_timer_->start(1000);
             break;
         case TrainingMode::kChallenge:
-            mode_text = QStringLiteral("模式: 挑战 (%1轮)").arg(target_rounds_);
-            progress_bar_->setMaximum(target_rounds_);
+            mode_text = QStringLiteral("模式: 挑战 (%1轮)").arg(config_.target_rounds);
+            progress_bar_->setMaximum(config_.target_rounds);
             progress_bar_->setValue(0);
             progress_bar_->show();
             break;
@@ -781,25 +1065,53 @@ void TrainerWindow::StartTraining() {
             progress_bar_->hide();
             break;
     }
+    if (racing_) {
+        mode_text = QStringLiteral("竞速 · ") + mode_text;
+    }
     mode_label_->setText(mode_text);
 
+    render_->SetRefreshRate(CurrentRefreshRate());
     NextItem();
     UpdateStatsLabel();
     UpdateTimerLabel();
+    ArmSessionTimers();
+    UpdateReactionLabel();
+    rolling_sparkline_->Clear();
+    rolling_sparkline_->setVisible(config_.mode != TrainingMode::kZen);
+    UpdateRollingLabel();
+    if (racing_) {
+        PublishRaceProgress(false);
+    }
 
     setFocus();
+    return true;
 }
 
 void TrainerWindow::StopTraining() {
-    countdown_timer_->stop();
+    // The rounds of a session that already ended are still in the engine
+    const bool was_running = engine_.IsRunning();
+    if (racing_ && !was_running) {
+        CancelRaceCountdown();
+        return;
+    }
+
+    if (racing_) {
+        PublishRaceProgress(true);
+    }
+    deadline_timer_->stop();
+    display_timer_->stop();
+    engine_.Stop(ReactionClock::NowNs());
 
     // Save session record if meaningful
-    if (rounds_total_ > 0 && mode_ != TrainingMode::kZen) {
+    if (was_running && engine_.RoundsTotal() > 0 && config_.mode != TrainingMode::kZen) {
         SaveSessionRecord();
     }
+    if (was_running && engine_.RoundsTotal() > 0) {
+        SaveKeyTrace();
+    }
 
-    training_ = false;
-    paused_ = false;
+    render_->Discard(RenderScheduler::kTarget | RenderScheduler::kKeyboard |
+                     RenderScheduler::kError);
 
     start_button_->setEnabled(true);
     stop_button_->setEnabled(false);
@@ -808,341 +1120,501 @@ void TrainerWindow::StopTraining() {
     history_button_->setEnabled(true);
 
     target_label_->setText(QStringLiteral("训练结束"));
+    lookahead_label_->clear();
     UpdateErrorLabel(QString());
     UpdateVirtualKeyboard();
     progress_bar_->hide();
+
+    if (racing_) {
+        EndRace();
+    }
 }
 
 void TrainerWindow::PauseTraining() {
-    if (!training_ || paused_) return;
+    if (!engine_.IsRunning() || engine_.IsPaused()) return;
 
-    paused_ = true;
-    paused_elapsed_ = elapsed_->elapsed();
-    countdown_timer_->stop();
+    engine_.Pause(ReactionClock::NowNs());
+    deadline_timer_->stop();
+    display_timer_->stop();
+    render_->Discard(RenderScheduler::kTarget | RenderScheduler::kKeyboard |
+                     RenderScheduler::kLookAhead);
+    lookahead_label_->clear();
 
     pause_button_->setText(QStringLiteral("继续"));
     target_label_->setText(QStringLiteral("已暂停\n按 继续 或 空格键 继续"));
 }
 
 void TrainerWindow::ResumeTraining() {
-    if (!training_ || !paused_) return;
+    if (!engine_.IsRunning() || !engine_.IsPaused()) return;
 
-    paused_ = false;
-    elapsed_->restart();
-
-    if (mode_ == TrainingMode::kTimed) {
-        countdown_timer_->start(1000);
-    }
+    engine_.Resume(ReactionClock::NowNs());
+    ArmSessionTimers();
 
     pause_button_->setText(QStringLiteral("暂停"));
+    render_->Mark(RenderScheduler::kLookAhead);
     ShowCurrentItem();
     setFocus();
 }
 
 void TrainerWindow::NextItem() {
-    if (items_.isEmpty()) {
+    LHT_PROFILE_SCOPE(ProfileStage::kNextItem);
+    if (engine_.PoolSize() == 0) {
         return;
     }
 
-    int index = QRandomGenerator::global()->bounded(items_.size());
-    current_index_ = index;
-    sequence_pos_ = 0;
+    engine_.NextItem();
 
-    UpdateErrorLabel(QString());
+    prompt_error_ = PromptError::kNone;
+    render_->Mark(RenderScheduler::kError | RenderScheduler::kLookAhead);
     ShowCurrentItem();
 }
 
 void TrainerWindow::ShowCurrentItem() {
-    if (current_index_ < 0 || current_index_ >= items_.size()) {
+    LHT_PROFILE_SCOPE(ProfileStage::kShowItem);
+    if (!engine_.HasItem()) {
         target_label_->setText(QStringLiteral("无训练项目"));
         return;
     }
 
-    const TrainingItem &item = items_.at(current_index_);
-    QString highlight_keys;
-    Qt::KeyboardModifiers mods = Qt::NoModifier;
+    render_->Mark(RenderScheduler::kTarget | RenderScheduler::kKeyboard);
+
+    // Reaction time counts from the moment the prompt is committed; the
+    // wait for the next frame is part of the calibrated latency offset
+    engine_.ShowPrompt(ReactionClock::NowNs());
+}
+
+void TrainerWindow::HandleTrainingKey(int key, Qt::KeyboardModifiers mods, qint64 key_ns) {
+    const KeyResult result = engine_.Feed(key, mods, key_ns);
+    if (result.reaction_recorded) {
+        render_->Mark(RenderScheduler::kReaction);
+    }
+
+    switch (result.outcome) {
+        case KeyMatcher::Outcome::kIgnored:
+            if (!result.finished) return;
+            break;
 
-    if (item.type == TrainingType::kSequence) {
-        int total = item.sequence.size();
-        QString display = QStringLiteral("%1\n(%2/%3)")
-                              .arg(item.label)
-                              .arg(0)
-                              .arg(total);
-        target_label_->setText(display);
+        case KeyMatcher::Outcome::kComplete:
+            PlaySound(true);
+            NextItem();
+            break;
+
+        case KeyMatcher::Outcome::kStep:
+            prompt_error_ = PromptError::kNone;
+            render_->Mark(RenderScheduler::kError | RenderScheduler::kTarget |
+                          RenderScheduler::kKeyboard);
+            break;
 
-        // Highlight first key
-        if (!item.sequence.isEmpty()) {
-            highlight_keys = item.sequence.at(0);
+        case KeyMatcher::Outcome::kMiss: {
+            PlaySound(false);
+
+            // Only record what went wrong; the message is formatted when rendered
+            const KeyMatcher &matcher = engine_.Matcher();
+            prompt_error_ = matcher.IsText() ? PromptError::kWrongText : PromptError::kWrongKey;
+            error_expected_key_ = matcher.LastMissed().key;
+            error_pressed_key_ = key;
+            error_gap_ns_ = result.step_gap_ns;
+            if (result.too_slow) {
+                prompt_error_ = PromptError::kTooSlow;
+            }
+            // A sequence starts over from its first key
+            render_->Mark(RenderScheduler::kError | RenderScheduler::kTarget |
+                          RenderScheduler::kKeyboard);
+            break;
+        }
+    }
+
+    render_->Mark(RenderScheduler::kStats | RenderScheduler::kRolling);
+
+    // Challenge target reached, or a key that came in past the time limit
+    if (result.finished) {
+        StopTraining();
+        target_label_->setText(config_.mode == TrainingMode::kTimed
+                                   ? QStringLiteral("时间到!")
+                                   : QStringLiteral("挑战完成!"));
+    }
+}
+
+void TrainerWindow::RenderDirty(quint32 parts) {
+    LHT_PROFILE_SCOPE(ProfileStage::kRender);
+    if (parts & RenderScheduler::kStats) {
+        UpdateStatsLabel();
+        // At most one datagram per frame, and none when nothing changed
+        if (racing_ && engine_.IsRunning()) PublishRaceProgress(false);
+    }
+    if (parts & RenderScheduler::kReaction) UpdateReactionLabel();
+    if (parts & RenderScheduler::kRolling) UpdateRollingLabel();
+    if (parts & RenderScheduler::kTarget) RenderTarget();
+    if (parts & RenderScheduler::kKeyboard) RenderKeyboard();
+    if (parts & RenderScheduler::kLookAhead) RenderLookAhead();
+    if (parts & RenderScheduler::kError) RenderError();
+    if (parts & RenderScheduler::kRace) RenderRaceStandings();
+}
+
+void TrainerWindow::RenderTarget() {
+    if (!engine_.HasItem()) return;
+
+    const PromptView &view = prompt_views_.at(engine_.CurrentItemId());
+    const int step = qMin(engine_.Matcher().Position(), view.texts.size() - 1);
+    target_label_->setText(view.texts.at(step));
+
+    // The same item may be picked twice in a row; calibration needs a paint
+    if (calibrating_) {
+        target_label_->update();
+    }
+}
+
+void TrainerWindow::RenderKeyboard() {
+    if (!engine_.HasItem()) return;
+
+    const PromptView &view = prompt_views_.at(engine_.CurrentItemId());
+    const int step = qMin(engine_.Matcher().Position(), view.highlights.size() - 1);
+    SetKeyboardHighlights(view.highlights.at(step));
+}
+
+void TrainerWindow::RenderLookAhead() {
+    QString text;
+    if (engine_.IsRunning()) {
+        for (int ahead = 1; ahead <= look_ahead_; ++ahead) {
+            const int id = engine_.UpcomingItemId(ahead);
+            if (id < 0) {
+                break;
+            }
+            if (!text.isEmpty()) {
+                text += QStringLiteral("   ");
+            }
+            text += QLatin1String(engine_.Item(id).label);
+        }
+    }
+    lookahead_label_->setText(text);
+}
+
+void TrainerWindow::BuildPromptViews() {
+    prompt_views_.clear();
+    prompt_views_.reserve(TrainingCatalog::kItemCount);
+    for (int id = 0; id < TrainingCatalog::kItemCount; ++id) {
+        prompt_views_.append(BuildPromptView(TrainingCatalog::At(id)));
+    }
+}
+
+TrainerWindow::PromptView TrainerWindow::BuildPromptView(const TrainingItem &item) const {
+    PromptView view;
+    switch (item.type) {
+        case TrainingType::kSequence: {
+            // Progress under the label, and the next key highlighted
+            const int length = item.SequenceLength();
+            for (int step = 0; step < length; ++step) {
+                view.texts.append(QStringLiteral("%1\n(%2/%3)")
+                                      .arg(QLatin1String(item.label))
+                                      .arg(step)
+                                      .arg(length));
+                const int key = KeyMatcher::KeyForChar(item.sequence[step]);
+                view.highlights.append(KeyboardLayout::ResolveHighlights(
+                    QString(QChar(key)), Qt::NoModifier));
+            }
+            break;
         }
-    } else if (item.type == TrainingType::kCombo) {
-        target_label_->setText(item.label);
-        mods = item.modifiers;
-        highlight_keys = GetKeyDisplayName(item.key);
-    } else if (item.type == TrainingType::kSpecialKey) {
-        target_label_->setText(item.label);
-        highlight_keys = item.label;
+        case TrainingType::kCombo:
+            view.texts.append(QString::fromLatin1(item.label));
+            view.highlights.append(KeyboardLayout::ResolveHighlights(
+                GetKeyDisplayName(item.key), item.Modifiers()));
+            break;
+        case TrainingType::kSpecialKey:
+            view.texts.append(QString::fromLatin1(item.label));
+            view.highlights.append(KeyboardLayout::ResolveHighlights(
+                GetKeyDisplayName(item.key), Qt::NoModifier));
+            break;
+        case TrainingType::kSingleKey:
+            // Drill pack labels may be names rather than the key itself
+            view.texts.append(QString::fromLatin1(item.label));
+            view.highlights.append(KeyboardLayout::ResolveHighlights(
+                QString::fromLatin1(item.sequence), Qt::NoModifier));
+            break;
+    }
+    if (view.texts.isEmpty()) {
+        view.texts.append(QString::fromLatin1(item.label));
+        view.highlights.append(KeyHighlightList());
+    }
+    return view;
+}
+
+void TrainerWindow::ApplyDrillPack() {
+    if (engine_.IsRunning()) return;
+
+    engine_.SetDrillPack(nullptr);
+    drill_pack_.Close();
+    prompt_views_.resize(TrainingCatalog::kItemCount);
+
+    QString error;
+    if (!drill_pack_id_.isEmpty() &&
+        drill_pack_.Open(DrillPack::DefaultDirectory(), drill_pack_id_, &error)) {
+        for (int i = 0; i < drill_pack_.ItemCount(); ++i) {
+            prompt_views_.append(BuildPromptView(drill_pack_.Item(i)));
+        }
+        engine_.SetDrillPack(&drill_pack_);
+    }
+
+    drill_pack_error_ = error;
+    UpdateDrillPackLabel();
+}
+
+void TrainerWindow::UpdateDrillPackLabel() {
+    if (!drill_pack_label_) return;
+    if (drill_pack_.IsOpen()) {
+        drill_pack_label_->setText(QStringLiteral("%1 个条目").arg(drill_pack_.ItemCount()));
+    } else if (!drill_pack_id_.isEmpty()) {
+        drill_pack_label_->setText(QStringLiteral("无法加载: %1").arg(drill_pack_error_));
     } else {
-        target_label_->setText(item.label);
-        highlight_keys = item.label;
+        drill_pack_label_->setText(QString());
+    }
+}
+
+void TrainerWindow::ListDrillPacks() {
+    // Only headers are read; the selected pack is the only one mapped
+    const QVector<DrillPack::Info> packs = DrillPack::List(DrillPack::DefaultDirectory());
+
+    const QSignalBlocker blocker(drill_pack_combo_);
+    drill_pack_combo_->clear();
+    drill_pack_combo_->addItem(QStringLiteral("内置项目"), QString());
+    for (const DrillPack::Info &pack : packs) {
+        const QString text = pack.error.isEmpty()
+                                 ? QStringLiteral("%1 (%2)").arg(pack.name).arg(pack.item_count)
+                                 : QStringLiteral("%1 - %2").arg(pack.id, pack.error);
+        drill_pack_combo_->addItem(text, pack.id);
+        if (!pack.error.isEmpty()) {
+            drill_pack_combo_->setItemData(drill_pack_combo_->count() - 1, pack.error, Qt::ToolTipRole);
+        }
     }
+    drill_pack_combo_->setCurrentIndex(qMax(0, drill_pack_combo_->findData(drill_pack_id_)));
+}
 
-    UpdateVirtualKeyboard(highlight_keys, mods);
+void TrainerWindow::RenderError() {
+    switch (prompt_error_) {
+        case PromptError::kNone:
+            UpdateErrorLabel(QString());
+            break;
+        case PromptError::kWrongText: {
+            const int key = error_pressed_key_;
+            const QString typed = (key < Qt::Key_Escape) ? QString(QChar(key).toLower())
+                                                         : GetKeyDisplayName(key);
+            UpdateErrorLabel(QStringLiteral("错误: 期望 '%1', 输入 '%2'")
+                                 .arg(QString(QChar(error_expected_key_).toLower()))
+                                 .arg(typed));
+            break;
+        }
+        case PromptError::kTooSlow:
+            UpdateErrorLabel(QStringLiteral("太慢: 按 %1 前停顿 %2 ms (上限 %3 ms)")
+                                 .arg(GetKeyDisplayName(error_pressed_key_))
+                                 .arg(error_gap_ns_ / 1000000)
+                                 .arg(config_.sequence_gap_budget_ms));
+            break;
+        case PromptError::kWrongKey:
+            if (engine_.HasItem()) {
+                UpdateErrorLabel(QStringLiteral("错误: 请按 %1")
+                                     .arg(QLatin1String(engine_.CurrentItem().label)));
+            }
+            break;
+    }
 }
 
 void TrainerWindow::UpdateStatsLabel() {
-    if (mode_ == TrainingMode::kZen) {
-        stats_label_->setText(QStringLiteral("禅模式 - 专注练习"));
+    LHT_PROFILE_SCOPE(ProfileStage::kStats);
+    if (config_.mode == TrainingMode::kZen) {
+        stats_label_->ShowMessage(QStringLiteral("禅模式 - 专注练习"));
         return;
     }
 
-    qint64 ms = elapsed_->isValid() ? (paused_ ? paused_elapsed_ : elapsed_->elapsed() + paused_elapsed_) : 0;
+    const int rounds_total = engine_.RoundsTotal();
+    const int rounds_correct = engine_.RoundsCorrect();
+    qint64 ms = engine_.ElapsedNs(ReactionClock::NowNs()) / 1000000;
     double seconds = static_cast<double>(ms) / 1000.0;
     if (seconds <= 0.0) {
         seconds = 1.0;
     }
 
-    double rounds_per_min = 60.0 * static_cast<double>(rounds_total_) / seconds;
-    double accuracy = (rounds_total_ > 0)
-                          ? (100.0 * static_cast<double>(rounds_correct_) /
-                             static_cast<double>(rounds_total_))
+    double rounds_per_min = 60.0 * static_cast<double>(rounds_total) / seconds;
+    double accuracy = (rounds_total > 0)
+                          ? (100.0 * static_cast<double>(rounds_correct) /
+                             static_cast<double>(rounds_total))
                           : 0.0;
 
-    QString text = QStringLiteral("完成: %1/%2   正确率: %3%   速度: %4 轮/分钟")
-                       .arg(rounds_correct_)
-                       .arg(rounds_total_)
-                       .arg(QString::number(accuracy, 'f', 1))
-                       .arg(QString::number(rounds_per_min, 'f', 1));
-
-    stats_label_->setText(text);
+    stats_label_->SetInt(kStatsCorrect, rounds_correct);
+    stats_label_->SetInt(kStatsTotal, rounds_total);
+    stats_label_->SetFixed(kStatsAccuracy, accuracy, 1);
+    stats_label_->SetFixed(kStatsSpeed, rounds_per_min, 1);
 
     // Update progress bar for challenge mode
-    if (mode_ == TrainingMode::kChallenge) {
-        progress_bar_->setValue(rounds_correct_);
+    if (config_.mode == TrainingMode::kChallenge) {
+        progress_bar_->setValue(rounds_correct);
+    }
+}
+
+void TrainerWindow::UpdateReactionLabel() {
+    if (config_.mode == TrainingMode::kZen) {
+        reaction_label_->ShowMessage(QString());
+        return;
+    }
+
+    const ReactionSummary summary = engine_.Reactions().Summary();
+    if (summary.count == 0) {
+        reaction_label_->ShowMessage(QStringLiteral("反应时间: --"));
+        return;
+    }
+
+    reaction_label_->SetFixed(kReactionMin, static_cast<double>(summary.min_ns) / 1e6, 0);
+    reaction_label_->SetFixed(kReactionMedian, static_cast<double>(summary.median_ns) / 1e6, 0);
+    reaction_label_->SetFixed(kReactionP95, static_cast<double>(summary.p95_ns) / 1e6, 0);
+    reaction_label_->SetFixed(kReactionP99, static_cast<double>(summary.p99_ns) / 1e6, 0);
+}
+
+void TrainerWindow::UpdateRollingLabel() {
+    if (config_.mode == TrainingMode::kZen || !engine_.IsRunning()) {
+        rolling_label_->ShowMessage(QString());
+        return;
+    }
+
+    const RollingMetrics &rolling = engine_.Rolling();
+    for (int w = 0; w < RollingMetrics::kWindowCount; ++w) {
+        const RollingWindow window = rolling.Window(w);
+        rolling_label_->SetFixed(RollingField(kRollingKeys, w), window.KeysPerMinute(), 0);
+        if (window.rounds_total > 0) {
+            rolling_label_->SetFixed(RollingField(kRollingAccuracy, w), window.Accuracy(), 0);
+        } else {
+            rolling_label_->SetPlaceholder(RollingField(kRollingAccuracy, w));
+        }
+        if (window.median_reaction_ns > 0) {
+            rolling_label_->SetInt(RollingField(kRollingMedian, w),
+                                   window.median_reaction_ns / 1000000);
+        } else {
+            rolling_label_->SetPlaceholder(RollingField(kRollingMedian, w));
+        }
     }
 }
 
 void TrainerWindow::UpdateTimerLabel() {
-    qint64 ms = elapsed_->isValid() ? (paused_ ? paused_elapsed_ : elapsed_->elapsed() + paused_elapsed_) : 0;
-
-    if (mode_ == TrainingMode::kTimed) {
-        int remaining = remaining_seconds_;
-        int mins = remaining / 60;
-        int secs = remaining % 60;
-        timer_label_->setText(QStringLiteral("%1:%2")
-                                  .arg(mins, 2, 10, QChar('0'))
-                                  .arg(secs, 2, 10, QChar('0')));
+    const qint64 now_ns = ReactionClock::NowNs();
+    qint64 ms = engine_.ElapsedNs(now_ns) / 1000000;
+
+    if (config_.mode == TrainingMode::kTimed) {
+        // Whole seconds left, rounded up so 00:00 only shows at the deadline
+        const qint64 remaining_ns = engine_.RemainingNs(now_ns);
+        int remaining = static_cast<int>((remaining_ns + 999999999LL) / 1000000000LL);
+        progress_bar_->setValue(remaining);
+        timer_label_->SetClock(0, remaining);
     } else {
-        int total_secs = static_cast<int>(ms / 1000);
-        int mins = total_secs / 60;
-        int secs = total_secs % 60;
-        timer_label_->setText(QStringLiteral("%1:%2")
-                                  .arg(mins, 2, 10, QChar('0'))
-                                  .arg(secs, 2, 10, QChar('0')));
+        timer_label_->SetClock(0, ms / 1000);
+    }
+}
+
+void TrainerWindow::ArmSessionTimers() {
+    const qint64 now_ns = ReactionClock::NowNs();
+    if (config_.mode == TrainingMode::kTimed) {
+        // Round up so the timer never fires before the limit
+        const qint64 remaining_ns = engine_.RemainingNs(now_ns);
+        deadline_timer_->start(static_cast<int>(qMax<qint64>(0, (remaining_ns + 999999) / 1000000)));
     }
+
+    // The label shows whole seconds; wake up right after the next one
+    const qint64 elapsed_ms = engine_.ElapsedNs(now_ns) / 1000000;
+    display_timer_->start(static_cast<int>(1000 - elapsed_ms % 1000));
 }
 
-void TrainerWindow::OnTimerTick() {
-    if (!training_ || paused_) return;
+void TrainerWindow::OnDeadline() {
+    if (!engine_.IsRunning() || engine_.IsPaused()) return;
 
+    if (!engine_.IsTimeUp(ReactionClock::NowNs())) {
+        // Timer slack; try again for the time that is actually left
+        ArmSessionTimers();
+        return;
+    }
     UpdateTimerLabel();
+    StopTraining();
+    target_label_->setText(QStringLiteral("时间到!"));
+}
 
-    if (mode_ == TrainingMode::kTimed) {
-        remaining_seconds_--;
-        progress_bar_->setValue(remaining_seconds_);
+void TrainerWindow::OnDisplayTick() {
+    if (!engine_.IsRunning() || engine_.IsPaused()) return;
 
-        if (remaining_seconds_ <= 0) {
-            StopTraining();
-            target_label_->setText(QStringLiteral("时间到!"));
-        }
+    UpdateTimerLabel();
+    const qint64 now_ns = ReactionClock::NowNs();
+    // Windows slide on while no keys come in
+    engine_.AdvanceMetrics(now_ns);
+    if (config_.mode != TrainingMode::kZen) {
+        rolling_sparkline_->AddSample(engine_.Rolling().Window(0).KeysPerMinute());
     }
+    render_->Mark(RenderScheduler::kRolling);
+
+    const qint64 elapsed_ms = engine_.ElapsedNs(now_ns) / 1000000;
+    display_timer_->start(static_cast<int>(1000 - elapsed_ms % 1000));
 }
 
 void TrainerWindow::SaveSessionRecord() {
+    LHT_PROFILE_SCOPE(ProfileStage::kSaveHistory);
     SessionRecord record;
     record.timestamp = QDateTime::currentDateTime();
-    record.total_rounds = rounds_total_;
-    record.correct_rounds = rounds_correct_;
-    record.duration_seconds = static_cast<double>(elapsed_->elapsed() + paused_elapsed_) / 1000.0;
-    record.difficulty = difficulty_;
-    record.mode = mode_;
+    record.total_rounds = engine_.RoundsTotal();
+    record.correct_rounds = engine_.RoundsCorrect();
+    record.duration_seconds = static_cast<double>(engine_.ElapsedNs(ReactionClock::NowNs())) / 1e9;
+    record.difficulty = config_.difficulty;
+    record.mode = config_.mode;
+    record.reaction = engine_.Reactions().Summary();
 
-    history_.prepend(record);
-
-    // Keep only recent records
-    while (history_.size() > kMaxHistoryRecords) {
-        history_.removeLast();
-    }
+    LoadHistory();
+    session_log_.AppendSession(ToLogRecord(record), engine_.Keystrokes());
+    engine_.ClearKeystrokes();
+    ApplyHeatmap();
+}
 
-    SaveHistory();
+void TrainerWindow::SaveKeyTrace() {
+    // Implicitly shared; the next session starts a new trace instead of
+    // writing into this one
+    KeyTrace trace = engine_.Trace();
+    const QDateTime now = QDateTime::currentDateTime();
+    trace.started_ms = now.toMSecsSinceEpoch() -
+                       engine_.ElapsedNs(ReactionClock::NowNs()) / 1000000;
+    const QString directory = KeyTrace::DefaultDirectory();
+    const QString path = directory + QStringLiteral("/session-%1.lhtrace")
+                                         .arg(now.toString(QStringLiteral("yyyyMMdd-HHmmss")));
+    persistence_.Post([trace, directory, path]() {
+        if (!QDir().mkpath(directory)) {
+            return;
+        }
+        trace.Save(path);
+        KeyTrace::Prune(directory, kKeptTraces);
+    });
 }
 
 void TrainerWindow::ApplyTheme() {
-    QString base_style;
-    QString key_style;
-
-    if (dark_theme_) {
-        base_style = QStringLiteral(
-            "QWidget {"
-            "  background-color: #1a1a2e;"
-            "  color: #eaeaea;"
-            "}"
-            "QPushButton {"
-            "  background-color: #16213e;"
-            "  color: #eaeaea;"
-            "  border: 1px solid #0f3460;"
-            "  border-radius: 6px;"
-            "  padding: 8px 16px;"
-            "  font-size: 14px;"
-            "}"
-            "QPushButton:hover {"
-            "  background-color: #0f3460;"
-            "}"
-            "QPushButton:disabled {"
-            "  background-color: #0d1b2a;"
-            "  color: #5c5c5c;"
-            "}"
-            "QLabel#errorLabel {"
-            "  color: #e94560;"
-            "  font-weight: bold;"
-            "}"
-            "QGroupBox {"
-            "  border: 1px solid #0f3460;"
-            "  border-radius: 6px;"
-            "  margin-top: 10px;"
-            "  padding-top: 10px;"
-            "}"
-            "QGroupBox::title {"
-            "  subcontrol-origin: margin;"
-            "  left: 10px;"
-            "  padding: 0 5px;"
-            "}"
-            "QComboBox, QSpinBox {"
-            "  background-color: #16213e;"
-            "  color: #eaeaea;"
-            "  border: 1px solid #0f3460;"
-            "  border-radius: 4px;"
-            "  padding: 4px 8px;"
-            "}"
-            "QCheckBox {"
-            "  color: #eaeaea;"
-            "}"
-            "QProgressBar {"
-            "  background-color: #16213e;"
-            "  border: none;"
-            "  border-radius: 4px;"
-            "}"
-            "QProgressBar::chunk {"
-            "  background-color: #e94560;"
-            "  border-radius: 4px;"
-            "}"
-            "QScrollArea {"
-            "  border: none;"
-            "}"
-        );
-        key_style = QStringLiteral(
-            "QLabel#keyLabel {"
-            "  background-color: #16213e;"
-            "  color: #eaeaea;"
-            "  border: 1px solid #0f3460;"
-            "  border-radius: 4px;"
-            "  font-size: 12px;"
-            "  font-weight: bold;"
-            "}"
-            "QLabel#keyLabel[highlighted=\"true\"] {"
-            "  background-color: #e94560;"
-            "  color: white;"
-            "  border: 2px solid #ff6b6b;"
-            "}"
-            "QLabel#keyLabel[modifier=\"true\"] {"
-            "  background-color: #0f3460;"
-            "  color: #00d9ff;"
-            "  border: 2px solid #00d9ff;"
-            "}"
-        );
-        theme_button_->setText(QStringLiteral("🌙"));
-    } else {
-        base_style = QStringLiteral(
-            "QWidget {"
-            "  background-color: #f5f5f5;"
-            "  color: #333333;"
-            "}"
-            "QPushButton {"
-            "  background-color: #ffffff;"
-            "  color: #333333;"
-            "  border: 1px solid #cccccc;"
-            "  border-radius: 6px;"
-            "  padding: 8px 16px;"
-            "  font-size: 14px;"
-            "}"
-            "QPushButton:hover {"
-            "  background-color: #e8e8e8;"
-            "}"
-            "QPushButton:disabled {"
-            "  background-color: #f0f0f0;"
-            "  color: #999999;"
-            "}"
-            "QLabel#errorLabel {"
-            "  color: #d32f2f;"
-            "  font-weight: bold;"
-            "}"
-            "QGroupBox {"
-            "  border: 1px solid #cccccc;"
-            "  border-radius: 6px;"
-            "  margin-top: 10px;"
-            "  padding-top: 10px;"
-            "}"
-            "QGroupBox::title {"
-            "  subcontrol-origin: margin;"
-            "  left: 10px;"
-            "  padding: 0 5px;"
-            "}"
-            "QComboBox, QSpinBox {"
-            "  background-color: #ffffff;"
-            "  color: #333333;"
-            "  border: 1px solid #cccccc;"
-            "  border-radius: 4px;"
-            "  padding: 4px 8px;"
-            "}"
-            "QCheckBox {"
-            "  color: #333333;"
-            "}"
-            "QProgressBar {"
-            "  background-color: #e0e0e0;"
-            "  border: none;"
-            "  border-radius: 4px;"
-            "}"
-            "QProgressBar::chunk {"
-            "  background-color: #1976d2;"
-            "  border-radius: 4px;"
-            "}"
-            "QScrollArea {"
-            "  border: none;"
-            "}"
-        );
-        key_style = QStringLiteral(
-            "QLabel#keyLabel {"
-            "  background-color: #ffffff;"
-            "  color: #333333;"
-            "  border: 1px solid #cccccc;"
-            "  border-radius: 4px;"
-            "  font-size: 12px;"
-            "  font-weight: bold;"
-            "}"
-            "QLabel#keyLabel[highlighted=\"true\"] {"
-            "  background-color: #1976d2;"
-            "  color: white;"
-            "  border: 2px solid #1565c0;"
-            "}"
-            "QLabel#keyLabel[modifier=\"true\"] {"
-            "  background-color: #e3f2fd;"
-            "  color: #1976d2;"
-            "  border: 2px solid #1976d2;"
-            "}"
-        );
-        theme_button_->setText(QStringLiteral("☀️"));
-    }
-
-    setStyleSheet(base_style + key_style);
+    const Theme &theme = themes_.At(theme_index_);
+
+    // The stylesheet holds the rules of every theme and is parsed only once;
+    // switching just changes the property its selectors match on. Widgets
+    // without a rule follow the palette, so only the others are repolished.
+    if (styleSheet().isEmpty()) {
+        setStyleSheet(themes_.StyleSheet());
+    }
+    setProperty("theme", theme.id);
+    setPalette(themes_.Palette(theme_index_));
+
+    const QList<QWidget *> children = findChildren<QWidget *>();
+    for (QWidget *child : children) {
+        if (ThemeRegistry::HasThemedRules(child)) {
+            child->style()->unpolish(child);
+            child->style()->polish(child);
+        }
+    }
+    update();
+
+    theme_button_->setText(theme.toggle_icon);
+    theme_button_->setToolTip(theme.name);
+
+    if (painted_keyboard_) {
+        painted_keyboard_->SetColors(theme.keyboard);
+    }
+    rolling_sparkline_->SetColors(theme.progress_chunk, theme.background);
+    if (progress_chart_) {
+        progress_chart_->SetColors(theme.progress_chunk, theme.background);
+    }
 
     if (error_label_) {
         error_label_->raise();
@@ -1157,105 +1629,302 @@ void TrainerWindow::UpdateErrorLabel(const QString &text) {
 }
 
 void TrainerWindow::ToggleTheme() {
-    dark_theme_ = !dark_theme_;
+    theme_index_ = (theme_index_ + 1) % themes_.Count();
     ApplyTheme();
 }
 
 void TrainerWindow::ShowSettings() {
+    if (!settings_page_) {
+        SetupSettingsPage();
+        stacked_widget_->addWidget(settings_page_);
+    }
+    UpdateSoundLatencyLabel();
+    ListDrillPacks();
     stacked_widget_->setCurrentWidget(settings_page_);
 }
 
 void TrainerWindow::ShowTraining() {
-    FilterItemsByDifficulty();
     stacked_widget_->setCurrentWidget(training_page_);
     setFocus();
 }
 
 void TrainerWindow::ShowHistory() {
-    // Update history display
-    int total_sessions = history_.size();
-    double best_speed = 0.0;
-    double best_accuracy = 0.0;
-
-    for (const SessionRecord &record : history_) {
-        if (record.duration_seconds > 0) {
-            double speed = 60.0 * record.total_rounds / record.duration_seconds;
-            if (speed > best_speed) {
-                best_speed = speed;
-            }
-        }
-        if (record.total_rounds > 0) {
-            double accuracy = 100.0 * record.correct_rounds / record.total_rounds;
-            if (accuracy > best_accuracy) {
-                best_accuracy = accuracy;
-            }
-        }
+    if (!history_page_) {
+        SetupHistoryPage();
+        stacked_widget_->addWidget(history_page_);
     }
+    LoadHistory();
+
+    // Summary comes from the incrementally maintained aggregates; only the
+    // records that are listed are read from the mapped log.
+    const HistoryAggregates &aggregates = session_log_.Aggregates();
+    const int total_sessions = session_log_.SessionCount();
 
     total_sessions_label_->setText(QStringLiteral("总训练次数: %1").arg(total_sessions));
-    best_speed_label_->setText(QStringLiteral("最佳速度: %1 轮/分钟").arg(QString::number(best_speed, 'f', 1)));
-    best_accuracy_label_->setText(QStringLiteral("最佳正确率: %1%").arg(QString::number(best_accuracy, 'f', 1)));
+    best_speed_label_->setText(QStringLiteral("最佳速度: %1 轮/分钟").arg(QString::number(aggregates.BestSpeed(), 'f', 1)));
+    best_accuracy_label_->setText(QStringLiteral("最佳正确率: %1%").arg(QString::number(aggregates.BestAccuracy(), 'f', 1)));
+    rolling_speed_label_->setText(QStringLiteral("近10次平均速度: %1 轮/分钟")
+                                      .arg(QString::number(aggregates.RollingSpeed(), 'f', 1)));
+    rolling_accuracy_label_->setText(QStringLiteral("近10次平均正确率: %1%")
+                                         .arg(QString::number(aggregates.RollingAccuracy(), 'f', 1)));
+    total_practice_label_->setText(QStringLiteral("累计练习: %1 轮 / %2 分钟")
+                                       .arg(aggregates.TotalRounds())
+                                       .arg(QString::number(aggregates.TotalDurationUs() / 6e7, 'f', 0)));
 
-    // Build history list
-    QString list_html;
     const QStringList diff_names = {QStringLiteral("入门"), QStringLiteral("进阶"),
                                      QStringLiteral("高级"), QStringLiteral("自定义")};
-    const QStringList mode_names = {QStringLiteral("无尽"), QStringLiteral("计时"),
-                                     QStringLiteral("挑战"), QStringLiteral("禅")};
-
-    for (int i = 0; i < qMin(20, history_.size()); ++i) {
-        const SessionRecord &record = history_.at(i);
-        double speed = (record.duration_seconds > 0)
-                           ? (60.0 * record.total_rounds / record.duration_seconds)
-                           : 0.0;
-        double accuracy = (record.total_rounds > 0)
-                              ? (100.0 * record.correct_rounds / record.total_rounds)
-                              : 0.0;
 
-        list_html += QStringLiteral("<p><b>%1</b><br/>")
-                         .arg(record.timestamp.toString(QStringLiteral("yyyy-MM-dd hh:mm")));
-        list_html += QStringLiteral("难度: %1 | 模式: %2<br/>")
-                         .arg(diff_names.value(static_cast<int>(record.difficulty)))
-                         .arg(mode_names.value(static_cast<int>(record.mode)));
-        list_html += QStringLiteral("正确: %1/%2 | 正确率: %3% | 速度: %4 轮/分钟</p>")
-                         .arg(record.correct_rounds)
-                         .arg(record.total_rounds)
-                         .arg(QString::number(accuracy, 'f', 1))
-                         .arg(QString::number(speed, 'f', 1));
+    QStringList difficulty_totals;
+    for (int i = 0; i < HistoryAggregates::kDifficultyCount; ++i) {
+        const HistoryAggregates::DifficultyTotals &totals = aggregates.Totals(i);
+        if (totals.sessions == 0) continue;
+        double accuracy = (totals.rounds > 0) ? (100.0 * totals.correct / totals.rounds) : 0.0;
+        difficulty_totals.append(QStringLiteral("%1: %2次 %3轮 %4%")
+                                     .arg(diff_names.value(i))
+                                     .arg(totals.sessions)
+                                     .arg(totals.rounds)
+                                     .arg(QString::number(accuracy, 'f', 1)));
     }
-
-    if (history_.isEmpty()) {
-        list_html = QStringLiteral("<p style='color: gray;'>暂无训练记录</p>");
+    difficulty_totals_label_->setText(difficulty_totals.join(QStringLiteral("   ")));
+
+    // Slowest key-to-key steps inside sequences, with enough samples to trust
+    constexpr int kMinTransitionSamples = 5;
+    constexpr int kShownTransitions = 5;
+    const TransitionMatrix &transitions = aggregates.Transitions();
+    QVector<QPair<qint64, int>> slowest;   // mean, from * kKeyCount + to
+    for (int from = 0; from < TransitionMatrix::kKeyCount; ++from) {
+        for (int to = 0; to < TransitionMatrix::kKeyCount; ++to) {
+            const TransitionMatrix::Cell &cell = transitions.At(from, to);
+            if (cell.count >= kMinTransitionSamples) {
+                slowest.append(qMakePair(cell.MeanNs(), from * TransitionMatrix::kKeyCount + to));
+            }
+        }
     }
+    std::sort(slowest.begin(), slowest.end(), std::greater<QPair<qint64, int>>());
+    QStringList transition_texts;
+    for (int i = 0; i < qMin<int>(kShownTransitions, slowest.size()); ++i) {
+        const int from = slowest.at(i).second / TransitionMatrix::kKeyCount;
+        const int to = slowest.at(i).second % TransitionMatrix::kKeyCount;
+        const TransitionMatrix::Cell &cell = transitions.At(from, to);
+        QString text = QStringLiteral("%1→%2 %3ms")
+                           .arg(GetKeyDisplayName(TransitionMatrix::KeyAt(from)))
+                           .arg(GetKeyDisplayName(TransitionMatrix::KeyAt(to)))
+                           .arg(cell.MeanNs() / 1000000);
+        if (cell.over_budget > 0) {
+            text += QStringLiteral(" (超时%1次)").arg(cell.over_budget);
+        }
+        transition_texts.append(text);
+    }
+    transitions_label_->setText(transition_texts.isEmpty()
+                                    ? QString()
+                                    : QStringLiteral("最慢序列衔接: ") +
+                                          transition_texts.join(QStringLiteral("   ")));
 
-    history_list_label_->setText(list_html);
+    UpdateProgressChart();
+
+    // Session list
+    history_model_->Reload();
+    history_view_->scrollToTop();
+    history_view_->setVisible(total_sessions > 0);
+    history_empty_label_->setVisible(total_sessions == 0);
 
     stacked_widget_->setCurrentWidget(history_page_);
 }
 
+void TrainerWindow::UpdateProgressChart() {
+    const int metric = progress_metric_combo_->currentIndex();
+    const int period = progress_period_combo_->currentData().toInt();
+
+    // Rollups are read as they are; only per-session points touch the log,
+    // and only its session records
+    QVector<ProgressChart::Point> points;
+    double value = 0.0;
+    if (period == kProgressPerSession) {
+        const int count = session_log_.SessionCount();
+        const int first = qMax(0, count - kMaxProgressSessions);
+        points.reserve(count - first);
+        for (int i = first; i < count; ++i) {
+            const SessionLogRecord record = session_log_.Session(i);
+            if (ProgressValue(record, metric, &value)) {
+                points.append({ProgressSeries::DayOf(record.timestamp_ms), value});
+            }
+        }
+    } else {
+        const QVector<ProgressBucket> &buckets =
+            session_log_.Progress().Buckets(static_cast<ProgressPeriod>(period));
+        points.reserve(buckets.size());
+        for (const ProgressBucket &bucket : buckets) {
+            if (ProgressValue(bucket, metric, &value)) {
+                points.append({bucket.first_day, value});
+            }
+        }
+    }
+
+    static const char *const kUnits[] = {" 次/分", " 轮/分", "%", " ms", " ms", " ms"};
+    static const int kDecimals[] = {0, 1, 1, 0, 0, 0};
+    const QString unit = QString::fromUtf8(kUnits[metric]);
+    progress_chart_->SetPoints(points, unit, kDecimals[metric]);
+
+    // Latest period against the one before, e.g. month over month
+    if (points.size() < 2) {
+        progress_change_label_->setText(QString());
+        return;
+    }
+    const double latest = points.last().value;
+    const double previous = points.at(points.size() - 2).value;
+    QString text = QStringLiteral("最新: %1%2   前一期: %3%2")
+                       .arg(QString::number(latest, 'f', kDecimals[metric]), unit,
+                            QString::number(previous, 'f', kDecimals[metric]));
+    if (previous > 0.0) {
+        const double change = 100.0 * (latest - previous) / previous;
+        text += QStringLiteral(" (%1%2%)")
+                    .arg(change >= 0.0 ? QStringLiteral("+") : QString())
+                    .arg(QString::number(change, 'f', 1));
+    }
+    progress_change_label_->setText(text);
+}
+
 void TrainerWindow::OnDifficultyChanged(int index) {
-    difficulty_ = static_cast<Difficulty>(difficulty_combo_->itemData(index).toInt());
-    custom_options_widget_->setVisible(difficulty_ == Difficulty::kCustom);
-    FilterItemsByDifficulty();
+    config_.difficulty = static_cast<Difficulty>(difficulty_combo_->itemData(index).toInt());
+    custom_options_widget_->setVisible(config_.difficulty == Difficulty::kCustom);
+    engine_.SetConfig(config_);
 }
 
 void TrainerWindow::OnModeChanged(int index) {
-    mode_ = static_cast<TrainingMode>(mode_combo_->itemData(index).toInt());
-    time_spin_->setEnabled(mode_ == TrainingMode::kTimed);
-    rounds_spin_->setEnabled(mode_ == TrainingMode::kChallenge);
+    config_.mode = static_cast<TrainingMode>(mode_combo_->itemData(index).toInt());
+    time_spin_->setEnabled(config_.mode == TrainingMode::kTimed);
+    rounds_spin_->setEnabled(config_.mode == TrainingMode::kChallenge);
+    engine_.SetConfig(config_);
 }
 
 void TrainerWindow::ResetHistory() {
-    history_.clear();
-    SaveHistory();
+    session_log_.Clear();
+    ApplyHeatmap();
     ShowHistory();
 }
 
+void TrainerWindow::StartCalibration() {
+    if (engine_.IsRunning() || calibrating_) return;
+
+    if (engine_.PoolSize() == 0) {
+        return;
+    }
+
+    ShowTraining();
+
+    calibrating_ = true;
+    render_->SetRefreshRate(CurrentRefreshRate());
+    calibration_.Reset();
+
+    start_button_->setEnabled(false);
+    settings_button_->setEnabled(false);
+    history_button_->setEnabled(false);
+    progress_bar_->setMaximum(kCalibrationSamples);
+    progress_bar_->setValue(0);
+    progress_bar_->show();
+
+    mode_label_->setText(QStringLiteral("模式: 延迟校准"));
+    target_label_->setText(QStringLiteral("延迟校准\n请连续按任意键, ESC 取消"));
+    stats_label_->ShowMessage(QStringLiteral("校准: 0/%1").arg(kCalibrationSamples));
+    reaction_label_->ShowMessage(QString());
+    UpdateErrorLabel(QString());
+
+    setFocus();
+}
+
+void TrainerWindow::HandleCalibrationKey(qint64 key_ns) {
+    // One sample at a time; keys arriving before the frame is done are dropped
+    if (calibration_.HasPendingSample()) return;
+
+    calibration_.BeginSample(key_ns);
+    NextItem();
+    calibration_.MarkShown(engine_.PromptShownNs());
+}
+
+void TrainerWindow::OnPromptPainted(qint64 painted_ns) {
+    StartupTrace::Finish("first paint");
+    if (!calibrating_ || !calibration_.IsAwaitingPaint()) return;
+
+    calibration_.MarkPainted(painted_ns);
+
+    // The backing store is flushed right after the paint pass that got us
+    // here returns; the next event loop turn marks the frame as handed over.
+    QTimer::singleShot(0, this, [this]() {
+        if (!calibrating_) return;
+        calibration_.MarkFrameDone(ReactionClock::NowNs());
+
+        const int count = calibration_.SampleCount();
+        progress_bar_->setValue(count);
+        stats_label_->ShowMessage(QStringLiteral("校准: %1/%2").arg(count).arg(kCalibrationSamples));
+        if (count >= kCalibrationSamples) {
+            FinishCalibration();
+        }
+    });
+}
+
+void TrainerWindow::FinishCalibration() {
+    const CalibrationResult result = calibration_.Result(CurrentRefreshRate());
+    engine_.SetLatencyOffset(result.offset_ns);
+
+    EndCalibration();
+
+    auto ms = [](qint64 ns) {
+        return QString::number(static_cast<double>(ns) / 1e6, 'f', 1);
+    };
+    target_label_->setText(QStringLiteral("校准完成\n补偿 %1 ms").arg(ms(result.offset_ns)));
+    stats_label_->ShowMessage(
+        QStringLiteral("按键→绘制: 中位 %1 / P95 %2 / P99 %3 ms   按键→帧提交: 中位 %4 / P95 %5 / P99 %6 ms")
+            .arg(ms(result.key_to_paint.median_ns))
+            .arg(ms(result.key_to_paint.p95_ns))
+            .arg(ms(result.key_to_paint.p99_ns))
+            .arg(ms(result.key_to_frame.median_ns))
+            .arg(ms(result.key_to_frame.p95_ns))
+            .arg(ms(result.key_to_frame.p99_ns)));
+    reaction_label_->ShowMessage(
+        QStringLiteral("提示→帧提交: 中位 %1 ms   显示延迟估计: %2 ms (%3 Hz)")
+            .arg(ms(result.show_to_frame.median_ns))
+            .arg(ms(result.display_latency_ns))
+            .arg(QString::number(result.refresh_hz, 'f', 0)));
+    UpdateLatencyOffsetLabel();
+}
+
+void TrainerWindow::EndCalibration() {
+    calibrating_ = false;
+    calibration_.Reset();
+    render_->Discard(RenderScheduler::kTarget | RenderScheduler::kKeyboard);
+
+    start_button_->setEnabled(true);
+    settings_button_->setEnabled(true);
+    history_button_->setEnabled(true);
+    progress_bar_->hide();
+    UpdateVirtualKeyboard();
+}
+
+void TrainerWindow::UpdateLatencyOffsetLabel() {
+    if (!latency_offset_label_) return;
+    const qint64 offset_ns = engine_.LatencyOffset();
+    if (offset_ns <= 0) {
+        latency_offset_label_->setText(QStringLiteral("未校准"));
+        return;
+    }
+    latency_offset_label_->setText(
+        QStringLiteral("当前补偿: %1 ms")
+            .arg(QString::number(static_cast<double>(offset_ns) / 1e6, 'f', 1)));
+}
+
+double TrainerWindow::CurrentRefreshRate() const {
+    QScreen *screen = windowHandle() ? windowHandle()->screen() : nullptr;
+    if (!screen) {
+        screen = QGuiApplication::primaryScreen();
+    }
+    return screen ? screen->refreshRate() : 60.0;
+}
+
 bool TrainerWindow::IsCurrentItemAltF4() const {
-    if (!training_ || current_index_ < 0 || current_index_ >= items_.size()) {
+    if (!engine_.IsRunning() || !engine_.HasItem()) {
         return false;
     }
-    const TrainingItem &item = items_.at(current_index_);
+    const TrainingItem &item = engine_.CurrentItem();
     return (item.type == TrainingType::kCombo &&
             item.key == Qt::Key_F4 &&
             (item.modifiers & Qt::AltModifier));
@@ -1293,43 +1962,88 @@ QString TrainerWindow::GetKeyDisplayName(int key) const {
 void TrainerWindow::LoadSettings() {
     QSettings settings(QStringLiteral("LeftHandTrainer"), QStringLiteral("Settings"));
 
-    difficulty_ = static_cast<Difficulty>(settings.value(QStringLiteral("difficulty"), 1).toInt());
-    mode_ = static_cast<TrainingMode>(settings.value(QStringLiteral("mode"), 0).toInt());
-    time_limit_seconds_ = settings.value(QStringLiteral("time_limit"), 60).toInt();
-    target_rounds_ = settings.value(QStringLiteral("target_rounds"), 50).toInt();
-    dark_theme_ = settings.value(QStringLiteral("dark_theme"), true).toBool();
+    config_.difficulty = static_cast<Difficulty>(settings.value(QStringLiteral("difficulty"), 1).toInt());
+    config_.mode = static_cast<TrainingMode>(settings.value(QStringLiteral("mode"), 0).toInt());
+    config_.time_limit_seconds = settings.value(QStringLiteral("time_limit"), 60).toInt();
+    config_.target_rounds = settings.value(QStringLiteral("target_rounds"), 50).toInt();
+    config_.sequence_gap_budget_ms = settings.value(QStringLiteral("sequence_gap_budget_ms"), 0).toInt();
+    themes_.LoadUserThemes(SessionLog::DefaultDirectory() + QStringLiteral("/themes"));
+    // Older versions only stored a dark/light flag
+    const bool dark = settings.value(QStringLiteral("dark_theme"), true).toBool();
+    const QString theme_id = settings.value(QStringLiteral("theme"),
+                                            dark ? QStringLiteral("dark")
+                                                 : QStringLiteral("light")).toString();
+    theme_index_ = qMax(0, themes_.IndexOf(theme_id));
     sound_enabled_ = settings.value(QStringLiteral("sound"), true).toBool();
+    raw_input_enabled_ = settings.value(QStringLiteral("raw_input"), false).toBool();
     show_keyboard_ = settings.value(QStringLiteral("keyboard"), true).toBool();
-
-    custom_single_keys_ = settings.value(QStringLiteral("custom_single"), true).toBool();
-    custom_special_keys_ = settings.value(QStringLiteral("custom_special"), true).toBool();
-    custom_combos_ = settings.value(QStringLiteral("custom_combo"), true).toBool();
-    custom_sequences_ = settings.value(QStringLiteral("custom_sequence"), true).toBool();
+    show_heatmap_ = settings.value(QStringLiteral("keyboard_heatmap"), false).toBool();
+    drill_pack_id_ = settings.value(QStringLiteral("drill_pack")).toString();
+    race_name_ = settings.value(QStringLiteral("race_name")).toString();
+    race_host_ = settings.value(QStringLiteral("race_host")).toString();
+    look_ahead_ = qBound(0, settings.value(QStringLiteral("look_ahead"), 2).toInt(),
+                         TrainingEngine::kPrefetchDepth);
+    keyboard_renderer_ = static_cast<KeyboardRenderer>(
+        settings.value(QStringLiteral("keyboard_renderer"),
+                       static_cast<int>(KeyboardRenderer::kPainted)).toInt());
+    engine_.SetLatencyOffset(settings.value(QStringLiteral("latency_offset_ns"), 0).toLongLong());
+
+    config_.custom_single_keys = settings.value(QStringLiteral("custom_single"), true).toBool();
+    config_.custom_special_keys = settings.value(QStringLiteral("custom_special"), true).toBool();
+    config_.custom_combos = settings.value(QStringLiteral("custom_combo"), true).toBool();
+    config_.custom_sequences = settings.value(QStringLiteral("custom_sequence"), true).toBool();
 }
 
 void TrainerWindow::SaveSettings() {
-    QSettings settings(QStringLiteral("LeftHandTrainer"), QStringLiteral("Settings"));
+    // Snapshot here, write on the persistence thread: a QSettings sync can
+    // take long on a network home directory
+    QVariantMap values;
+
+    values.insert(QStringLiteral("difficulty"), static_cast<int>(config_.difficulty));
+    values.insert(QStringLiteral("mode"), static_cast<int>(config_.mode));
+    values.insert(QStringLiteral("time_limit"), config_.time_limit_seconds);
+    values.insert(QStringLiteral("target_rounds"), config_.target_rounds);
+    values.insert(QStringLiteral("sequence_gap_budget_ms"), config_.sequence_gap_budget_ms);
+    values.insert(QStringLiteral("theme"), themes_.At(theme_index_).id);
+    values.insert(QStringLiteral("sound"), sound_enabled_);
+    values.insert(QStringLiteral("raw_input"), raw_input_enabled_);
+    values.insert(QStringLiteral("keyboard"), show_keyboard_);
+    values.insert(QStringLiteral("keyboard_heatmap"), show_heatmap_);
+    values.insert(QStringLiteral("drill_pack"), drill_pack_id_);
+    values.insert(QStringLiteral("race_name"), race_name_);
+    values.insert(QStringLiteral("race_host"), race_host_);
+    values.insert(QStringLiteral("look_ahead"), look_ahead_);
+    values.insert(QStringLiteral("keyboard_renderer"), static_cast<int>(keyboard_renderer_));
+    values.insert(QStringLiteral("latency_offset_ns"), engine_.LatencyOffset());
+
+    values.insert(QStringLiteral("custom_single"), config_.custom_single_keys);
+    values.insert(QStringLiteral("custom_special"), config_.custom_special_keys);
+    values.insert(QStringLiteral("custom_combo"), config_.custom_combos);
+    values.insert(QStringLiteral("custom_sequence"), config_.custom_sequences);
+
+    persistence_.Post([values]() {
+        QSettings settings(QStringLiteral("LeftHandTrainer"), QStringLiteral("Settings"));
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+            settings.setValue(it.key(), it.value());
+        }
+        settings.remove(QStringLiteral("dark_theme"));
+    });
+}
 
-    settings.setValue(QStringLiteral("difficulty"), static_cast<int>(difficulty_));
-    settings.setValue(QStringLiteral("mode"), static_cast<int>(mode_));
-    settings.setValue(QStringLiteral("time_limit"), time_limit_seconds_);
-    settings.setValue(QStringLiteral("target_rounds"), target_rounds_);
-    settings.setValue(QStringLiteral("dark_theme"), dark_theme_);
-    settings.setValue(QStringLiteral("sound"), sound_enabled_);
-    settings.setValue(QStringLiteral("keyboard"), show_keyboard_);
+void TrainerWindow::LoadHistory() {
+    if (session_log_.IsOpen() || !session_log_.Open()) {
+        return;
+    }
 
-    settings.setValue(QStringLiteral("custom_single"), custom_single_keys_);
-    settings.setValue(QStringLiteral("custom_special"), custom_special_keys_);
-    settings.setValue(QStringLiteral("custom_combo"), custom_combos_);
-    settings.setValue(QStringLiteral("custom_sequence"), custom_sequences_);
+    ImportLegacyHistory();
 }
 
-void TrainerWindow::LoadHistory() {
+void TrainerWindow::ImportLegacyHistory() {
+    // Older versions kept the last 100 sessions as a QSettings array
     QSettings settings(QStringLiteral("LeftHandTrainer"), QStringLiteral("History"));
 
     int count = settings.beginReadArray(QStringLiteral("sessions"));
-    history_.clear();
-
+    QVector<SessionRecord> legacy;
     for (int i = 0; i < count; ++i) {
         settings.setArrayIndex(i);
         SessionRecord record;
@@ -1339,52 +2053,421 @@ void TrainerWindow::LoadHistory() {
         record.duration_seconds = settings.value(QStringLiteral("duration")).toDouble();
         record.difficulty = static_cast<Difficulty>(settings.value(QStringLiteral("difficulty")).toInt());
         record.mode = static_cast<TrainingMode>(settings.value(QStringLiteral("mode")).toInt());
-        history_.append(record);
+        record.reaction.count = settings.value(QStringLiteral("reaction_count")).toInt();
+        record.reaction.min_ns = settings.value(QStringLiteral("reaction_min")).toLongLong();
+        record.reaction.median_ns = settings.value(QStringLiteral("reaction_median")).toLongLong();
+        record.reaction.p95_ns = settings.value(QStringLiteral("reaction_p95")).toLongLong();
+        record.reaction.p99_ns = settings.value(QStringLiteral("reaction_p99")).toLongLong();
+        legacy.append(record);
     }
-
     settings.endArray();
+
+    if (legacy.isEmpty()) {
+        return;
+    }
+
+    // The array is newest first; the log is chronological
+    for (int i = legacy.size() - 1; i >= 0; --i) {
+        if (!session_log_.AppendSession(ToLogRecord(legacy.at(i)), {})) {
+            return;
+        }
+    }
+    settings.remove(QStringLiteral("sessions"));
 }
 
-void TrainerWindow::SaveHistory() {
-    QSettings settings(QStringLiteral("LeftHandTrainer"), QStringLiteral("History"));
+SessionLogRecord TrainerWindow::ToLogRecord(const SessionRecord &record) {
+    SessionLogRecord log_record;
+    log_record.timestamp_ms = record.timestamp.toMSecsSinceEpoch();
+    log_record.duration_us = static_cast<qint64>(record.duration_seconds * 1e6);
+    log_record.total_rounds = record.total_rounds;
+    log_record.correct_rounds = record.correct_rounds;
+    log_record.difficulty = static_cast<quint8>(record.difficulty);
+    log_record.mode = static_cast<quint8>(record.mode);
+    log_record.reaction_count = record.reaction.count;
+    log_record.reaction_min_ns = record.reaction.min_ns;
+    log_record.reaction_median_ns = record.reaction.median_ns;
+    log_record.reaction_p95_ns = record.reaction.p95_ns;
+    log_record.reaction_p99_ns = record.reaction.p99_ns;
+    return log_record;
+}
 
-    settings.beginWriteArray(QStringLiteral("sessions"));
+void TrainerWindow::PlaySound(bool correct) {
+    if (!sound_enabled_) return;
+    sound_->Play(correct ? SoundEngine::Sound::kCorrect : SoundEngine::Sound::kWrong);
+}
 
-    for (int i = 0; i < history_.size(); ++i) {
-        settings.setArrayIndex(i);
-        const SessionRecord &record = history_.at(i);
-        settings.setValue(QStringLiteral("timestamp"), record.timestamp);
-        settings.setValue(QStringLiteral("total"), record.total_rounds);
-        settings.setValue(QStringLiteral("correct"), record.correct_rounds);
-        settings.setValue(QStringLiteral("duration"), record.duration_seconds);
-        settings.setValue(QStringLiteral("difficulty"), static_cast<int>(record.difficulty));
-        settings.setValue(QStringLiteral("mode"), static_cast<int>(record.mode));
+void TrainerWindow::SetRawInputEnabled(bool enabled) {
+    if (enabled) {
+        raw_input_enabled_ = raw_input_.Start();
+    } else {
+        raw_input_.Stop();
+        raw_input_enabled_ = false;
     }
+    raw_input_failed_ = enabled && !raw_input_enabled_;
+    UpdateRawInputLabel();
 
-    settings.endArray();
+    if (raw_input_check_ && raw_input_check_->isChecked() != raw_input_enabled_) {
+        const QSignalBlocker blocker(raw_input_check_);
+        raw_input_check_->setChecked(raw_input_enabled_);
+    }
 }
 
-void TrainerWindow::PlaySound(bool correct) {
-    // Sound implementation placeholder
-    // In a full implementation, this would play audio feedback
-    Q_UNUSED(correct);
+void TrainerWindow::UpdateRawInputLabel() {
+    if (!raw_input_label_) return;
+    if (raw_input_enabled_) {
+        raw_input_label_->setText(QStringLiteral("按键时间: 来自键盘设备"));
+    } else if (raw_input_failed_) {
+        raw_input_label_->setText(QStringLiteral("无法读取键盘设备, 按键时间来自 Qt 事件"));
+    } else {
+        raw_input_label_->setText(QStringLiteral("按键时间: 来自 Qt 事件"));
+    }
+}
+
+void TrainerWindow::SetProfileOverlayVisible(bool visible) {
+    if (!profile_overlay_) return;
+    profile_overlay_->setVisible(visible);
+    if (visible) {
+        UpdateProfileOverlay();
+        profile_timer_->start();
+    } else {
+        profile_timer_->stop();
+    }
+}
+
+void TrainerWindow::UpdateProfileOverlay() {
+    if (!profile_overlay_ || !profile_overlay_->isVisible()) return;
+
+    auto us = [](qint64 ns) {
+        return QString::number(static_cast<double>(ns) / 1e3, 'f', 1);
+    };
+    QString text = QStringLiteral("%1 %2 %3 %4")
+                       .arg(QStringLiteral("stage"), -22)
+                       .arg(QStringLiteral("p50 us"), 9)
+                       .arg(QStringLiteral("p99 us"), 9)
+                       .arg(QStringLiteral("n"), 8);
+    for (int i = 0; i < static_cast<int>(ProfileStage::kCount); ++i) {
+        const ProfileStage stage = static_cast<ProfileStage>(i);
+        const ProfileSummary summary = Profiler::Instance().Summary(stage);
+        text += QStringLiteral("\n%1 %2 %3 %4")
+                    .arg(QLatin1String(Profiler::StageName(stage)), -22)
+                    .arg(us(summary.p50_ns), 9)
+                    .arg(us(summary.p99_ns), 9)
+                    .arg(summary.total_count, 8);
+    }
+    profile_overlay_->setText(text);
+    PlaceProfileOverlay();
+}
+
+void TrainerWindow::PlaceProfileOverlay() {
+    if (!profile_overlay_ || !profile_overlay_->isVisible()) return;
+    profile_overlay_->adjustSize();
+    profile_overlay_->move(training_page_->width() - profile_overlay_->width() - 8, 50);
+    profile_overlay_->raise();
+}
+
+void TrainerWindow::ExportProfileTrace() {
+    const QString path = SessionLog::DefaultDirectory() +
+                         QStringLiteral("/profile-%1.json")
+                             .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss")));
+    if (!QDir().mkpath(SessionLog::DefaultDirectory()) ||
+        !Profiler::Instance().ExportTrace(path)) {
+        profile_trace_label_->setText(QStringLiteral("导出失败"));
+        return;
+    }
+    profile_trace_label_->setText(QStringLiteral("%1 个事件已导出到 %2")
+                                      .arg(Profiler::Instance().TraceEventCount())
+                                      .arg(QDir::toNativeSeparators(path)));
+}
+
+void TrainerWindow::HostRace() {
+    const QString name = race_name_.trimmed().isEmpty() ? QStringLiteral("玩家") : race_name_;
+    QString error;
+    race_error_ = race_->Host(name, RaceProtocol::kDefaultPort, &error) ? QString() : error;
+    UpdateRaceControls();
+}
+
+void TrainerWindow::JoinRace() {
+    const QString name = race_name_.trimmed().isEmpty() ? QStringLiteral("玩家") : race_name_;
+    QString error;
+    race_error_ = race_->Join(race_host_, name, RaceProtocol::kDefaultPort, &error) ? QString()
+                                                                                   : error;
+    UpdateRaceControls();
+}
+
+void TrainerWindow::LeaveRace() {
+    if (racing_) {
+        StopTraining();
+    }
+    race_error_.clear();
+    race_->Leave();
+}
+
+void TrainerWindow::StartLanRace() {
+    if (race_->CurrentRole() != RaceSession::Role::kHost || engine_.IsRunning()) {
+        return;
+    }
+
+    RaceProtocol::RaceSettings settings;
+    do {
+        settings.race_id = QRandomGenerator::global()->generate();
+    } while (settings.race_id == 0 || settings.race_id == race_settings_.race_id);
+    settings.seed = QRandomGenerator::global()->generate();
+    settings.difficulty = static_cast<quint8>(config_.difficulty);
+    settings.mode = static_cast<quint8>(config_.mode);
+    settings.custom_types = (config_.custom_single_keys ? KeyTrace::kCustomSingleKeys : 0) |
+                            (config_.custom_special_keys ? KeyTrace::kCustomSpecialKeys : 0) |
+                            (config_.custom_combos ? KeyTrace::kCustomCombos : 0) |
+                            (config_.custom_sequences ? KeyTrace::kCustomSequences : 0);
+    settings.target_rounds = config_.target_rounds;
+    settings.time_limit_seconds = config_.time_limit_seconds;
+    settings.sequence_gap_budget_ms = config_.sequence_gap_budget_ms;
+    settings.drill_pack_hash = drill_pack_.IsOpen() ? drill_pack_.Hash() : 0;
+    settings.start_delay_ms = kRaceStartDelayMs;
+    race_->StartRace(settings);
+}
+
+void TrainerWindow::OnRaceStarted(const RaceProtocol::RaceSettings &settings) {
+    if (calibrating_) {
+        return;
+    }
+    // Different items under the same seed would not be a race
+    const quint32 pack_hash = drill_pack_.IsOpen() ? drill_pack_.Hash() : 0;
+    if (settings.drill_pack_hash != pack_hash) {
+        race_error_ = QStringLiteral("训练包与主机不同, 未参加本场比赛");
+        UpdateRaceControls();
+        return;
+    }
+    if (engine_.IsRunning()) {
+        StopTraining();
+    }
+
+    if (!racing_) {
+        race_restore_config_ = config_;
+    }
+    racing_ = true;
+    race_settings_ = settings;
+    race_error_.clear();
+
+    config_.difficulty = static_cast<Difficulty>(
+        qMin<int>(settings.difficulty, static_cast<int>(Difficulty::kCustom)));
+    config_.mode = static_cast<TrainingMode>(
+        qMin<int>(settings.mode, static_cast<int>(TrainingMode::kZen)));
+    config_.custom_single_keys = settings.custom_types & KeyTrace::kCustomSingleKeys;
+    config_.custom_special_keys = settings.custom_types & KeyTrace::kCustomSpecialKeys;
+    config_.custom_combos = settings.custom_types & KeyTrace::kCustomCombos;
+    config_.custom_sequences = settings.custom_types & KeyTrace::kCustomSequences;
+    // Every player clamps the same way, so the sessions stay identical
+    config_.target_rounds = qBound(kMinTargetRounds, settings.target_rounds, kMaxTargetRounds);
+    config_.time_limit_seconds =
+        qBound(kMinTimeLimitSeconds, settings.time_limit_seconds, kMaxTimeLimitSeconds);
+    config_.sequence_gap_budget_ms = qBound(0, settings.sequence_gap_budget_ms, kMaxGapBudgetMs);
+    config_.adaptive = false;
+    engine_.SetConfig(config_);
+
+    const int start_delay_ms = qBound(0, settings.start_delay_ms, kMaxRaceStartDelayMs);
+    race_start_ns_ = ReactionClock::NowNs() + static_cast<qint64>(start_delay_ms) * 1000000;
+    ShowTraining();
+    start_button_->setEnabled(false);
+    stop_button_->setEnabled(true);
+    settings_button_->setEnabled(false);
+    history_button_->setEnabled(false);
+    UpdateErrorLabel(QString());
+    OnRaceCountdown();
+    UpdateRaceControls();
+}
+
+void TrainerWindow::OnRaceCountdown() {
+    if (!racing_ || engine_.IsRunning()) return;
+
+    const qint64 remaining_ns = race_start_ns_ - ReactionClock::NowNs();
+    if (remaining_ns <= 0) {
+        if (!BeginSession(race_settings_.seed)) {
+            CancelRaceCountdown();
+            target_label_->setText(QStringLiteral("无训练项目"));
+        }
+        return;
+    }
+    const qint64 seconds = (remaining_ns + 999999999LL) / 1000000000LL;
+    target_label_->setText(QStringLiteral("比赛即将开始\n%1").arg(seconds));
+    // Wake up at the next whole second, or at the start itself
+    const qint64 until_next_ns = remaining_ns - (seconds - 1) * 1000000000LL;
+    race_countdown_timer_->start(static_cast<int>((until_next_ns + 999999) / 1000000));
+}
+
+void TrainerWindow::CancelRaceCountdown() {
+    race_countdown_timer_->stop();
+    start_button_->setEnabled(true);
+    stop_button_->setEnabled(false);
+    pause_button_->setEnabled(false);
+    settings_button_->setEnabled(true);
+    history_button_->setEnabled(true);
+    target_label_->setText(QStringLiteral("已退出比赛"));
+    EndRace();
+}
+
+void TrainerWindow::EndRace() {
+    race_countdown_timer_->stop();
+    racing_ = false;
+    config_ = race_restore_config_;
+    engine_.SetConfig(config_);
+    render_->Mark(RenderScheduler::kRace);
+}
+
+void TrainerWindow::PublishRaceProgress(bool finished) {
+    const qint64 now_ns = ReactionClock::NowNs();
+    RaceProtocol::Progress progress;
+    progress.race_id = race_settings_.race_id;
+    progress.rounds_total = static_cast<quint32>(engine_.RoundsTotal());
+    progress.rounds_correct = static_cast<quint32>(engine_.RoundsCorrect());
+    progress.elapsed_ms = static_cast<quint32>(engine_.ElapsedNs(now_ns) / 1000000);
+    const ReactionStats &reactions = engine_.Reactions();
+    progress.median_reaction_us = reactions.Count() > 0
+                                      ? static_cast<quint32>(reactions.Percentile(50.0) / 1000)
+                                      : 0;
+    progress.finished = finished;
+    race_->UpdateProgress(progress);
+}
+
+void TrainerWindow::RenderRaceStandings() {
+    if (race_->CurrentRole() == RaceSession::Role::kIdle) {
+        race_label_->hide();
+        return;
+    }
+
+    // Players in the current race first, by correct rounds, then by who
+    // finished sooner
+    QVector<const RaceProtocol::Standing *> order;
+    order.reserve(race_->Standings().size());
+    for (const RaceProtocol::Standing &standing : race_->Standings()) {
+        order.append(&standing);
+    }
+    const quint32 race_id = race_settings_.race_id;
+    std::stable_sort(order.begin(), order.end(),
+                     [race_id](const RaceProtocol::Standing *a, const RaceProtocol::Standing *b) {
+                         const bool a_in = race_id != 0 && a->progress.race_id == race_id;
+                         const bool b_in = race_id != 0 && b->progress.race_id == race_id;
+                         if (a_in != b_in) return a_in;
+                         if (a->progress.rounds_correct != b->progress.rounds_correct) {
+                             return a->progress.rounds_correct > b->progress.rounds_correct;
+                         }
+                         if (a->progress.finished != b->progress.finished) {
+                             return a->progress.finished;
+                         }
+                         return a->progress.elapsed_ms < b->progress.elapsed_ms;
+                     });
+
+    QStringList entries;
+    int rank = 0;
+    for (const RaceProtocol::Standing *standing : order) {
+        const RaceProtocol::Progress &progress = standing->progress;
+        if (race_id == 0 || progress.race_id != race_id) {
+            entries.append(QStringLiteral("%1 (等待)").arg(standing->name));
+            continue;
+        }
+        QString entry = QStringLiteral("%1. %2 %3/%4")
+                            .arg(++rank)
+                            .arg(standing->name)
+                            .arg(progress.rounds_correct)
+                            .arg(progress.rounds_total);
+        if (progress.finished) {
+            entry += QStringLiteral(" ✓%1s").arg(QString::number(progress.elapsed_ms / 1000.0, 'f', 1));
+        }
+        entries.append(entry);
+    }
+    race_label_->setText(QStringLiteral("竞速: ") + entries.join(QStringLiteral("   ")));
+    race_label_->show();
+}
+
+void TrainerWindow::UpdateRaceControls() {
+    render_->Mark(RenderScheduler::kRace);
+    if (!race_status_label_) return;
+
+    const bool available = RaceSession::IsAvailable();
+    const RaceSession::Role role = race_->CurrentRole();
+    const bool idle = role == RaceSession::Role::kIdle;
+    race_name_edit_->setEnabled(available && idle);
+    race_host_edit_->setEnabled(available && idle);
+    race_host_button_->setEnabled(available && idle);
+    race_join_button_->setEnabled(available && idle);
+    race_leave_button_->setEnabled(!idle);
+    race_start_button_->setEnabled(role == RaceSession::Role::kHost);
+
+    const int players = race_->Standings().size();
+    QString status;
+    if (!available) {
+        status = QStringLiteral("需要 Qt Network 模块");
+    } else if (!race_error_.isEmpty()) {
+        status = race_error_;
+    } else if (role == RaceSession::Role::kHost) {
+        status = QStringLiteral("房间已创建 (UDP 端口 %1), %2 名玩家")
+                     .arg(RaceProtocol::kDefaultPort)
+                     .arg(players);
+    } else if (role == RaceSession::Role::kClient) {
+        status = race_->IsConnected()
+                     ? QStringLiteral("已加入 %1, %2 名玩家").arg(race_host_).arg(players)
+                     : QStringLiteral("正在连接 %1 ...").arg(race_host_);
+    }
+    race_status_label_->setText(status);
+}
+
+void TrainerWindow::UpdateSoundLatencyLabel() {
+    if (!sound_latency_label_) return;
+
+    if (!sound_->IsAvailable()) {
+        sound_latency_label_->setText(QStringLiteral("声音输出不可用"));
+        return;
+    }
+
+    auto ms = [](qint64 ns) {
+        return QString::number(static_cast<double>(ns) / 1e6, 'f', 1);
+    };
+    const SoundLatency latency = sound_->Latency();
+    if (latency.count == 0) {
+        sound_latency_label_->setText(QStringLiteral("声音延迟: 尚未播放 (输出缓冲 %1 ms)")
+                                          .arg(ms(latency.buffer_ns)));
+        return;
+    }
+    sound_latency_label_->setText(QStringLiteral("声音延迟: 最近 %1 ms, 最大 %2 ms (含输出缓冲 %3 ms)")
+                                      .arg(ms(latency.last_ns))
+                                      .arg(ms(latency.max_ns))
+                                      .arg(ms(latency.buffer_ns)));
 }
 
 void TrainerWindow::keyPressEvent(QKeyEvent *event) {
+    LHT_PROFILE_SCOPE(ProfileStage::kKeyPress);
+    // Stamp the key before any handling so UI work does not skew reaction times
+    qint64 key_ns = key_clock_.Stamp(static_cast<quint64>(event->timestamp()));
+    // The raw backend saw the same press earlier, before any event dispatch
+    if (raw_input_.IsRunning() && !event->isAutoRepeat()) {
+        qint64 raw_ns = 0;
+        if (raw_input_.TakePress(event->nativeScanCode(), ReactionClock::NowNs(), &raw_ns)) {
+            key_ns = raw_ns;
+        }
+    }
+
+    if (calibrating_) {
+        if (event->key() == Qt::Key_Escape) {
+            EndCalibration();
+            target_label_->setText(QStringLiteral("校准已取消"));
+            stats_label_->ShowMessage(QStringLiteral("未开始"));
+        } else if (!event->isAutoRepeat()) {
+            HandleCalibrationKey(key_ns);
+        }
+        return;
+    }
+
     // Handle resume from pause with Space
-    if (paused_ && event->key() == Qt::Key_Space) {
+    if (engine_.IsPaused() && event->key() == Qt::Key_Space) {
         ResumeTraining();
         return;
     }
 
-    if (!training_ || paused_) {
+    if (!engine_.IsRunning() || engine_.IsPaused()) {
         QMainWindow::keyPressEvent(event);
         return;
     }
 
-    if (items_.isEmpty() ||
-        current_index_ < 0 ||
-        current_index_ >= items_.size()) {
+    if (!engine_.HasItem()) {
         return;
     }
 
@@ -1413,161 +2496,12 @@ void TrainerWindow::keyPressEvent(QKeyEvent *event) {
         return;
     }
 
-    const TrainingItem &item = items_.at(current_index_);
-
-    switch (item.type) {
-        case TrainingType::kSingleKey: {
-            QString text = event->text().toLower();
-            if (text.isEmpty()) return;
-
-            QChar ch = text.at(0);
-            QChar expected = item.sequence.isEmpty() ? QChar() : item.sequence.at(0);
-
-            rounds_total_++;
-
-            if (!item.sequence.isEmpty() && ch == expected) {
-                rounds_correct_++;
-                UpdateErrorLabel(QString());
-                PlaySound(true);
-                NextItem();
-            } else {
-                QString error_text = QStringLiteral("错误: 期望 '%1', 输入 '%2'")
-                                         .arg(QString(expected))
-                                         .arg(QString(ch));
-                UpdateErrorLabel(error_text);
-                PlaySound(false);
-            }
-
-            UpdateStatsLabel();
-
-            // Check challenge mode completion
-            if (mode_ == TrainingMode::kChallenge && rounds_correct_ >= target_rounds_) {
-                StopTraining();
-                target_label_->setText(QStringLiteral("挑战完成!"));
-            }
-            return;
-        }
-
-        case TrainingType::kCombo: {
-            if (IsCurrentItemAltF4()) {
-                return;
-            }
-
-            Qt::KeyboardModifiers mods =
-                event->modifiers() &
-                (Qt::ControlModifier | Qt::ShiftModifier | Qt::AltModifier | Qt::MetaModifier);
-            int key = event->key();
-
-            rounds_total_++;
-
-            if (key == item.key && mods == item.modifiers) {
-                rounds_correct_++;
-                UpdateErrorLabel(QString());
-                PlaySound(true);
-                NextItem();
-            } else {
-                QString error_text = QStringLiteral("错误: 请按 %1").arg(item.label);
-                UpdateErrorLabel(error_text);
-                PlaySound(false);
-            }
-
-            UpdateStatsLabel();
-
-            if (mode_ == TrainingMode::kChallenge && rounds_correct_ >= target_rounds_) {
-                StopTraining();
-                target_label_->setText(QStringLiteral("挑战完成!"));
-            }
-            return;
-        }
-
-        case TrainingType::kSpecialKey: {
-            int key = event->key();
-
-            rounds_total_++;
-
-            if (key == item.key) {
-                rounds_correct_++;
-                UpdateErrorLabel(QString());
-                PlaySound(true);
-                NextItem();
-            } else {
-                QString error_text = QStringLiteral("错误: 请按 %1").arg(item.label);
-                UpdateErrorLabel(error_text);
-                PlaySound(false);
-            }
-
-            UpdateStatsLabel();
-
-            if (mode_ == TrainingMode::kChallenge && rounds_correct_ >= target_rounds_) {
-                StopTraining();
-                target_label_->setText(QStringLiteral("挑战完成!"));
-            }
-            return;
-        }
-
-        case TrainingType::kSequence: {
-            QString text = event->text().toLower();
-            if (text.isEmpty()) return;
-
-            const QString &seq = item.sequence;
-            if (seq.isEmpty()) return;
-
-            if (sequence_pos_ < 0 || sequence_pos_ >= seq.size()) {
-                sequence_pos_ = 0;
-            }
-
-            QChar expected = seq.at(sequence_pos_);
-            QChar ch = text.at(0);
-
-            if (ch == expected) {
-                sequence_pos_++;
-                UpdateErrorLabel(QString());
-
-                if (sequence_pos_ >= seq.size()) {
-                    rounds_total_++;
-                    rounds_correct_++;
-                    PlaySound(true);
-                    NextItem();
-                } else {
-                    QString display = QStringLiteral("%1\n(%2/%3)")
-                                          .arg(item.label)
-                                          .arg(sequence_pos_)
-                                          .arg(seq.size());
-                    target_label_->setText(display);
-
-                    // Highlight next key
-                    UpdateVirtualKeyboard(QString(seq.at(sequence_pos_)));
-                }
-            } else {
-                rounds_total_++;
-                PlaySound(false);
-
-                QString error_text = QStringLiteral("错误: 期望 '%1', 输入 '%2'")
-                                         .arg(QString(expected))
-                                         .arg(QString(ch));
-                UpdateErrorLabel(error_text);
-
-                sequence_pos_ = 0;
-                QString display = QStringLiteral("%1\n(%2/%3)")
-                                      .arg(item.label)
-                                      .arg(0)
-                                      .arg(seq.size());
-                target_label_->setText(display);
-
-                UpdateVirtualKeyboard(QString(seq.at(0)));
-            }
-
-            UpdateStatsLabel();
-
-            if (mode_ == TrainingMode::kChallenge && rounds_correct_ >= target_rounds_) {
-                StopTraining();
-                target_label_->setText(QStringLiteral("挑战完成!"));
-            }
-            return;
-        }
+    // Alt+F4 never reaches us as a key press; closeEvent scores it
+    if (IsCurrentItemAltF4()) {
+        return;
     }
 
-    QMainWindow::keyPressEvent(event);
+    HandleTrainingKey(event->key(), event->modifiers(), key_ns);
 }
 
 void TrainerWindow::keyReleaseEvent(QKeyEvent *event) {
@@ -1591,6 +2525,8 @@ void TrainerWindow::resizeEvent(QResizeEvent *event) {
         max_width = 80;
     }
 
+    PlaceProfileOverlay();
+
     error_label_->move(margin_x, margin_y);
     error_label_->setMaximumWidth(max_width);
     error_label_->adjustSize();
@@ -1598,20 +2534,9 @@ void TrainerWindow::resizeEvent(QResizeEvent *event) {
 }
 
 void TrainerWindow::closeEvent(QCloseEvent *event) {
-    if (training_) {
+    if (engine_.IsRunning()) {
         if (IsCurrentItemAltF4()) {
-            rounds_total_++;
-            rounds_correct_++;
-            UpdateErrorLabel(QString());
-            PlaySound(true);
-            NextItem();
-            UpdateStatsLabel();
-
-            if (mode_ == TrainingMode::kChallenge && rounds_correct_ >= target_rounds_) {
-                StopTraining();
-                target_label_->setText(QStringLiteral("挑战完成!"));
-            }
-
+            HandleTrainingKey(Qt::Key_F4, Qt::AltModifier, ReactionClock::NowNs());
             event->ignore();
             return;
         }
@@ -1620,6 +2545,9 @@ void TrainerWindow::closeEvent(QCloseEvent *event) {
         event->ignore();
         return;
     }
+    if (racing_) {
+        EndRace();
+    }
 
     SaveSettings();
     QMainWindow::closeEvent(event);
@@ -5,26 +5,47 @@
 #include <QMainWindow>
 #include <QString>
 #include <QVector>
+#include <QHash>
 #include <QMap>
 #include <QSet>
 #include <Qt>
 
+#include "drill_pack.h"
+#include "keyboard_layout.h"
+#include "latency_calibration.h"
+#include "persistence_writer.h"
+#include "race_protocol.h"
+#include "raw_input.h"
+#include "reaction_timing.h"
+#include "session_log.h"
+#include "theme.h"
+#include "training_engine.h"
+
 class QLabel;
 class QPushButton;
 class QComboBox;
+class QLineEdit;
 class QCheckBox;
 class QSpinBox;
 class QProgressBar;
 class QTimer;
-class QElapsedTimer;
 class QKeyEvent;
 class QResizeEvent;
 class QCloseEvent;
 class QGridLayout;
 class QStackedWidget;
 class QSettings;
-class QSoundEffect;
 class QFrame;
+class FieldLabel;
+class PaintedKeyboard;
+class ProgressChart;
+class PromptLabel;
+class RollingSparkline;
+class QListView;
+class HistoryListModel;
+class RenderScheduler;
+class RaceSession;
+class SoundEngine;
 
 // Member functions use UpperCamelCase.
 // Qt virtuals keep original names: keyPressEvent / resizeEvent / closeEvent.
@@ -51,54 +72,30 @@ private slots:
     void ShowSettings();
     void ShowTraining();
     void ShowHistory();
-    void OnTimerTick();
+    void OnDeadline();
+    void OnDisplayTick();
     void OnDifficultyChanged(int index);
     void OnModeChanged(int index);
     void ResetHistory();
+    void StartCalibration();
+    void HostRace();
+    void JoinRace();
+    void LeaveRace();
+    void StartLanRace();
 
 private:
-    // Training difficulty levels
-    enum class Difficulty {
-        kBeginner,      // Only single keys
-        kIntermediate,  // Single keys + special keys + simple combos
-        kAdvanced,      // All items including sequences
-        kCustom         // User-selected types
-    };
-
-    // Training modes
-    enum class TrainingMode {
-        kEndless,       // No time limit
-        kTimed,         // Fixed time, count rounds
-        kChallenge,     // Fixed rounds, measure time
-        kZen            // No stats, just practice
-    };
-
-    // One training unit:
-    // - kSingleKey: single key like "q", "1"
-    // - kCombo: with modifiers, e.g. Ctrl+1, Shift+Q, Alt+F4
-    // - kSequence: string combo, e.g. "1a", "qwer"
-    // - kSpecialKey: special key (Space, Tab, F1~F8)
-    enum class TrainingType {
-        kSingleKey,
-        kCombo,
-        kSequence,
-        kSpecialKey
+    // Feedback for the last key of the current prompt
+    enum class PromptError {
+        kNone,
+        kWrongText,     // "expected 'x', typed 'y'"
+        kWrongKey,      // "press <label>"
+        kTooSlow        // "x -> y took n ms"
     };
 
-    struct TrainingItem {
-        TrainingType type;
-        QString label;      // UI text, e.g. "Q", "Ctrl+1", "QWER"
-        QString sequence;   // single/sequence lowercase string, e.g. "q", "qwer"
-        int key = 0;        // for combo/special: Qt::Key_*
-        Qt::KeyboardModifiers modifiers = Qt::NoModifier;
-        Difficulty min_difficulty = Difficulty::kBeginner;
-
-        static TrainingItem MakeSingleKey(QChar ch, Difficulty diff = Difficulty::kBeginner);
-        static TrainingItem MakeSequence(const QString &seq, Difficulty diff = Difficulty::kAdvanced);
-        static TrainingItem MakeCombo(Qt::KeyboardModifiers mods, int key,
-                                      const QString &label, Difficulty diff = Difficulty::kIntermediate);
-        static TrainingItem MakeSpecialKey(int key, const QString &label,
-                                           Difficulty diff = Difficulty::kIntermediate);
+    // Virtual keyboard implementation
+    enum class KeyboardRenderer {
+        kLabels,        // one styled QLabel per key
+        kPainted        // single custom-painted widget
     };
 
     // History record for each session
@@ -109,25 +106,73 @@ private:
         double duration_seconds = 0.0;
         Difficulty difficulty = Difficulty::kBeginner;
         TrainingMode mode = TrainingMode::kEndless;
+        // Prompt-to-correct-key latency of the session
+        ReactionSummary reaction;
     };
 
+    // Starts a session; StartTraining draws a random seed, races use the host's
+    bool BeginSession(quint32 seed);
+
     // UI Setup
     void SetupMainUI();
     void SetupTrainingPage();
     void SetupSettingsPage();
     void SetupHistoryPage();
+    // Long-term chart for the selected metric and period
+    void UpdateProgressChart();
     void SetupVirtualKeyboard();
+    void BuildKeyboardBoard();
+    void ApplyHeatmap();
     void UpdateVirtualKeyboard(const QString &highlight_keys = QString(),
                                Qt::KeyboardModifiers mods = Qt::NoModifier);
+    void SetKeyboardHighlights(const KeyHighlightList &highlights);
+    void ApplyKeyState(QLabel *label, KeyState state);
 
-    // Training logic
-    void InitAllTrainingItems();
-    void FilterItemsByDifficulty();
+    // Training view; the session itself lives in engine_
     void ShowCurrentItem();
+    // Feeds a key to the engine and reacts to the result for every item type
+    void HandleTrainingKey(int key, Qt::KeyboardModifiers mods, qint64 key_ns);
+    // Coalesced widget updates, driven by render_
+    void RenderDirty(quint32 parts);
+    void RenderTarget();
+    void RenderKeyboard();
+    void RenderLookAhead();
+    void RenderError();
     void UpdateStatsLabel();
     void UpdateTimerLabel();
+    void ArmSessionTimers();
+    void UpdateReactionLabel();
+    void UpdateRollingLabel();
+
+    // Latency calibration
+    void HandleCalibrationKey(qint64 key_ns);
+    void OnPromptPainted(qint64 painted_ns);
+    void FinishCalibration();
+    void EndCalibration();
+    void UpdateLatencyOffsetLabel();
+    double CurrentRefreshRate() const;
     void SaveSessionRecord();
+    // Key trace of the session just stopped, for replay
+    void SaveKeyTrace();
     void PlaySound(bool correct);
+    void UpdateSoundLatencyLabel();
+    void SetRawInputEnabled(bool enabled);
+    // Profiling overlay and trace export (LHT_PROFILE builds)
+    void SetProfileOverlayVisible(bool visible);
+    void UpdateProfileOverlay();
+    void PlaceProfileOverlay();
+    void ExportProfileTrace();
+    void UpdateRawInputLabel();
+
+    // LAN race: the host's settings replace config_ until the race ends
+    void OnRaceStarted(const RaceProtocol::RaceSettings &settings);
+    void OnRaceCountdown();
+    // Stop, ESC or leaving before the race's first prompt; nothing to save
+    void CancelRaceCountdown();
+    void EndRace();
+    void PublishRaceProgress(bool finished);
+    void RenderRaceStandings();
+    void UpdateRaceControls();
 
     // Theme and styling
     void ApplyTheme();
@@ -137,48 +182,65 @@ private:
     // Persistence
     void LoadSettings();
     void SaveSettings();
+    // Opens the session log on first use: history page, heatmap or a save
     void LoadHistory();
-    void SaveHistory();
+    void ImportLegacyHistory();
+    static SessionLogRecord ToLogRecord(const SessionRecord &record);
 
+    void BuildPromptViews();
+    // Opens drill_pack_id_ (or goes back to the built-in items) and hands it to engine_
+    void ApplyDrillPack();
+    void ListDrillPacks();
+    void UpdateDrillPackLabel();
     bool IsCurrentItemAltF4() const;
     QString GetKeyDisplayName(int key) const;
 
-    // All possible training items
-    QVector<TrainingItem> all_items_;
-    // Filtered items based on current difficulty
-    QVector<TrainingItem> items_;
-    int current_index_ = -1;
-    int sequence_pos_ = 0;
-
-    bool training_ = false;
-    bool paused_ = false;
-
-    int rounds_total_ = 0;
-    int rounds_correct_ = 0;
-    int target_rounds_ = 50;        // for Challenge mode
-    int time_limit_seconds_ = 60;   // for Timed mode
-    int remaining_seconds_ = 0;
-
-    Difficulty difficulty_ = Difficulty::kIntermediate;
-    TrainingMode mode_ = TrainingMode::kEndless;
-    bool dark_theme_ = true;
+    // Item selection, matching, scoring and mode completion
+    TrainingEngine engine_;
+    // Settings page selection, handed to engine_ on every change
+    TrainingConfig config_;
+    // Selected drill pack; only this one is opened, others are listed on
+    // the settings page from their headers
+    DrillPack drill_pack_;
+    QString drill_pack_id_;         // empty: built-in items
+    QString drill_pack_error_;      // why drill_pack_id_ could not be opened
+
+    ThemeRegistry themes_;
+    int theme_index_ = 0;           // into themes_
     bool sound_enabled_ = true;
     bool show_keyboard_ = true;
+    bool show_heatmap_ = false;     // per-key history overlay on the keyboard
+    KeyboardRenderer keyboard_renderer_ = KeyboardRenderer::kPainted;
+
+    // Timers; all session time comes from engine_ on ReactionClock
+    QTimer *deadline_timer_ = nullptr;      // single shot at the Timed mode limit
+    QTimer *display_timer_ = nullptr;       // single shot at the next clock second
+    RenderScheduler *render_ = nullptr;
+    PromptError prompt_error_ = PromptError::kNone;
+    int error_expected_key_ = 0;
+    int error_pressed_key_ = 0;
+    qint64 error_gap_ns_ = 0;
+
+    // Maps Qt key event times onto ReactionClock
+    KeyEventClock key_clock_;
+
+    // OS-level key timestamps, preferred over Qt's when available
+    RawInputSource raw_input_;
+    bool raw_input_enabled_ = false;
+    bool raw_input_failed_ = false;         // requested but the device could not be read
 
-    // Custom mode type selection
-    bool custom_single_keys_ = true;
-    bool custom_special_keys_ = true;
-    bool custom_combos_ = true;
-    bool custom_sequences_ = true;
+    // Measures the app + display latency that engine_ subtracts
+    bool calibrating_ = false;
+    LatencyCalibration calibration_;
+    static constexpr int kCalibrationSamples = 30;
 
-    // Timers
-    QElapsedTimer *elapsed_ = nullptr;
-    QTimer *countdown_timer_ = nullptr;
-    qint64 paused_elapsed_ = 0;
+    // Every disk write after startup; declared before session_log_, whose
+    // queued writes it runs, and drained when the window is destroyed
+    PersistenceWriter persistence_;
 
-    // Session history
-    QVector<SessionRecord> history_;
-    static constexpr int kMaxHistoryRecords = 100;
+    // Session history, read through the memory-mapped log
+    SessionLog session_log_;
+    static constexpr int kKeptTraces = 50;
 
     // Key state tracking for virtual keyboard
     QSet<int> pressed_keys_;
@@ -190,9 +252,13 @@ private:
     // UI Widgets - Training Page
     QWidget *training_page_ = nullptr;
     QLabel *error_label_ = nullptr;
-    QLabel *target_label_ = nullptr;
-    QLabel *stats_label_ = nullptr;
-    QLabel *timer_label_ = nullptr;
+    PromptLabel *target_label_ = nullptr;
+    // Updated on every key; painted from cached glyphs, see FieldLabel
+    FieldLabel *stats_label_ = nullptr;
+    FieldLabel *reaction_label_ = nullptr;
+    FieldLabel *rolling_label_ = nullptr;
+    RollingSparkline *rolling_sparkline_ = nullptr;     // 10 s keys per minute
+    FieldLabel *timer_label_ = nullptr;
     QLabel *mode_label_ = nullptr;
     QProgressBar *progress_bar_ = nullptr;
     QPushButton *start_button_ = nullptr;
@@ -203,31 +269,91 @@ private:
     QPushButton *theme_button_ = nullptr;
 
     // Virtual keyboard
-    QWidget *keyboard_widget_ = nullptr;
+    QWidget *keyboard_widget_ = nullptr;    // container shown/hidden by settings
+    QWidget *keyboard_board_ = nullptr;     // active renderer inside the container
+    PaintedKeyboard *painted_keyboard_ = nullptr;
     QMap<QString, QLabel*> key_labels_;
+    // Keys currently drawn in a non-normal state; everything else is kNormal
+    QHash<QLabel*, KeyState> key_states_;
+    // Last highlight request, replayed when the renderer is switched
+    KeyHighlightList highlights_;
 
-    // UI Widgets - Settings Page
+    // Prompt text and keyboard highlights of one catalog item, built once so
+    // showing a prompt is a lookup. Sequences have one entry per step.
+    struct PromptView {
+        QVector<QString> texts;
+        QVector<KeyHighlightList> highlights;
+    };
+    QVector<PromptView> prompt_views_;      // by engine item id
+    PromptView BuildPromptView(const TrainingItem &item) const;
+    QLabel *lookahead_label_ = nullptr;     // upcoming prompts under the target
+    QLabel *profile_overlay_ = nullptr;     // per-stage p50/p99, LHT_PROFILE builds
+    QTimer *profile_timer_ = nullptr;
+    int look_ahead_ = 2;                    // prompts previewed, 0 to kPrefetchDepth
+
+    // UI Widgets - Settings Page, built on first visit
     QWidget *settings_page_ = nullptr;
     QComboBox *difficulty_combo_ = nullptr;
+    QComboBox *drill_pack_combo_ = nullptr;
+    QLabel *drill_pack_label_ = nullptr;
     QComboBox *mode_combo_ = nullptr;
     QSpinBox *time_spin_ = nullptr;
     QSpinBox *rounds_spin_ = nullptr;
+    QSpinBox *gap_budget_spin_ = nullptr;
     QCheckBox *sound_check_ = nullptr;
+    QLabel *sound_latency_label_ = nullptr;
     QCheckBox *keyboard_check_ = nullptr;
+    QCheckBox *heatmap_check_ = nullptr;
+    QCheckBox *raw_input_check_ = nullptr;
+    QLabel *raw_input_label_ = nullptr;
+    QComboBox *keyboard_renderer_combo_ = nullptr;
+    QSpinBox *look_ahead_spin_ = nullptr;
+    QPushButton *calibrate_button_ = nullptr;
+    QLabel *latency_offset_label_ = nullptr;
+    QLabel *profile_trace_label_ = nullptr;
     QCheckBox *custom_single_check_ = nullptr;
     QCheckBox *custom_special_check_ = nullptr;
     QCheckBox *custom_combo_check_ = nullptr;
     QCheckBox *custom_sequence_check_ = nullptr;
     QWidget *custom_options_widget_ = nullptr;
 
-    // UI Widgets - History Page
+    // UI Widgets - History Page, built on first visit
     QWidget *history_page_ = nullptr;
-    QLabel *history_list_label_ = nullptr;
+    QListView *history_view_ = nullptr;
+    HistoryListModel *history_model_ = nullptr;
+    QLabel *history_empty_label_ = nullptr;
     QLabel *best_speed_label_ = nullptr;
     QLabel *best_accuracy_label_ = nullptr;
     QLabel *total_sessions_label_ = nullptr;
+    QLabel *rolling_speed_label_ = nullptr;
+    QLabel *rolling_accuracy_label_ = nullptr;
+    QLabel *total_practice_label_ = nullptr;
+    QLabel *difficulty_totals_label_ = nullptr;
+    QLabel *transitions_label_ = nullptr;
+    QComboBox *progress_metric_combo_ = nullptr;
+    QComboBox *progress_period_combo_ = nullptr;
+    ProgressChart *progress_chart_ = nullptr;
+    QLabel *progress_change_label_ = nullptr;
+
+    // LAN race
+    RaceSession *race_ = nullptr;
+    bool racing_ = false;                   // from the race start until StopTraining
+    TrainingConfig race_restore_config_;    // config_ before the race
+    RaceProtocol::RaceSettings race_settings_;
+    QTimer *race_countdown_timer_ = nullptr;
+    qint64 race_start_ns_ = 0;              // ReactionClock time of the first prompt
+    QString race_name_;
+    QString race_host_;
+    QString race_error_;
+    QLabel *race_label_ = nullptr;          // standings on the training page
+    QLineEdit *race_name_edit_ = nullptr;
+    QLineEdit *race_host_edit_ = nullptr;
+    QPushButton *race_host_button_ = nullptr;
+    QPushButton *race_join_button_ = nullptr;
+    QPushButton *race_leave_button_ = nullptr;
+    QPushButton *race_start_button_ = nullptr;
+    QLabel *race_status_label_ = nullptr;
 
-    // Sound effects
-    QSoundEffect *correct_sound_ = nullptr;
-    QSoundEffect *wrong_sound_ = nullptr;
+    // Sound feedback, off the GUI thread
+    SoundEngine *sound_ = nullptr;
 };
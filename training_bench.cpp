@@ -0,0 +1,448 @@
+// Headless benchmark of the training hot path: item selection, key matching,
+// scoring and history persistence, driven by synthetic and recorded key
+// streams. Reports ns and heap allocations per keystroke.
+//
+//   TrainingBench [--keys N] [--runs N] [--log DIR] [--trace FILE]...
+
+#include <QByteArray>
+#include <QFileInfo>
+#include <QString>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QVector>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "keyboard_layout.h"
+#include "reaction_timing.h"
+#include "session_log.h"
+#include "text_fields.h"
+#include "training_engine.h"
+
+// ===== Allocation counting =====
+
+namespace {
+
+std::atomic<quint64> g_allocations{0};
+// Results are written here so the optimizer cannot drop the measured work
+volatile qint64 g_sink = 0;
+
+}  // namespace
+
+#if defined(__GLIBC__)
+// Qt containers allocate with malloc directly, so count at that level;
+// operator new ends up here too.
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+void *calloc(size_t count, size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+void *realloc(void *ptr, size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+}
+#else
+// Elsewhere only C++ allocations are visible; Qt container growth is missed
+void *operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+#endif
+
+namespace {
+
+// ===== Key streams =====
+
+struct BenchKey {
+    int key = 0;
+    Qt::KeyboardModifiers modifiers = Qt::NoModifier;
+};
+
+// Deterministic xorshift, so every run sees the same stream
+class StreamRng {
+public:
+    explicit StreamRng(quint32 seed) : state_(seed ? seed : 1) {}
+    quint32 Next() {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 17;
+        state_ ^= state_ << 5;
+        return state_;
+    }
+
+private:
+    quint32 state_;
+};
+
+// A player who answers the engine's current prompt, missing about one in
+// twenty. Costs a few integer operations per key.
+class SyntheticPlayer {
+public:
+    explicit SyntheticPlayer(quint32 seed) : rng_(seed) {}
+
+    BenchKey Press(const TrainingEngine &engine) {
+        BenchKey press;
+        if (rng_.Next() % 20 == 0) {
+            press.key = Qt::Key_P;      // right-hand key, never a prompt
+            return press;
+        }
+        const KeyStep &step = engine.Matcher().Expected();
+        press.key = step.key;
+        press.modifiers = Qt::KeyboardModifiers(static_cast<int>(step.modifiers));
+        return press;
+    }
+
+private:
+    StreamRng rng_;
+};
+
+QVector<BenchKey> LoadRecordedKeys(const QString &directory) {
+    QVector<BenchKey> keys;
+    if (!QFileInfo(directory).isDir()) {
+        return keys;
+    }
+    SessionLog log(directory);
+    if (!log.Open()) {
+        return keys;
+    }
+    keys.reserve(static_cast<int>(qMin<qint64>(log.KeystrokeCount(), 1 << 22)));
+    for (qint64 i = 0; i < log.KeystrokeCount() && keys.size() < (1 << 22); ++i) {
+        const KeystrokeLogRecord record = log.Keystroke(i);
+        BenchKey key;
+        key.key = record.key;
+        key.modifiers = Qt::KeyboardModifiers(static_cast<int>(record.modifiers));
+        keys.append(key);
+    }
+    return keys;
+}
+
+// ===== Harness =====
+
+struct Measurement {
+    qint64 elapsed_ns = 0;
+    quint64 allocations = 0;
+    qint64 operations = 0;
+};
+
+struct CaseResult {
+    const char *name = "";
+    double ns_per_op = 0.0;
+    double allocations_per_op = 0.0;
+    qint64 operations = 0;
+};
+
+template <typename Body>
+CaseResult RunCase(const char *name, int runs, Body body) {
+    // One untimed pass warms caches and lets containers reach steady size
+    body();
+
+    QVector<Measurement> measurements;
+    for (int r = 0; r < runs; ++r) {
+        const quint64 allocations_before = g_allocations.load(std::memory_order_relaxed);
+        const qint64 start_ns = ReactionClock::NowNs();
+        Measurement m;
+        m.operations = body();
+        m.elapsed_ns = ReactionClock::NowNs() - start_ns;
+        m.allocations = g_allocations.load(std::memory_order_relaxed) - allocations_before;
+        measurements.append(m);
+    }
+
+    // Median run by time; allocations are the same every run
+    std::sort(measurements.begin(), measurements.end(),
+              [](const Measurement &a, const Measurement &b) {
+                  return a.elapsed_ns < b.elapsed_ns;
+              });
+    const Measurement &m = measurements.at(measurements.size() / 2);
+
+    CaseResult result;
+    result.name = name;
+    result.operations = m.operations;
+    if (m.operations > 0) {
+        result.ns_per_op = static_cast<double>(m.elapsed_ns) / m.operations;
+        result.allocations_per_op = static_cast<double>(m.allocations) / m.operations;
+    }
+    return result;
+}
+
+void PrintResult(const CaseResult &result) {
+    std::printf("%-28s %12.1f ns/key %10.3f allocs/key %12lld keys\n",
+                result.name, result.ns_per_op, result.allocations_per_op,
+                static_cast<long long>(result.operations));
+}
+
+TrainingConfig AdvancedConfig() {
+    TrainingConfig config;
+    config.difficulty = Difficulty::kAdvanced;
+    config.mode = TrainingMode::kEndless;
+    return config;
+}
+
+// The kind of highlight request RenderKeyboard makes for each prompt
+KeyHighlightList ResolveItemHighlights(const TrainingEngine &engine) {
+    const TrainingItem &item = engine.CurrentItem();
+    switch (item.type) {
+        case TrainingType::kSequence:
+            return KeyboardLayout::ResolveHighlights(
+                QString(QChar(engine.Matcher().Expected().key)), Qt::NoModifier);
+        case TrainingType::kCombo:
+            return KeyboardLayout::ResolveHighlights(
+                QString(QChar(item.key)), item.Modifiers());
+        default:
+            return KeyboardLayout::ResolveHighlights(QString::fromLatin1(item.label),
+                                                     Qt::NoModifier);
+    }
+}
+
+constexpr qint64 kKeyIntervalNs = 150000;     // 150 us between keys
+constexpr quint32 kBenchSeed = 1234;
+
+void StartSession(TrainingEngine &engine) {
+    engine.Start(0, kBenchSeed);
+    engine.NextItem();
+    engine.ShowPrompt(0);
+}
+
+// Drives the engine the way TrainerWindow does: feed, advance on complete
+void FeedKey(TrainingEngine &engine, const BenchKey &press, qint64 key_ns) {
+    const KeyResult result = engine.Feed(press.key, press.modifiers, key_ns);
+    if (result.outcome == KeyMatcher::Outcome::kComplete) {
+        engine.NextItem();
+        engine.ShowPrompt(key_ns);
+    }
+}
+
+// Fills the numbers of the stats and rolling lines, as UpdateStatsLabel and
+// UpdateRollingLabel do after each key
+void FormatStats(const TrainingEngine &engine, qint64 now_ns, TextFields &stats,
+                 TextFields &rolling) {
+    const int rounds_total = engine.RoundsTotal();
+    const int rounds_correct = engine.RoundsCorrect();
+    const double seconds = qMax(1e-3, static_cast<double>(engine.ElapsedNs(now_ns)) / 1e9);
+    stats.SetInt(0, rounds_correct);
+    stats.SetInt(1, rounds_total);
+    stats.SetFixed(2, rounds_total > 0 ? 100.0 * rounds_correct / rounds_total : 0.0, 1);
+    stats.SetFixed(3, 60.0 * rounds_total / seconds, 1);
+
+    const RollingMetrics &metrics = engine.Rolling();
+    for (int w = 0; w < RollingMetrics::kWindowCount; ++w) {
+        const RollingWindow window = metrics.Window(w);
+        rolling.SetFixed(w, window.KeysPerMinute(), 0);
+        rolling.SetFixed(RollingMetrics::kWindowCount + w, window.Accuracy(), 0);
+        if (window.median_reaction_ns > 0) {
+            rolling.SetInt(2 * RollingMetrics::kWindowCount + w,
+                           window.median_reaction_ns / 1000000);
+        } else {
+            rolling.SetPlaceholder(2 * RollingMetrics::kWindowCount + w);
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    int key_count = 200000;
+    int runs = 5;
+    QString log_directory = SessionLog::DefaultDirectory();
+    QStringList trace_paths;
+    for (int i = 1; i < argc; ++i) {
+        const QByteArray arg(argv[i]);
+        if (arg == "--keys" && i + 1 < argc) {
+            key_count = qMax(1, std::atoi(argv[++i]));
+        } else if (arg == "--runs" && i + 1 < argc) {
+            runs = qMax(1, std::atoi(argv[++i]));
+        } else if (arg == "--log" && i + 1 < argc) {
+            log_directory = QString::fromLocal8Bit(argv[++i]);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_paths.append(QString::fromLocal8Bit(argv[++i]));
+        } else {
+            std::fprintf(stderr, "usage: %s [--keys N] [--runs N] [--log DIR] [--trace FILE]...\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+
+    const QVector<BenchKey> recorded = LoadRecordedKeys(log_directory);
+    QVector<KeyTrace> traces;
+    for (const QString &path : trace_paths) {
+        KeyTrace trace;
+        if (!trace.Load(path)) {
+            std::fprintf(stderr, "cannot read trace %s\n", qPrintable(path));
+            return 1;
+        }
+        traces.append(trace);
+    }
+
+    std::printf("keys: %d synthetic, %d recorded; %d runs (median)\n\n",
+                key_count, static_cast<int>(recorded.size()), runs);
+
+    TrainingEngine engine;
+    engine.SetConfig(AdvancedConfig());
+
+    // Item selection alone: scheduler draw + matcher load per prompt
+    PrintResult(RunCase("select", runs, [&]() {
+        engine.Start(0, kBenchSeed);
+        for (int i = 0; i < key_count; ++i) {
+            engine.NextItem();
+            engine.ShowPrompt(i);
+        }
+        return static_cast<qint64>(key_count);
+    }));
+
+    // Matching alone, against one preloaded sequence prompt
+    PrintResult(RunCase("match", runs, [&]() {
+        KeyMatcher matcher;
+        TrainingItem item = {TrainingType::kSequence, "QWER", "qwer", 0, 0,
+                             Difficulty::kAdvanced};
+        matcher.Load(item);
+        static const int kKeys[] = {Qt::Key_Q, Qt::Key_W, Qt::Key_E, Qt::Key_R};
+        int completes = 0;
+        for (int i = 0; i < key_count; ++i) {
+            if (matcher.Feed(kKeys[i % 4], Qt::NoModifier) == KeyMatcher::Outcome::kComplete) {
+                ++completes;
+            }
+        }
+        g_sink = completes;
+        return static_cast<qint64>(key_count);
+    }));
+
+    // Full engine path: matching, scoring, reaction stats, keystroke log
+    PrintResult(RunCase("engine/synthetic", runs, [&]() {
+        SyntheticPlayer player(1234);
+        StartSession(engine);
+        for (int i = 0; i < key_count; ++i) {
+            FeedKey(engine, player.Press(engine), (i + 1) * kKeyIntervalNs);
+        }
+        g_sink = engine.RoundsCorrect();
+        return static_cast<qint64>(key_count);
+    }));
+
+    // Real key streams from the history log, fed against fresh prompts
+    if (!recorded.isEmpty()) {
+        PrintResult(RunCase("engine/recorded", runs, [&]() {
+            StartSession(engine);
+            for (int i = 0; i < recorded.size(); ++i) {
+                FeedKey(engine, recorded.at(i), (i + 1) * kKeyIntervalNs);
+            }
+            g_sink = engine.RoundsCorrect();
+            return static_cast<qint64>(recorded.size());
+        }));
+    }
+
+    // Recorded sessions replayed exactly, as a corpus of real players
+    if (!traces.isEmpty()) {
+        int mismatches = 0;
+        int skipped = 0;
+        int bad_states = 0;
+        PrintResult(RunCase("engine/replay", runs, [&]() {
+            TrainingEngine replay_engine;
+            qint64 keys = 0;
+            mismatches = 0;
+            skipped = 0;
+            bad_states = 0;
+            for (const KeyTrace &trace : traces) {
+                const ReplayResult result = replay_engine.Replay(trace);
+                keys += result.keys;
+                mismatches += result.item_mismatches;
+                skipped += result.pack_mismatch ? 1 : 0;
+                bad_states += result.state_mismatch ? 1 : 0;
+            }
+            return keys;
+        }));
+        if (mismatches > 0) {
+            std::printf("%-28s %d prompts differ from the recording\n", "", mismatches);
+        }
+        if (skipped > 0) {
+            std::printf("%-28s %d traces need a drill pack and were skipped\n", "", skipped);
+        }
+        if (bad_states > 0) {
+            std::printf("%-28s %d traces have a bad scheduler state and were skipped\n", "",
+                        bad_states);
+        }
+    }
+
+    // Keyboard highlight resolution per prompt, as the view does it
+    PrintResult(RunCase("highlights", runs, [&]() {
+        engine.Start(0, kBenchSeed);
+        int lit = 0;
+        for (int i = 0; i < key_count; ++i) {
+            engine.NextItem();
+            engine.ShowPrompt(i);
+            lit += ResolveItemHighlights(engine).size();
+        }
+        g_sink = lit;
+        return static_cast<qint64>(key_count);
+    }));
+
+    // Engine plus the per-key stats text; compare with engine/synthetic
+    PrintResult(RunCase("engine+format", runs, [&]() {
+        SyntheticPlayer player(1234);
+        TextFields stats;
+        stats.Resize(4);
+        TextFields rolling;
+        rolling.Resize(3 * RollingMetrics::kWindowCount);
+        StartSession(engine);
+        int length = 0;
+        for (int i = 0; i < key_count; ++i) {
+            const qint64 key_ns = (i + 1) * kKeyIntervalNs;
+            FeedKey(engine, player.Press(engine), key_ns);
+            FormatStats(engine, key_ns, stats, rolling);
+            length += stats.Length(3) + rolling.Length(0);
+        }
+        g_sink = length;
+        return static_cast<qint64>(key_count);
+    }));
+
+    // Engine plus history persistence: a session record per 200 keystrokes
+    QTemporaryDir temp_dir;
+    if (temp_dir.isValid()) {
+        SessionLog log(temp_dir.path());
+        if (log.Open()) {
+            PrintResult(RunCase("engine+persist", runs, [&]() {
+                constexpr int kSessionKeys = 200;
+                SyntheticPlayer player(1234);
+                StartSession(engine);
+                for (int i = 0; i < key_count; ++i) {
+                    const qint64 key_ns = (i + 1) * kKeyIntervalNs;
+                    FeedKey(engine, player.Press(engine), key_ns);
+                    if ((i + 1) % kSessionKeys == 0) {
+                        SessionLogRecord record;
+                        record.duration_us = engine.ElapsedNs(key_ns) / 1000;
+                        record.total_rounds = engine.RoundsTotal();
+                        record.correct_rounds = engine.RoundsCorrect();
+                        log.AppendSession(record, engine.Keystrokes());
+                        engine.ClearKeystrokes();
+                    }
+                }
+                return static_cast<qint64>(key_count);
+            }));
+        }
+    }
+
+    return 0;
+}
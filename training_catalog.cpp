@@ -0,0 +1,237 @@
+#include "training_catalog.h"
+
+#include <QtAlgorithms>
+
+namespace TrainingCatalog {
+
+namespace {
+
+constexpr TrainingItem SingleKey(const char *label, const char *key, Difficulty diff) {
+    return {TrainingType::kSingleKey, label, key, 0, Qt::NoModifier, diff};
+}
+
+constexpr TrainingItem Sequence(const char *label, const char *seq, Difficulty diff) {
+    return {TrainingType::kSequence, label, seq, 0, Qt::NoModifier, diff};
+}
+
+constexpr TrainingItem Combo(Qt::KeyboardModifier mod, int key, const char *label,
+                             Difficulty diff) {
+    return {TrainingType::kCombo, label, "", key, mod, diff};
+}
+
+constexpr TrainingItem SpecialKey(int key, const char *label, Difficulty diff) {
+    return {TrainingType::kSpecialKey, label, "", key, Qt::NoModifier, diff};
+}
+
+// Item ids are positions in this table and are stored in the keystroke log,
+// so new items only ever go at the end
+constexpr TrainingItem kItems[] = {
+    // ===== 1. Single Keys =====
+    SingleKey("1", "1", Difficulty::kBeginner),
+    SingleKey("2", "2", Difficulty::kBeginner),
+    SingleKey("3", "3", Difficulty::kBeginner),
+    SingleKey("4", "4", Difficulty::kBeginner),
+    SingleKey("5", "5", Difficulty::kBeginner),
+    SingleKey("Q", "q", Difficulty::kBeginner),
+    SingleKey("W", "w", Difficulty::kBeginner),
+    SingleKey("E", "e", Difficulty::kBeginner),
+    SingleKey("R", "r", Difficulty::kBeginner),
+    SingleKey("T", "t", Difficulty::kBeginner),
+    SingleKey("A", "a", Difficulty::kBeginner),
+    SingleKey("S", "s", Difficulty::kBeginner),
+    SingleKey("D", "d", Difficulty::kBeginner),
+    SingleKey("F", "f", Difficulty::kBeginner),
+    SingleKey("G", "g", Difficulty::kBeginner),
+    SingleKey("Z", "z", Difficulty::kBeginner),
+    SingleKey("X", "x", Difficulty::kBeginner),
+    SingleKey("C", "c", Difficulty::kBeginner),
+    SingleKey("V", "v", Difficulty::kBeginner),
+    SingleKey("B", "b", Difficulty::kBeginner),
+    // Additional single keys
+    SingleKey("6", "6", Difficulty::kIntermediate),
+    SingleKey("7", "7", Difficulty::kIntermediate),
+    SingleKey("Y", "y", Difficulty::kIntermediate),
+    SingleKey("H", "h", Difficulty::kIntermediate),
+    SingleKey("U", "u", Difficulty::kIntermediate),
+    SingleKey("N", "n", Difficulty::kIntermediate),
+
+    // ===== 2. Special Keys =====
+    SpecialKey(Qt::Key_Space, "Space", Difficulty::kBeginner),
+    SpecialKey(Qt::Key_Tab, "Tab", Difficulty::kIntermediate),
+    SpecialKey(Qt::Key_CapsLock, "Caps", Difficulty::kIntermediate),
+    // F keys
+    SpecialKey(Qt::Key_F1, "F1", Difficulty::kIntermediate),
+    SpecialKey(Qt::Key_F2, "F2", Difficulty::kIntermediate),
+    SpecialKey(Qt::Key_F3, "F3", Difficulty::kIntermediate),
+    SpecialKey(Qt::Key_F4, "F4", Difficulty::kIntermediate),
+    SpecialKey(Qt::Key_F5, "F5", Difficulty::kAdvanced),
+    SpecialKey(Qt::Key_F6, "F6", Difficulty::kAdvanced),
+    SpecialKey(Qt::Key_F7, "F7", Difficulty::kAdvanced),
+    SpecialKey(Qt::Key_F8, "F8", Difficulty::kAdvanced),
+
+    // ===== 3. Ctrl Combos (Control Groups) =====
+    Combo(Qt::ControlModifier, Qt::Key_1, "Ctrl+1", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_2, "Ctrl+2", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_3, "Ctrl+3", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_4, "Ctrl+4", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_5, "Ctrl+5", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_6, "Ctrl+6", Difficulty::kAdvanced),
+    Combo(Qt::ControlModifier, Qt::Key_7, "Ctrl+7", Difficulty::kAdvanced),
+    Combo(Qt::ControlModifier, Qt::Key_8, "Ctrl+8", Difficulty::kAdvanced),
+    Combo(Qt::ControlModifier, Qt::Key_9, "Ctrl+9", Difficulty::kAdvanced),
+    Combo(Qt::ControlModifier, Qt::Key_0, "Ctrl+0", Difficulty::kAdvanced),
+
+    // ===== 4. Shift Combos (Add to Group) =====
+    Combo(Qt::ShiftModifier, Qt::Key_Exclam, "Shift+1", Difficulty::kIntermediate),
+    Combo(Qt::ShiftModifier, Qt::Key_At, "Shift+2", Difficulty::kIntermediate),
+    Combo(Qt::ShiftModifier, Qt::Key_NumberSign, "Shift+3", Difficulty::kIntermediate),
+    Combo(Qt::ShiftModifier, Qt::Key_Dollar, "Shift+4", Difficulty::kIntermediate),
+    Combo(Qt::ShiftModifier, Qt::Key_Percent, "Shift+5", Difficulty::kIntermediate),
+
+    // Common Ctrl letter combos
+    Combo(Qt::ControlModifier, Qt::Key_Q, "Ctrl+Q", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_W, "Ctrl+W", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_E, "Ctrl+E", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_R, "Ctrl+R", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_A, "Ctrl+A", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_S, "Ctrl+S", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_D, "Ctrl+D", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_F, "Ctrl+F", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_Z, "Ctrl+Z", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_X, "Ctrl+X", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_C, "Ctrl+C", Difficulty::kIntermediate),
+    Combo(Qt::ControlModifier, Qt::Key_V, "Ctrl+V", Difficulty::kIntermediate),
+
+    // Common Shift letter combos
+    Combo(Qt::ShiftModifier, Qt::Key_Q, "Shift+Q", Difficulty::kAdvanced),
+    Combo(Qt::ShiftModifier, Qt::Key_W, "Shift+W", Difficulty::kAdvanced),
+    Combo(Qt::ShiftModifier, Qt::Key_E, "Shift+E", Difficulty::kAdvanced),
+    Combo(Qt::ShiftModifier, Qt::Key_R, "Shift+R", Difficulty::kAdvanced),
+    Combo(Qt::ShiftModifier, Qt::Key_A, "Shift+A", Difficulty::kAdvanced),
+    Combo(Qt::ShiftModifier, Qt::Key_S, "Shift+S", Difficulty::kAdvanced),
+
+    // Alt combos
+    Combo(Qt::AltModifier, Qt::Key_F1, "Alt+F1", Difficulty::kAdvanced),
+    Combo(Qt::AltModifier, Qt::Key_F2, "Alt+F2", Difficulty::kAdvanced),
+    Combo(Qt::AltModifier, Qt::Key_F3, "Alt+F3", Difficulty::kAdvanced),
+    Combo(Qt::AltModifier, Qt::Key_F4, "Alt+F4", Difficulty::kAdvanced),
+
+    // ===== 5. Sequences =====
+    Sequence("1A", "1a", Difficulty::kIntermediate),
+    Sequence("2A", "2a", Difficulty::kIntermediate),
+    Sequence("3A", "3a", Difficulty::kIntermediate),
+    Sequence("1S", "1s", Difficulty::kIntermediate),
+    Sequence("2S", "2s", Difficulty::kIntermediate),
+    Sequence("3S", "3s", Difficulty::kIntermediate),
+    Sequence("1D", "1d", Difficulty::kIntermediate),
+    Sequence("2D", "2d", Difficulty::kIntermediate),
+    Sequence("3D", "3d", Difficulty::kIntermediate),
+    Sequence("1Q", "1q", Difficulty::kIntermediate),
+    Sequence("2Q", "2q", Difficulty::kIntermediate),
+    Sequence("3Q", "3q", Difficulty::kIntermediate),
+    Sequence("1AA", "1aa", Difficulty::kAdvanced),
+    Sequence("2AA", "2aa", Difficulty::kAdvanced),
+    Sequence("3AA", "3aa", Difficulty::kAdvanced),
+    Sequence("1SS", "1ss", Difficulty::kAdvanced),
+    Sequence("2SS", "2ss", Difficulty::kAdvanced),
+    Sequence("3SS", "3ss", Difficulty::kAdvanced),
+    Sequence("1QQQQ", "1qqqq", Difficulty::kAdvanced),
+    Sequence("2WW", "2ww", Difficulty::kAdvanced),
+    Sequence("3EE", "3ee", Difficulty::kAdvanced),
+    Sequence("QWER", "qwer", Difficulty::kAdvanced),
+    Sequence("ASDF", "asdf", Difficulty::kAdvanced),
+    Sequence("ZXCV", "zxcv", Difficulty::kAdvanced),
+    Sequence("WASD", "wasd", Difficulty::kAdvanced),
+    Sequence("1A2A", "1a2a", Difficulty::kAdvanced),
+    Sequence("1S2S", "1s2s", Difficulty::kAdvanced),
+    Sequence("4SD", "4sd", Difficulty::kAdvanced),
+    Sequence("5VV", "5vv", Difficulty::kAdvanced),
+    Sequence("1A2A3A", "1a2a3a", Difficulty::kAdvanced),
+    Sequence("QQQQ", "qqqq", Difficulty::kAdvanced),
+    Sequence("AAAA", "aaaa", Difficulty::kAdvanced),
+    Sequence("SSSS", "ssss", Difficulty::kAdvanced),
+    Sequence("1234", "1234", Difficulty::kAdvanced),
+    Sequence("5432", "5432", Difficulty::kAdvanced),
+    Sequence("QWERT", "qwert", Difficulty::kAdvanced),
+    Sequence("ASDFG", "asdfg", Difficulty::kAdvanced),
+    Sequence("ZXCVB", "zxcvb", Difficulty::kAdvanced),
+};
+static_assert(sizeof(kItems) / sizeof(kItems[0]) == kItemCount,
+              "kItemCount must match the catalog table");
+
+constexpr ItemMask BuildDifficultyMask(Difficulty difficulty) {
+    ItemMask mask;
+    for (int id = 0; id < kItemCount; ++id) {
+        const Difficulty min = kItems[id].min_difficulty;
+        bool include = false;
+        switch (difficulty) {
+            case Difficulty::kBeginner:
+                include = (min == Difficulty::kBeginner);
+                break;
+            case Difficulty::kIntermediate:
+                include = (min == Difficulty::kBeginner || min == Difficulty::kIntermediate);
+                break;
+            case Difficulty::kAdvanced:
+            case Difficulty::kCustom:
+                include = true;
+                break;
+        }
+        if (include) mask.Set(id);
+    }
+    return mask;
+}
+
+constexpr ItemMask BuildTypeMask(TrainingType type) {
+    ItemMask mask;
+    for (int id = 0; id < kItemCount; ++id) {
+        if (kItems[id].type == type) mask.Set(id);
+    }
+    return mask;
+}
+
+// Indexed by Difficulty and TrainingType
+constexpr ItemMask kDifficultyMasks[] = {
+    BuildDifficultyMask(Difficulty::kBeginner),
+    BuildDifficultyMask(Difficulty::kIntermediate),
+    BuildDifficultyMask(Difficulty::kAdvanced),
+    BuildDifficultyMask(Difficulty::kCustom),
+};
+constexpr ItemMask kTypeMasks[] = {
+    BuildTypeMask(TrainingType::kSingleKey),
+    BuildTypeMask(TrainingType::kCombo),
+    BuildTypeMask(TrainingType::kSequence),
+    BuildTypeMask(TrainingType::kSpecialKey),
+};
+
+}  // namespace
+
+int ItemMask::Count() const {
+    int count = 0;
+    for (quint64 word : words_) {
+        count += static_cast<int>(qPopulationCount(word));
+    }
+    return count;
+}
+
+const TrainingItem &At(int id) {
+    Q_ASSERT(id >= 0 && id < kItemCount);
+    return kItems[id];
+}
+
+ItemMask ForDifficulty(Difficulty difficulty) {
+    const int index = static_cast<int>(difficulty);
+    if (index < 0 || index >= static_cast<int>(sizeof(kDifficultyMasks) / sizeof(kDifficultyMasks[0]))) {
+        return ItemMask();
+    }
+    return kDifficultyMasks[index];
+}
+
+ItemMask ForType(TrainingType type) {
+    const int index = static_cast<int>(type);
+    if (index < 0 || index >= static_cast<int>(sizeof(kTypeMasks) / sizeof(kTypeMasks[0]))) {
+        return ItemMask();
+    }
+    return kTypeMasks[index];
+}
+
+}  // namespace TrainingCatalog
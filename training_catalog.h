@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Qt>
+#include <QtGlobal>
+
+// Training difficulty levels
+enum class Difficulty {
+    kBeginner,      // Only single keys
+    kIntermediate,  // Single keys + special keys + simple combos
+    kAdvanced,      // All items including sequences
+    kCustom         // User-selected types
+};
+
+// One training unit:
+// - kSingleKey: single key like "q", "1"
+// - kCombo: with modifiers, e.g. Ctrl+1, Shift+Q, Alt+F4
+// - kSequence: string combo, e.g. "1a", "qwer"
+// - kSpecialKey: special key (Space, Tab, F1~F8)
+enum class TrainingType {
+    kSingleKey,
+    kCombo,
+    kSequence,
+    kSpecialKey
+};
+
+// Literal type so the built-in catalog is a constexpr table: no per-item
+// allocation at startup and nothing copied when filtering
+struct TrainingItem {
+    TrainingType type;
+    const char *label;      // UI text, e.g. "Q", "Ctrl+1", "QWER"
+    const char *sequence;   // single/sequence lowercase keys, e.g. "q", "qwer"; "" otherwise
+    int key;                // for combo/special: Qt::Key_*
+    int modifiers;          // for combo: Qt::KeyboardModifiers
+    Difficulty min_difficulty;
+
+    Qt::KeyboardModifiers Modifiers() const {
+        return Qt::KeyboardModifiers(modifiers);
+    }
+    int SequenceLength() const { return static_cast<int>(qstrlen(sequence)); }
+};
+
+namespace TrainingCatalog {
+
+constexpr int kItemCount = 112;
+
+// One bit per catalog item
+class ItemMask {
+public:
+    constexpr void Set(int id) { words_[id / 64] |= quint64(1) << (id % 64); }
+    constexpr bool Test(int id) const { return (words_[id / 64] >> (id % 64)) & 1; }
+    constexpr bool IsEmpty() const {
+        for (quint64 word : words_) {
+            if (word) return false;
+        }
+        return true;
+    }
+    int Count() const;
+
+    constexpr ItemMask &operator|=(const ItemMask &other) {
+        for (int i = 0; i < kWords; ++i) words_[i] |= other.words_[i];
+        return *this;
+    }
+    constexpr ItemMask &operator&=(const ItemMask &other) {
+        for (int i = 0; i < kWords; ++i) words_[i] &= other.words_[i];
+        return *this;
+    }
+
+    static constexpr ItemMask All() {
+        ItemMask mask;
+        for (int id = 0; id < kItemCount; ++id) mask.Set(id);
+        return mask;
+    }
+
+private:
+    static constexpr int kWords = (kItemCount + 63) / 64;
+    quint64 words_[kWords] = {};
+};
+
+const TrainingItem &At(int id);
+
+// Items offered at a fixed difficulty (not kCustom); empty for values
+// outside the enum
+ItemMask ForDifficulty(Difficulty difficulty);
+// Items of one type, used for the custom selection; empty outside the enum
+ItemMask ForType(TrainingType type);
+
+}  // namespace TrainingCatalog
@@ -0,0 +1,441 @@
+#include "training_engine.h"
+
+namespace {
+
+// Same rule as the built-in catalog's difficulty masks
+bool OfferedAt(Difficulty difficulty, Difficulty min_difficulty) {
+    switch (difficulty) {
+        case Difficulty::kBeginner:
+            return min_difficulty == Difficulty::kBeginner;
+        case Difficulty::kIntermediate:
+            return min_difficulty != Difficulty::kAdvanced;
+        case Difficulty::kAdvanced:
+        case Difficulty::kCustom:
+            break;
+    }
+    return true;
+}
+
+}  // namespace
+
+void TrainingEngine::SetConfig(const TrainingConfig &config) {
+    config_ = config;
+
+    if (drill_pack_) {
+        SelectPackItems();
+        return;
+    }
+
+    TrainingCatalog::ItemMask mask;
+    if (config_.difficulty == Difficulty::kCustom) {
+        if (config_.custom_single_keys) mask |= TrainingCatalog::ForType(TrainingType::kSingleKey);
+        if (config_.custom_special_keys) mask |= TrainingCatalog::ForType(TrainingType::kSpecialKey);
+        if (config_.custom_combos) mask |= TrainingCatalog::ForType(TrainingType::kCombo);
+        if (config_.custom_sequences) mask |= TrainingCatalog::ForType(TrainingType::kSequence);
+    } else {
+        mask = TrainingCatalog::ForDifficulty(config_.difficulty);
+    }
+
+    // Ensure at least some items
+    if (mask.IsEmpty()) {
+        mask = TrainingCatalog::ItemMask::All();
+    }
+
+    item_ids_.clear();
+    item_weights_.clear();
+    item_ids_.reserve(mask.Count());
+    for (int id = 0; id < TrainingCatalog::kItemCount; ++id) {
+        if (mask.Test(id)) {
+            item_ids_.append(id);
+        }
+    }
+
+    scheduler_.SetAdaptive(config_.adaptive);
+    scheduler_.SetPool(item_ids_);
+    current_index_ = -1;
+    queue_size_ = 0;
+    item_answered_ = false;
+}
+
+void TrainingEngine::SelectPackItems() {
+    const auto type_selected = [this](TrainingType type) {
+        switch (type) {
+            case TrainingType::kSingleKey: return config_.custom_single_keys;
+            case TrainingType::kSpecialKey: return config_.custom_special_keys;
+            case TrainingType::kCombo: return config_.custom_combos;
+            case TrainingType::kSequence: return config_.custom_sequences;
+        }
+        return false;
+    };
+
+    item_ids_.clear();
+    item_weights_.clear();
+    for (int pass = 0; pass < 2 && item_ids_.isEmpty(); ++pass) {
+        for (int i = 0; i < drill_pack_->ItemCount(); ++i) {
+            const TrainingItem &item = drill_pack_->Item(i);
+            // Second pass: nothing at this difficulty, offer the whole pack
+            const bool wanted = pass > 0 ||
+                                (config_.difficulty == Difficulty::kCustom
+                                     ? type_selected(item.type)
+                                     : OfferedAt(config_.difficulty, item.min_difficulty));
+            if (wanted) {
+                item_ids_.append(kPackItemBase + i);
+                item_weights_.append(drill_pack_->Weight(i));
+            }
+        }
+    }
+
+    scheduler_.SetAdaptive(config_.adaptive);
+    scheduler_.SetPool(item_ids_, item_weights_);
+    current_index_ = -1;
+    queue_size_ = 0;
+    item_answered_ = false;
+}
+
+void TrainingEngine::SetDrillPack(const DrillPack *pack) {
+    if (running_) return;
+    drill_pack_ = (pack && pack->IsOpen() && pack->ItemCount() > 0) ? pack : nullptr;
+    scheduler_.ForgetItems(kPackItemBase);
+    SetConfig(config_);
+}
+
+const TrainingItem &TrainingEngine::Item(int id) const {
+    if (drill_pack_ && id >= kPackItemBase) {
+        return drill_pack_->Item(id - kPackItemBase);
+    }
+    return TrainingCatalog::At(id);
+}
+
+bool TrainingEngine::Start(qint64 now_ns, quint32 seed) {
+    if (item_ids_.isEmpty()) {
+        SetConfig(config_);
+        if (item_ids_.isEmpty()) {
+            return false;
+        }
+    }
+
+    // Weights are recomputed from the learned statistics alone, so the
+    // seed plus SaveState() fully determine what the session draws
+    scheduler_.Seed(seed);
+    scheduler_.SetPool(item_ids_, item_weights_);
+    current_index_ = -1;
+    queue_size_ = 0;
+
+    running_ = true;
+    paused_ = false;
+    rounds_total_ = 0;
+    rounds_correct_ = 0;
+    time_limit_ns_ = (config_.mode == TrainingMode::kTimed)
+                         ? static_cast<qint64>(config_.time_limit_seconds) * 1000000000LL
+                         : 0;
+
+    session_start_ns_ = now_ns;
+    active_ns_ = 0;
+    segment_start_ns_ = now_ns;
+
+    reaction_stats_.Clear();
+    rolling_.Clear();
+    transitions_.Clear();
+    step_timed_ = false;
+    awaiting_reaction_ = false;
+    item_answered_ = false;
+    keystrokes_.clear();
+    keystrokes_.reserve(4096);
+
+    trace_ = KeyTrace();
+    trace_.seed = seed;
+    trace_.difficulty = static_cast<quint8>(config_.difficulty);
+    trace_.mode = static_cast<quint8>(config_.mode);
+    trace_.custom_types = (config_.custom_single_keys ? KeyTrace::kCustomSingleKeys : 0) |
+                          (config_.custom_special_keys ? KeyTrace::kCustomSpecialKeys : 0) |
+                          (config_.custom_combos ? KeyTrace::kCustomCombos : 0) |
+                          (config_.custom_sequences ? KeyTrace::kCustomSequences : 0);
+    trace_.target_rounds = config_.target_rounds;
+    trace_.time_limit_seconds = config_.time_limit_seconds;
+    trace_.latency_offset_ns = latency_offset_ns_;
+    trace_.drill_pack_hash = drill_pack_ ? drill_pack_->Hash() : 0;
+    trace_.sequence_gap_budget_ms = config_.sequence_gap_budget_ms;
+    trace_.flags = config_.adaptive ? 0 : KeyTrace::kFixedOrder;
+    trace_.scheduler_state = scheduler_.SaveState();
+    trace_.events.reserve(8192);
+    trace_last_ns_ = now_ns;
+    return true;
+}
+
+void TrainingEngine::Stop(qint64 now_ns) {
+    if (!running_) return;
+    AppendTrace(TraceEventType::kStop, now_ns);
+    active_ns_ = ElapsedNs(now_ns);
+    running_ = false;
+    paused_ = false;
+    awaiting_reaction_ = false;
+}
+
+void TrainingEngine::Pause(qint64 now_ns) {
+    if (!running_ || paused_) return;
+    AppendTrace(TraceEventType::kPause, now_ns);
+    active_ns_ = ElapsedNs(now_ns);
+    paused_ = true;
+}
+
+void TrainingEngine::Resume(qint64 now_ns) {
+    if (!running_ || !paused_) return;
+    AppendTrace(TraceEventType::kResume, now_ns);
+    segment_start_ns_ = now_ns;
+    paused_ = false;
+    step_timed_ = false;
+}
+
+void TrainingEngine::NextItem() {
+    if (item_ids_.isEmpty()) {
+        return;
+    }
+
+    // Feed the finished prompt back so weak items come up more often
+    if (item_answered_) {
+        scheduler_.RecordResult(current_index_, item_missed_, item_reaction_ns_);
+    }
+
+    // Queued prompts keep the scheduler's draw order, so its no-repeat rule
+    // still holds; a result feeds into draws kPrefetchDepth prompts later
+    while (queue_size_ < kPrefetchDepth) {
+        queue_[(queue_head_ + queue_size_++) % kPrefetchDepth] = scheduler_.Next();
+    }
+    current_index_ = queue_[queue_head_];
+    queue_head_ = (queue_head_ + 1) % kPrefetchDepth;
+    queue_[(queue_head_ + kPrefetchDepth - 1) % kPrefetchDepth] = scheduler_.Next();
+    AppendTrace(TraceEventType::kNextItem, trace_last_ns_);
+    awaiting_reaction_ = true;
+    item_answered_ = false;
+    item_missed_ = false;
+    item_reaction_ns_ = 0;
+}
+
+void TrainingEngine::ShowPrompt(qint64 now_ns) {
+    if (!HasItem()) return;
+    AppendTrace(TraceEventType::kShowPrompt, now_ns);
+    matcher_.Load(CurrentItem());
+    prompt_shown_ns_ = now_ns;
+    step_timed_ = false;
+}
+
+int TrainingEngine::UpcomingItemId(int ahead) const {
+    if (current_index_ < 0 || ahead < 1 || ahead > queue_size_) {
+        return -1;
+    }
+    return item_ids_.value(queue_[(queue_head_ + ahead - 1) % kPrefetchDepth], -1);
+}
+
+const TrainingItem &TrainingEngine::CurrentItem() const {
+    return Item(item_ids_.at(current_index_));
+}
+
+KeyResult TrainingEngine::Feed(int key, Qt::KeyboardModifiers modifiers, qint64 key_ns) {
+    AppendTrace(TraceEventType::kKey, key_ns, key, static_cast<quint32>(modifiers));
+
+    KeyResult result;
+    // Pressed after the limit but handled before the deadline timer fired
+    if (IsTimeUp(key_ns)) {
+        result.finished = true;
+        return result;
+    }
+    result.outcome = matcher_.Feed(key, modifiers);
+    if (result.outcome == KeyMatcher::Outcome::kIgnored) {
+        return result;
+    }
+
+    const bool correct = result.outcome == KeyMatcher::Outcome::kStep ||
+                         result.outcome == KeyMatcher::Outcome::kComplete;
+    if (correct && step_timed_) {
+        result.step_gap_ns = key_ns - step_ns_;
+        result.too_slow = config_.sequence_gap_budget_ms > 0 &&
+                          result.step_gap_ns >
+                              static_cast<qint64>(config_.sequence_gap_budget_ms) * 1000000;
+        transitions_.Add(step_key_, key, result.step_gap_ns, result.too_slow);
+        if (result.too_slow) {
+            matcher_.RejectLastStep();
+            result.outcome = KeyMatcher::Outcome::kMiss;
+        }
+    }
+    step_timed_ = result.outcome == KeyMatcher::Outcome::kStep;
+    step_key_ = key;
+    step_ns_ = key_ns;
+
+    const qint64 active_ns = ElapsedNs(key_ns);
+    rolling_.AddKey(active_ns);
+
+    switch (result.outcome) {
+        case KeyMatcher::Outcome::kIgnored:
+            break;
+
+        case KeyMatcher::Outcome::kComplete:
+            rounds_total_++;
+            rounds_correct_++;
+            rolling_.AddRound(active_ns, true);
+            result.reaction_recorded = awaiting_reaction_;
+            RecordReaction(key_ns);
+            LogKeystroke(key_ns, key, modifiers, KeystrokeResult::kComplete, result.step_gap_ns);
+            break;
+
+        case KeyMatcher::Outcome::kStep:
+            result.reaction_recorded = awaiting_reaction_;
+            RecordReaction(key_ns);
+            LogKeystroke(key_ns, key, modifiers, KeystrokeResult::kStep, result.step_gap_ns);
+            break;
+
+        case KeyMatcher::Outcome::kMiss:
+            rounds_total_++;
+            item_missed_ = true;
+            rolling_.AddRound(active_ns, false);
+            LogKeystroke(key_ns, key, modifiers,
+                         result.too_slow ? KeystrokeResult::kTooSlow : KeystrokeResult::kMiss,
+                         result.step_gap_ns);
+            break;
+    }
+
+    result.finished = config_.mode == TrainingMode::kChallenge &&
+                      rounds_correct_ >= config_.target_rounds;
+    return result;
+}
+
+qint64 TrainingEngine::RemainingNs(qint64 now_ns) const {
+    if (time_limit_ns_ <= 0) {
+        return 0;
+    }
+    return time_limit_ns_ - ElapsedNs(now_ns);
+}
+
+bool TrainingEngine::IsTimeUp(qint64 now_ns) const {
+    return running_ && time_limit_ns_ > 0 && RemainingNs(now_ns) <= 0;
+}
+
+void TrainingEngine::AdvanceMetrics(qint64 now_ns) {
+    if (running_) {
+        rolling_.Advance(ElapsedNs(now_ns));
+    }
+}
+
+qint64 TrainingEngine::ElapsedNs(qint64 now_ns) const {
+    qint64 elapsed = active_ns_;
+    if (running_ && !paused_) {
+        elapsed += now_ns - segment_start_ns_;
+    }
+    // A timed session lasts exactly its limit, however late it is stopped
+    if (time_limit_ns_ > 0) {
+        elapsed = qMin(elapsed, time_limit_ns_);
+    }
+    return elapsed;
+}
+
+void TrainingEngine::RecordReaction(qint64 key_ns) {
+    if (!awaiting_reaction_) {
+        return;
+    }
+    awaiting_reaction_ = false;
+    // Time the prompt spent in our own pipeline and on the display is not
+    // part of the player's reaction
+    item_reaction_ns_ = qMax<qint64>(0, key_ns - prompt_shown_ns_ - latency_offset_ns_);
+    item_answered_ = true;
+    reaction_stats_.Add(current_index_, item_reaction_ns_);
+    rolling_.AddReaction(ElapsedNs(key_ns), item_reaction_ns_);
+}
+
+void TrainingEngine::LogKeystroke(qint64 key_ns, int key, Qt::KeyboardModifiers modifiers,
+                                  KeystrokeResult result, qint64 step_gap_ns) {
+    KeystrokeLogRecord record;
+    record.offset_ns = key_ns - session_start_ns_;
+    record.reaction_ns = (result == KeystrokeResult::kComplete) ? item_reaction_ns_ : 0;
+    record.item_id = item_ids_.value(current_index_, -1);
+    record.key = key;
+    record.modifiers = static_cast<quint32>(modifiers);
+    record.result = static_cast<quint8>(result);
+    if (result == KeystrokeResult::kMiss || result == KeystrokeResult::kTooSlow) {
+        record.expected_slot = static_cast<quint8>(HistoryAggregates::KeySlot(matcher_.LastMissed().key));
+    }
+    if (step_gap_ns > 0) {
+        record.step_gap_100us = static_cast<quint16>(qBound<qint64>(1, step_gap_ns / 100000, 0xffff));
+    }
+    keystrokes_.append(record);
+}
+
+void TrainingEngine::AppendTrace(TraceEventType type, qint64 now_ns, int key, quint32 modifiers) {
+    // Prompts shown outside a session (calibration) are not part of one
+    if (!running_) return;
+
+    TraceEvent event;
+    event.offset_ns = now_ns - session_start_ns_;
+    event.key = key;
+    event.modifiers = modifiers;
+    event.item_id = item_ids_.value(current_index_, -1);
+    event.type = static_cast<quint8>(type);
+    trace_.events.append(event);
+    trace_last_ns_ = now_ns;
+}
+
+ReplayResult TrainingEngine::Replay(const KeyTrace &trace) {
+    if (trace.drill_pack_hash != (drill_pack_ ? drill_pack_->Hash() : 0)) {
+        ReplayResult mismatch;
+        mismatch.pack_mismatch = true;
+        return mismatch;
+    }
+
+    TrainingConfig config;
+    config.difficulty = static_cast<Difficulty>(trace.difficulty);
+    config.mode = static_cast<TrainingMode>(trace.mode);
+    config.target_rounds = trace.target_rounds;
+    config.time_limit_seconds = trace.time_limit_seconds;
+    config.custom_single_keys = trace.custom_types & KeyTrace::kCustomSingleKeys;
+    config.custom_special_keys = trace.custom_types & KeyTrace::kCustomSpecialKeys;
+    config.custom_combos = trace.custom_types & KeyTrace::kCustomCombos;
+    config.custom_sequences = trace.custom_types & KeyTrace::kCustomSequences;
+    config.sequence_gap_budget_ms = trace.sequence_gap_budget_ms;
+    config.adaptive = !(trace.flags & KeyTrace::kFixedOrder);
+    SetConfig(config);
+    SetLatencyOffset(trace.latency_offset_ns);
+
+    ReplayResult result;
+    if (!scheduler_.RestoreState(trace.scheduler_state, kMaxItemIds)) {
+        // A previous replay's statistics would otherwise leak into the next
+        scheduler_.ForgetItems(0);
+        result.state_mismatch = true;
+        return result;
+    }
+    if (!Start(0, trace.seed)) {
+        return result;
+    }
+
+    for (const TraceEvent &event : trace.events) {
+        ++result.events;
+        switch (static_cast<TraceEventType>(event.type)) {
+            case TraceEventType::kNextItem:
+                NextItem();
+                if (CurrentItemId() != event.item_id) {
+                    ++result.item_mismatches;
+                }
+                break;
+            case TraceEventType::kShowPrompt:
+                ShowPrompt(event.offset_ns);
+                break;
+            case TraceEventType::kKey:
+                ++result.keys;
+                Feed(event.key, Qt::KeyboardModifiers(static_cast<int>(event.modifiers)),
+                     event.offset_ns);
+                break;
+            case TraceEventType::kPause:
+                Pause(event.offset_ns);
+                break;
+            case TraceEventType::kResume:
+                Resume(event.offset_ns);
+                break;
+            case TraceEventType::kStop:
+                Stop(event.offset_ns);
+                break;
+        }
+    }
+
+    result.rounds_total = rounds_total_;
+    result.rounds_correct = rounds_correct_;
+    result.elapsed_ns = active_ns_;
+    result.reaction = reaction_stats_.Summary();
+    return result;
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <QVector>
+#include <array>
+#include <Qt>
+#include <QtGlobal>
+
+#include "drill_pack.h"
+#include "item_scheduler.h"
+#include "key_matcher.h"
+#include "key_trace.h"
+#include "reaction_timing.h"
+#include "rolling_metrics.h"
+#include "session_log.h"
+#include "training_catalog.h"
+#include "transition_matrix.h"
+
+// Training modes
+enum class TrainingMode {
+    kEndless,       // No time limit
+    kTimed,         // Fixed time, count rounds
+    kChallenge,     // Fixed rounds, measure time
+    kZen            // No stats, just practice
+};
+
+// Session parameters picked on the settings page
+struct TrainingConfig {
+    Difficulty difficulty = Difficulty::kIntermediate;
+    TrainingMode mode = TrainingMode::kEndless;
+    int target_rounds = 50;         // for Challenge mode
+    int time_limit_seconds = 60;    // for Timed mode
+
+    // Custom mode type selection
+    bool custom_single_keys = true;
+    bool custom_special_keys = true;
+    bool custom_combos = true;
+    bool custom_sequences = true;
+
+    // Longest allowed time between two keys of a sequence; a slower key
+    // fails the sequence. 0 disables the check.
+    int sequence_gap_budget_ms = 0;
+
+    // Off: prompts ignore learned statistics, so every player starting with
+    // the same seed gets the same prompts (LAN races)
+    bool adaptive = true;
+};
+
+// What one key press did to the session
+struct KeyResult {
+    KeyMatcher::Outcome outcome = KeyMatcher::Outcome::kIgnored;
+    // A reaction sample was taken (first correct key of the prompt)
+    bool reaction_recorded = false;
+    // The session reached its goal (Challenge mode) or its time limit
+    // (Timed mode; keys pressed after the deadline do not count)
+    bool finished = false;
+    // kMiss of a correct sequence key that came after the gap budget
+    bool too_slow = false;
+    // Time since the previous key of the sequence, 0 for a first key
+    qint64 step_gap_ns = 0;
+};
+
+// Outcome of running a recorded trace through an engine
+struct ReplayResult {
+    // The trace was recorded with another drill pack than the engine has;
+    // nothing was replayed
+    bool pack_mismatch = false;
+    // The trace's scheduler state could not be restored; nothing was
+    // replayed and the learned statistics start over
+    bool state_mismatch = false;
+    int events = 0;
+    int keys = 0;
+    // kNextItem events where the engine drew a different item than recorded;
+    // non-zero means selection is not reproducing the original session
+    int item_mismatches = 0;
+    int rounds_total = 0;
+    int rounds_correct = 0;
+    qint64 elapsed_ns = 0;
+    ReactionSummary reaction;
+};
+
+// Headless training core: item selection, key matching, scoring and mode
+// completion. Needs only Qt Core and takes every time as a ReactionClock
+// nanosecond value, so a GUI, a benchmark or a replay can all drive it.
+//
+// A driver calls NextItem() to pick a prompt, ShowPrompt() once the prompt
+// is visible, and Feed() for each key press; after a kComplete outcome it
+// moves on with NextItem() again. The next kPrefetchDepth prompts are drawn
+// ahead of time, so a driver can show them and NextItem() only dequeues.
+//
+// Every call made during a session is also recorded into Trace(), together
+// with the scheduler seed and learned state at its start, so Replay() can
+// run the same session again and get the same prompts and scores.
+class TrainingEngine {
+public:
+    static constexpr int kPrefetchDepth = 4;
+    // Item ids of drill pack items start after the built-in catalog
+    static constexpr int kPackItemBase = TrainingCatalog::kItemCount;
+    // Upper bound of the item ids any session can learn about
+    static constexpr int kMaxItemIds = kPackItemBase + DrillPack::kMaxItems;
+
+    // Reselects the item pool for the config's difficulty
+    void SetConfig(const TrainingConfig &config);
+    const TrainingConfig &Config() const { return config_; }
+    int PoolSize() const { return item_ids_.size(); }
+
+    // Trains on pack's items instead of the built-in catalog, or on the
+    // catalog again for nullptr. The pack must stay open while it is set;
+    // learned statistics of the previous pack's items are dropped.
+    void SetDrillPack(const DrillPack *pack);
+    const DrillPack *Pack() const { return drill_pack_; }
+    // Catalog item or, from kPackItemBase on, drill pack item
+    const TrainingItem &Item(int id) const;
+
+    // Measured app + display latency, subtracted from reaction times
+    void SetLatencyOffset(qint64 offset_ns) { latency_offset_ns_ = offset_ns; }
+    qint64 LatencyOffset() const { return latency_offset_ns_; }
+
+    // Session lifecycle; false if no item is available. The seed drives item
+    // selection for the whole session.
+    bool Start(qint64 now_ns, quint32 seed);
+    void Stop(qint64 now_ns);
+    void Pause(qint64 now_ns);
+    void Resume(qint64 now_ns);
+    bool IsRunning() const { return running_; }
+    bool IsPaused() const { return paused_; }
+
+    // Feeds the finished prompt back to the scheduler, moves on to the first
+    // queued prompt and draws one more to keep the queue full
+    void NextItem();
+    // The current prompt became visible: matching and reaction time start over
+    void ShowPrompt(qint64 now_ns);
+    bool HasItem() const { return current_index_ >= 0 && current_index_ < item_ids_.size(); }
+    const TrainingItem &CurrentItem() const;
+    int CurrentItemId() const { return item_ids_.value(current_index_, -1); }
+    // Catalog id of the prompt ahead steps after the current one, in
+    // [1, kPrefetchDepth]; -1 before the first NextItem()
+    int UpcomingItemId(int ahead) const;
+    const KeyMatcher &Matcher() const { return matcher_; }
+    qint64 PromptShownNs() const { return prompt_shown_ns_; }
+
+    KeyResult Feed(int key, Qt::KeyboardModifiers modifiers, qint64 key_ns);
+
+    // Timed mode: active time left before the limit, 0 once it is reached.
+    // A driver arms one timer for exactly this long instead of counting ticks.
+    qint64 RemainingNs(qint64 now_ns) const;
+    bool IsTimeUp(qint64 now_ns) const;
+
+    int RoundsTotal() const { return rounds_total_; }
+    int RoundsCorrect() const { return rounds_correct_; }
+    // Active (unpaused) session time; never more than a Timed mode limit
+    qint64 ElapsedNs(qint64 now_ns) const;
+    const ReactionStats &Reactions() const { return reaction_stats_; }
+    // Key-to-key times inside sequences this session
+    const TransitionMatrix &Transitions() const { return transitions_; }
+    // Last 10 / 30 / 60 s of active time, as of the last key or AdvanceMetrics()
+    const RollingMetrics &Rolling() const { return rolling_; }
+    // Lets windows slide while no keys arrive
+    void AdvanceMetrics(qint64 now_ns);
+    // Keystrokes of the current session, in order
+    const QVector<KeystrokeLogRecord> &Keystrokes() const { return keystrokes_; }
+    void ClearKeystrokes() { keystrokes_.clear(); }
+    // Trace of the current or last session
+    const KeyTrace &Trace() const { return trace_; }
+
+    // Runs a trace from its recorded starting state. Replaces this engine's
+    // config and learned item statistics.
+    ReplayResult Replay(const KeyTrace &trace);
+
+private:
+    void SelectPackItems();
+    void RecordReaction(qint64 key_ns);
+    void LogKeystroke(qint64 key_ns, int key, Qt::KeyboardModifiers modifiers,
+                      KeystrokeResult result, qint64 step_gap_ns = 0);
+    void AppendTrace(TraceEventType type, qint64 now_ns, int key = 0, quint32 modifiers = 0);
+
+    TrainingConfig config_;
+    const DrillPack *drill_pack_ = nullptr;
+
+    // Item ids offered at the current difficulty, and their draw weights
+    // (drill packs only, empty for the catalog)
+    QVector<int> item_ids_;
+    QVector<double> item_weights_;
+    ItemScheduler scheduler_;
+    int current_index_ = -1;
+    // Pool positions drawn ahead of current_index_, a ring of queue_size_
+    // entries starting at queue_head_
+    std::array<int, kPrefetchDepth> queue_{};
+    int queue_head_ = 0;
+    int queue_size_ = 0;
+    // Expected input of the current item
+    KeyMatcher matcher_;
+
+    bool running_ = false;
+    bool paused_ = false;
+    int rounds_total_ = 0;
+    int rounds_correct_ = 0;
+
+    qint64 session_start_ns_ = 0;
+    qint64 active_ns_ = 0;          // session time before the current segment
+    qint64 segment_start_ns_ = 0;   // start of the running segment
+    qint64 time_limit_ns_ = 0;      // Timed mode, 0 otherwise
+
+    // Reaction timing: prompt display -> first correct keystroke of the item
+    ReactionStats reaction_stats_;
+    RollingMetrics rolling_;
+    qint64 latency_offset_ns_ = 0;
+    qint64 prompt_shown_ns_ = 0;
+    bool awaiting_reaction_ = false;
+    // Result of the current prompt, fed to the scheduler on NextItem
+    bool item_answered_ = false;
+    bool item_missed_ = false;
+    qint64 item_reaction_ns_ = 0;
+    // Last correct key of the sequence in progress; untimed at a prompt's
+    // first key and after a pause, which would count as part of the gap
+    bool step_timed_ = false;
+    int step_key_ = 0;
+    qint64 step_ns_ = 0;
+    TransitionMatrix transitions_;
+
+    QVector<KeystrokeLogRecord> keystrokes_;
+    KeyTrace trace_;
+    qint64 trace_last_ns_ = 0;      // time of the last traced event
+};
@@ -0,0 +1,52 @@
+#include "transition_matrix.h"
+
+#include <array>
+
+#include "key_matcher.h"
+
+namespace {
+
+// Index of every key code below 0x80; the tracked keys are all Latin-1
+constexpr std::array<qint8, 0x80> BuildIndex() {
+    std::array<qint8, 0x80> index{};
+    for (qint8 &entry : index) {
+        entry = -1;
+    }
+    for (int i = 0; i < TransitionMatrix::kKeyCount; ++i) {
+        const char ch = TransitionMatrix::kKeys[i];
+        // KeyMatcher::KeyForChar, which is not constexpr
+        const int key = (ch >= 'a' && ch <= 'z') ? Qt::Key_A + (ch - 'a') : ch;
+        index[key] = static_cast<qint8>(i);
+    }
+    return index;
+}
+
+constexpr std::array<qint8, 0x80> kIndex = BuildIndex();
+
+}  // namespace
+
+int TransitionMatrix::Index(int key) {
+    return (key >= 0 && key < 0x80) ? kIndex[key] : -1;
+}
+
+int TransitionMatrix::KeyAt(int index) {
+    return KeyMatcher::KeyForChar(kKeys[index]);
+}
+
+void TransitionMatrix::Clear() {
+    for (Cell &cell : cells_) {
+        cell = Cell();
+    }
+}
+
+void TransitionMatrix::Add(int from_key, int to_key, qint64 gap_ns, bool over_budget) {
+    const int from = Index(from_key);
+    const int to = Index(to_key);
+    if (from < 0 || to < 0) {
+        return;
+    }
+    Cell &cell = cells_[from * kKeyCount + to];
+    cell.total_ns += gap_ns;
+    cell.count++;
+    cell.over_budget += over_budget ? 1 : 0;
+}
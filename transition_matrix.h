@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QtGlobal>
+
+// Time between consecutive keys of a sequence, per ordered pair of the
+// left-hand keys the catalog trains ("1a": 1 -> a). The cells are a dense
+// array indexed by small key numbers, so adding a transition is two table
+// lookups and the matrix can be part of a fixed on-disk layout.
+class TransitionMatrix {
+public:
+    // Tracked keys in index order, as typed in catalog sequences
+    static constexpr char kKeys[] = "1234567qwertyuasdfghzxcvbn";
+    static constexpr int kKeyCount = sizeof(kKeys) - 1;
+
+    struct Cell {
+        qint64 total_ns = 0;
+        quint32 count = 0;
+        quint32 over_budget = 0;    // gaps that failed the sequence's gap budget
+
+        qint64 MeanNs() const { return (count > 0) ? total_ns / count : 0; }
+    };
+
+    // Row / column of a Qt::Key, -1 if the key is not tracked
+    static int Index(int key);
+    // Qt::Key of a row / column
+    static int KeyAt(int index);
+
+    void Clear();
+    // Ignored unless both keys are tracked
+    void Add(int from_key, int to_key, qint64 gap_ns, bool over_budget);
+    const Cell &At(int from_index, int to_index) const {
+        return cells_[from_index * kKeyCount + to_index];
+    }
+
+private:
+    Cell cells_[kKeyCount * kKeyCount];
+};